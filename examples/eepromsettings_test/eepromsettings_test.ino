@@ -0,0 +1,59 @@
+// Self test for the EEPROMSettings command list.
+// WARNING: Erases the settings and command list stored in EEPROM.
+#include "ReelTwo.h"
+#include "core/EEPROMSettings.h"
+
+struct TestSettings
+{
+    uint8_t fValue = 42;
+};
+
+EEPROMSettings<TestSettings> settings;
+unsigned failures;
+
+static void check(const char* what, bool ok)
+{
+    Serial.print(ok ? F("PASS ") : F("FAIL "));
+    Serial.println(what);
+    if (!ok)
+        failures++;
+}
+
+void setup()
+{
+    REELTWO_READY();
+    Serial.begin(DEFAULT_BAUD_RATE);
+#ifdef EEPROM_FLASH_PARTITION_NAME
+    EEPROM.begin(EEPROM_SIZE);
+#endif
+
+    char buffer[32];
+    settings.write();
+    settings.clearCommands();
+
+    // 255 is the end of list tag and 254 marks deleted entries
+    check("read 255 on empty list", !settings.readCommand(255, buffer, sizeof(buffer)));
+    check("read 254 on empty list", !settings.readCommand(254, buffer, sizeof(buffer)));
+    check("write 254 rejected", !settings.writeCommand(254, "deleted"));
+    check("write 255 rejected", !settings.writeCommand(255, "end"));
+
+    // 150 is not indexed and is the first entry so deleting it leaves a deleted tag at the head
+    check("write 150", settings.writeCommand(150, "one fifty"));
+    check("write 5", settings.writeCommand(5, "five"));
+    check("read 150", settings.readCommand(150, buffer, sizeof(buffer)) && strcmp(buffer, "one fifty") == 0);
+    check("delete 150", settings.deleteCommand(150));
+    check("read deleted 150", !settings.readCommand(150, buffer, sizeof(buffer)));
+    check("read 254 with deleted entry", !settings.readCommand(254, buffer, sizeof(buffer)));
+    check("read 255 with commands", !settings.readCommand(255, buffer, sizeof(buffer)));
+    check("delete 254", !settings.deleteCommand(254));
+    check("delete 255", !settings.deleteCommand(255));
+    check("read 5", settings.readCommand(5, buffer, sizeof(buffer)) && strcmp(buffer, "five") == 0);
+    check("command count", settings.getCommandCount() == 1);
+
+    settings.clearCommands();
+    Serial.println(failures == 0 ? F("ALL PASSED") : F("FAILED"));
+}
+
+void loop()
+{
+}
@@ -0,0 +1,191 @@
+// Self test and load test for the WRequest HTTP parser used by WifiWebServer.
+// Runs without a network connection, requests are fed from memory in packets.
+#include "ReelTwo.h"
+#include "wifi/WifiWebRequest.h"
+
+#define LOAD_TEST_ITERATIONS 2000
+
+// Receives requests the way WifiWebServer::handle() reads a client. The bytes of a
+// request body are skipped using Content-Length and the parser is reset for the next
+// pipelined request. Each parsed request is appended to the summary.
+struct RequestReader
+{
+    WRequest fRequest;
+    uint32_t fBodyRemaining;
+    unsigned fCount;
+    int fError;
+    char fSummary[160];
+    size_t fSummaryLen;
+
+    void begin()
+    {
+        fRequest.reset();
+        fBodyRemaining = 0;
+        fCount = 0;
+        fError = 0;
+        fSummary[0] = '\0';
+        fSummaryLen = 0;
+    }
+
+    void receive(const char* data, size_t len)
+    {
+        for (size_t i = 0; i < len && fError == 0; i++)
+            receive(data[i]);
+    }
+
+    void receive(char ch)
+    {
+        static const char* sMethods[] = { "?", "GET", "HEAD", "POST", "PUT", "DELETE" };
+        if (fBodyRemaining != 0)
+        {
+            fBodyRemaining--;
+            return;
+        }
+        switch (fRequest.parse(ch))
+        {
+            case WRequest::kIncomplete:
+                break;
+            case WRequest::kError:
+                fError = fRequest.errorCode();
+                break;
+            case WRequest::kComplete:
+                fCount++;
+                if (fSummaryLen < sizeof(fSummary))
+                {
+                    int len = snprintf(&fSummary[fSummaryLen], sizeof(fSummary) - fSummaryLen, "%s %s%s%s %s;",
+                        sMethods[fRequest.method()], fRequest.path(), fRequest.hasQuery() ? "?" : "",
+                        fRequest.query(), fRequest.keepAlive() ? "keep" : "close");
+                    fSummaryLen += (len > 0) ? len : 0;
+                }
+                fBodyRemaining = fRequest.contentLength();
+                fRequest.reset();
+                break;
+        }
+    }
+
+    /** Feed data split into packets of packetSize bytes */
+    void receivePackets(const char* data, size_t packetSize)
+    {
+        size_t len = strlen(data);
+        for (size_t offs = 0; offs < len; offs += packetSize)
+            receive(&data[offs], min(packetSize, len - offs));
+    }
+};
+
+static const char sPipelined[] =
+    "GET /one?a=1& HTTP/1.1\r\nHost: droid\r\nAccept-Encoding: gzip, deflate\r\n\r\n"
+    "POST /upload HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=XyZ\r\nContent-Length: 5\r\n\r\nhello"
+    "GET /two HTTP/1.1\r\nConnection: close\r\n\r\n";
+static const char sPipelinedSummary[] =
+    "GET /one?a=1& keep;POST /upload keep;GET /two close;";
+
+RequestReader reader;
+WRequest request;
+unsigned failures;
+
+static void check(const char* what, bool ok)
+{
+    Serial.print(ok ? F("PASS ") : F("FAIL "));
+    Serial.println(what);
+    if (!ok)
+        failures++;
+}
+
+static bool parsesAs(const char* data, size_t packetSize, const char* summary)
+{
+    reader.begin();
+    reader.receivePackets(data, packetSize);
+    return reader.fError == 0 && strcmp(reader.fSummary, summary) == 0;
+}
+
+static int errorFor(const char* prefix, char fill, size_t fillCount)
+{
+    reader.begin();
+    reader.receive(prefix, strlen(prefix));
+    while (fillCount-- > 0 && reader.fError == 0)
+        reader.receive(fill);
+    reader.receive("\r\n\r\n", 4);
+    return reader.fError;
+}
+
+static void testParser()
+{
+    check("pipelined requests in one packet", parsesAs(sPipelined, sizeof(sPipelined), sPipelinedSummary));
+    check("byte at a time", parsesAs(sPipelined, 1, sPipelinedSummary));
+    bool split = true;
+    for (size_t packetSize = 2; packetSize < sizeof(sPipelined); packetSize++)
+        split = split && parsesAs(sPipelined, packetSize, sPipelinedSummary);
+    check("split across packets", split);
+
+    // The body is left to the caller
+    reader.begin();
+    reader.receivePackets("POST /upload HTTP/1.1\r\nContent-Length: 42\r\n\r\n0123456789", 16);
+    check("request complete before body", reader.fCount == 1 && reader.fBodyRemaining == 32);
+
+    request.reset();
+    const char* headers = "GET /page HTTP/1.1\r\nIf-None-Match: \"abc\"\r\nContent-Type: multipart/form-data; boundary=\"XyZ\"\r\n\r\n";
+    for (const char* ch = headers; *ch != '\0'; ch++)
+        request.parse(*ch);
+    size_t boundaryLen = 0;
+    const char* boundary = request.boundary(boundaryLen);
+    check("multipart boundary", boundary != nullptr && boundaryLen == 3 && strncmp(boundary, "XyZ", 3) == 0);
+    check("header lookup", request.headerEquals("if-none-match", "\"abc\"") && request.header("Host") == nullptr);
+
+    // Keep-alive defaults and overrides, reusing the same parser for every request
+    check("keep-alive reuse",
+        parsesAs("GET /a HTTP/1.0\r\n\r\n"
+                 "GET /b HTTP/1.0\r\nConnection: keep-alive\r\n\r\n"
+                 "GET /c HTTP/1.1\r\n\r\n"
+                 "GET /d HTTP/1.1\r\nConnection: Close\r\n\r\n", 7,
+                 "GET /a close;GET /b keep;GET /c keep;GET /d close;") &&
+        reader.fRequest.isIdle());
+    check("blank lines between requests", parsesAs("\r\nGET /a HTTP/1.1\r\n\r\n\r\nGET /b HTTP/1.1\r\n\r\n", 3,
+        "GET /a keep;GET /b keep;"));
+
+    check("request line too long (414)", errorFor("GET /", 'a', WIFI_WEB_REQUEST_SIZE) == 414);
+    check("headers too large (431)", errorFor("GET / HTTP/1.1\r\nX-Big: ", 'b', WIFI_WEB_REQUEST_SIZE) == 431);
+    check("malformed request line (400)", errorFor("GARBAGE", ' ', 0) == 400);
+    check("bad protocol (400)", errorFor("GET / SPDY/3", ' ', 0) == 400);
+}
+
+static void loadTest()
+{
+    uint32_t bytes = 0;
+    unsigned requests = 0;
+    bool ok = true;
+    uint32_t start = micros();
+    for (unsigned i = 0; i < LOAD_TEST_ITERATIONS; i++)
+    {
+        // Typical TCP segment sizes
+        reader.begin();
+        reader.receivePackets(sPipelined, (i & 1) ? 64 : 1436);
+        ok = ok && reader.fCount == 3 && reader.fError == 0;
+        requests += reader.fCount;
+        bytes += sizeof(sPipelined) - 1;
+    }
+    uint32_t elapsed = max(micros() - start, uint32_t(1));
+    check("load test", ok);
+    Serial.print(F("Parsed "));
+    Serial.print(requests);
+    Serial.print(F(" requests in "));
+    Serial.print(elapsed / 1000);
+    Serial.print(F(" ms, "));
+    Serial.print(uint32_t(uint64_t(requests) * 1000000 / elapsed));
+    Serial.print(F(" requests/sec, "));
+    Serial.print(uint32_t(uint64_t(bytes) * 1000 / elapsed));
+    Serial.println(F(" KB/sec"));
+}
+
+void setup()
+{
+    REELTWO_READY();
+    Serial.begin(DEFAULT_BAUD_RATE);
+
+    testParser();
+    loadTest();
+    Serial.println(failures == 0 ? F("ALL PASSED") : F("FAILED"));
+}
+
+void loop()
+{
+}
@@ -1,6 +1,18 @@
 #ifndef JoystickController_h
 #define JoystickController_h
 
+#include <Arduino.h>
+
+#ifndef JOYSTICK_EVENT_QUEUE_SIZE
+#define JOYSTICK_EVENT_QUEUE_SIZE 32  /* must be a power of two */
+#endif
+
+#if defined(__AVR__)
+ #define JOYSTICK_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+ #define JOYSTICK_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
 class JoystickController
 {
 public:
@@ -133,6 +145,77 @@ public:
         Sensor sensor;
     };
 
+    /** Button identifiers, in the same order as the fields of Button */
+    enum ButtonID
+    {
+        kSelect,
+        kL3,
+        kR3,
+        kStart,
+        kUp,
+        kRight,
+        kDown,
+        kLeft,
+        kUpRight,
+        kUpLeft,
+        kDownRight,
+        kDownLeft,
+        kL2,
+        kR2,
+        kL1,
+        kR1,
+        kTriangle,
+        kCircle,
+        kCross,
+        kSquare,
+        kPS,
+        kShare,
+        kOptions,
+        kTouchpad,
+        kButtonCount
+    };
+
+    /** Axis identifiers, in the same order as the fields of Analog */
+    enum AxisID
+    {
+        kStickLX,
+        kStickLY,
+        kStickRX,
+        kStickRY,
+        kAnalogUp,
+        kAnalogRight,
+        kAnalogDown,
+        kAnalogLeft,
+        kAnalogL2,
+        kAnalogR2,
+        kAnalogL1,
+        kAnalogR1,
+        kAnalogTriangle,
+        kAnalogCircle,
+        kAnalogCross,
+        kAnalogSquare,
+        kAxisCount
+    };
+
+    enum InputEventType
+    {
+        kButtonDown,
+        kButtonUp,
+        kAxisChanged
+    };
+
+    /**
+      * Single entry in the input event queue. id is a ButtonID or AxisID depending on type.
+      * value is the new axis value for kAxisChanged. time is in microseconds.
+      */
+    struct InputEvent
+    {
+        uint8_t type;
+        uint8_t id;
+        int16_t value;
+        uint32_t time;
+    };
+
     State state;
     Event event;
 
@@ -147,6 +230,111 @@ public:
     inline bool isConnecting() const { return fConnecting; }
     inline bool isCongested() const  { return fCongested;  }
 
+    /**
+      * Copy a consistent snapshot of the controller state, last event and the time (in
+      * microseconds) it was received. Controllers such as PSController update their state
+      * from the Bluetooth task, so reading the public state fields directly from the main
+      * loop may observe a partially updated packet.
+      */
+    void getSnapshot(State& outState, Event* outEvent = nullptr, uint32_t* outTime = nullptr) const
+    {
+        uint32_t seq;
+        do
+        {
+            while (((seq = fSequence) & 1) != 0)
+                ;
+            JOYSTICK_MEMORY_BARRIER();
+            outState = state;
+            if (outEvent != nullptr)
+                *outEvent = event;
+            if (outTime != nullptr)
+                *outTime = fStateTime;
+            JOYSTICK_MEMORY_BARRIER();
+        }
+        while (seq != fSequence);
+    }
+
+    /** Time in microseconds when the current state was received */
+    inline uint32_t getStateTime() const
+    {
+        return fStateTime;
+    }
+
+    /**
+      * Latency measurement hook. Call when the current state has been acted upon (for example
+      * after sending the motor command). Records the time from packet arrival until now, once
+      * per received state.
+      */
+    void recordInputLatency()
+    {
+        uint32_t stateTime = fStateTime;
+        if (stateTime == fLatencyStateTime)
+            return;
+        uint32_t latency = micros() - stateTime;
+        fLatencyStateTime = stateTime;
+        if (latency < fLatencyMin)
+            fLatencyMin = latency;
+        if (latency > fLatencyMax)
+            fLatencyMax = latency;
+        fLatencySum += latency;
+        fLatencyCount++;
+    }
+
+    inline uint32_t getInputLatencyMin() const      { return (fLatencyCount != 0) ? fLatencyMin : 0; }
+    inline uint32_t getInputLatencyMax() const      { return fLatencyMax; }
+    inline uint32_t getInputLatencyAverage() const  { return (fLatencyCount != 0) ? fLatencySum / fLatencyCount : 0; }
+
+    /**
+      * Remove the oldest queued input event. Returns false if the queue is empty.
+      * Button presses shorter than the main loop period are still seen as a
+      * kButtonDown followed by a kButtonUp event.
+      */
+    bool popInputEvent(InputEvent& evt)
+    {
+        uint8_t tail = fEventTail;
+        if (tail == fEventHead)
+            return false;
+        JOYSTICK_MEMORY_BARRIER();
+        evt = fEventQueue[tail];
+        JOYSTICK_MEMORY_BARRIER();
+        fEventTail = (tail + 1) & (JOYSTICK_EVENT_QUEUE_SIZE - 1);
+        return true;
+    }
+
+    /** Discard all queued input events */
+    void clearInputEvents()
+    {
+        fEventTail = fEventHead;
+    }
+
+    /** Number of input events dropped because the queue was full */
+    inline unsigned getInputEventOverflow() const
+    {
+        return fEventOverflow;
+    }
+
+    /**
+      * Axis changes smaller than this (relative to the last queued value for that axis)
+      * are coalesced and not queued. Returning to rest (zero) is always queued.
+      */
+    void setAxisThreshold(uint8_t threshold)
+    {
+        fAxisThreshold = threshold;
+    }
+
+    inline uint8_t getAxisThreshold() const
+    {
+        return fAxisThreshold;
+    }
+
+    void resetInputLatency()
+    {
+        fLatencyMin = ~0u;
+        fLatencyMax = 0;
+        fLatencySum = 0;
+        fLatencyCount = 0;
+    }
+
     virtual void disconnect() {}
 
     virtual void notify() {}
@@ -161,6 +349,94 @@ protected:
     bool fConnected;
     bool fConnecting;
     bool fCongested;
+
+    /**
+      * Publish a new state and event. Must only be called from a single writer (the task
+      * receiving controller packets). Readers use getSnapshot().
+      */
+    void publishState(const State& newState, const Event& newEvent)
+    {
+        uint32_t now = micros();
+        fSequence = fSequence + 1;
+        JOYSTICK_MEMORY_BARRIER();
+        state = newState;
+        event = newEvent;
+        fStateTime = now;
+        JOYSTICK_MEMORY_BARRIER();
+        fSequence = fSequence + 1;
+    }
+
+    /**
+      * Queue button and axis events for the transition from prev to cur. Called once per
+      * received packet by the same single writer as publishState().
+      */
+    void queueInputEvents(const State& prev, const State& cur)
+    {
+        uint32_t now = micros();
+        uint32_t prevButtons = 0;
+        uint32_t curButtons = 0;
+        memcpy(&prevButtons, &prev.button, sizeof(prev.button));
+        memcpy(&curButtons, &cur.button, sizeof(cur.button));
+        uint32_t changed = prevButtons ^ curButtons;
+        for (uint8_t id = 0; changed != 0 && id < kButtonCount; id++, changed >>= 1)
+        {
+            if (changed & 1)
+                pushInputEvent(((curButtons >> id) & 1) ? kButtonDown : kButtonUp, id, 0, now);
+        }
+
+        const uint8_t* axis = (const uint8_t*)&cur.analog;
+        for (uint8_t id = 0; id < kAxisCount; id++)
+        {
+            // Sticks are signed, analog buttons are unsigned
+            int16_t val = (id <= kStickRY) ? int16_t(int8_t(axis[id])) : int16_t(axis[id]);
+            int16_t diff = val - fAxisReported[id];
+            if (diff != 0 && (val == 0 || diff >= fAxisThreshold || -diff >= fAxisThreshold))
+            {
+                fAxisReported[id] = val;
+                pushInputEvent(kAxisChanged, id, val, now);
+            }
+        }
+    }
+
+private:
+    static_assert((JOYSTICK_EVENT_QUEUE_SIZE & (JOYSTICK_EVENT_QUEUE_SIZE - 1)) == 0 &&
+                    JOYSTICK_EVENT_QUEUE_SIZE <= 128,
+        "JOYSTICK_EVENT_QUEUE_SIZE must be a power of two");
+    static_assert(sizeof(Button) <= sizeof(uint32_t), "Button must fit in 32 bits");
+    static_assert(sizeof(Analog) == kAxisCount, "Analog must be one byte per axis");
+
+    InputEvent fEventQueue[JOYSTICK_EVENT_QUEUE_SIZE];
+    volatile uint8_t fEventHead = 0;
+    volatile uint8_t fEventTail = 0;
+    unsigned fEventOverflow = 0;
+    uint8_t fAxisThreshold = 4;
+    int16_t fAxisReported[kAxisCount] = {};
+
+    void pushInputEvent(uint8_t type, uint8_t id, int16_t value, uint32_t time)
+    {
+        uint8_t head = fEventHead;
+        uint8_t next = (head + 1) & (JOYSTICK_EVENT_QUEUE_SIZE - 1);
+        if (next == fEventTail)
+        {
+            fEventOverflow++;
+            return;
+        }
+        InputEvent& evt = fEventQueue[head];
+        evt.type = type;
+        evt.id = id;
+        evt.value = value;
+        evt.time = time;
+        JOYSTICK_MEMORY_BARRIER();
+        fEventHead = next;
+    }
+
+    volatile uint32_t fSequence = 0;
+    volatile uint32_t fStateTime = 0;
+    uint32_t fLatencyStateTime = 0;
+    uint32_t fLatencyMin = ~0u;
+    uint32_t fLatencyMax = 0;
+    uint32_t fLatencySum = 0;
+    uint32_t fLatencyCount = 0;
 };
 
 #endif
@@ -26,6 +26,7 @@
 #endif
 
 #include "ServoDispatchPrivate.h"
+#include "core/FastRandom.h"
 
 /**
   * \ingroup Core
@@ -476,7 +477,7 @@ private:
     {
         for (uint16_t i = 0; i < numServos; i++)
         {
-            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? random(moveTimeMin, moveTimeMax) : moveTimeMax;
+            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? fastRandom(moveTimeMin, moveTimeMax) : moveTimeMax;
             if ((fServos[i].group & servoGroupMask) != 0)
             {
                 moveToPulse(i, startDelay, moveTime, fServos[i].currentPos(), pos);
@@ -488,7 +489,7 @@ private:
     {
         for (uint16_t i = 0; i < numServos; i++)        
         {
-            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? random(moveTimeMin, moveTimeMax) : moveTimeMax;
+            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? fastRandom(moveTimeMin, moveTimeMax) : moveTimeMax;
             if ((fServos[i].group & servoGroupMask) != 0)
             {
                 int16_t curpos = fServos[i].currentPos();
@@ -506,7 +507,7 @@ private:
         {
             if ((fServos[i].group & servoGroupMask) == 0)
                 continue;
-            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? random(moveTimeMin, moveTimeMax) : moveTimeMax;
+            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? fastRandom(moveTimeMin, moveTimeMax) : moveTimeMax;
             bool on = ((servoSetMask & (1L<<bitShift)) != 0);
             moveToPulse(i, startDelay, moveTime, fServos[i].currentPos(), (on) ? onPos : offPos);
             if (bitShift-- == 0)
@@ -521,7 +522,7 @@ private:
         {
             if ((fServos[i].group & servoGroupMask) == 0)
                 continue;
-            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? random(moveTimeMin, moveTimeMax) : moveTimeMax;
+            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? fastRandom(moveTimeMin, moveTimeMax) : moveTimeMax;
             bool on = ((servoSetMask & (1L<<bitShift)) != 0);
             int16_t curpos = fServos[i].currentPos();
             moveToPulse(i, startDelay, moveTime, curpos, curpos + ((on) ? onPos : offPos));
@@ -536,7 +537,7 @@ private:
     {
         for (uint16_t i = 0; i < numServos; i++)
         {
-            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? random(moveTimeMin, moveTimeMax) : moveTimeMax;
+            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? fastRandom(moveTimeMin, moveTimeMax) : moveTimeMax;
             if ((fServos[i].group & servoGroupMask) != 0)
             {
                 moveToPulse(i, startDelay, moveTime, fServos[i].currentPos(), scaleToPos(i, pos));
@@ -551,7 +552,7 @@ private:
         {
             if ((fServos[i].group & servoGroupMask) == 0)
                 continue;
-            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? random(moveTimeMin, moveTimeMax) : moveTimeMax;
+            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? fastRandom(moveTimeMin, moveTimeMax) : moveTimeMax;
             bool on = ((servoSetMask & (1L<<bitShift)) != 0);
             VERBOSE_SERVO_DEBUG_PRINT("moveToPulse on=");
             VERBOSE_SERVO_DEBUG_PRINT(on);
@@ -2,6 +2,7 @@
 #define ServoDispatchPCA9685_h
 
 #include "ServoDispatch.h"
+#include "core/FastRandom.h"
 #include <Wire.h>
 
 #ifdef USE_SERVO_DEBUG
@@ -732,7 +733,7 @@ private:
     {
         for (uint16_t i = 0; i < numServos; i++)
         {
-            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? random(moveTimeMin, moveTimeMax) : moveTimeMax;
+            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? fastRandom(moveTimeMin, moveTimeMax) : moveTimeMax;
             if ((fServos[i].group & servoGroupMask) != 0)
             {
                 moveToPulse(i, startDelay, moveTime, fServos[i].currentPos(), pos);
@@ -744,7 +745,7 @@ private:
     {
         for (uint16_t i = 0; i < numServos; i++)        
         {
-            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? random(moveTimeMin, moveTimeMax) : moveTimeMax;
+            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? fastRandom(moveTimeMin, moveTimeMax) : moveTimeMax;
             if ((fServos[i].group & servoGroupMask) != 0)
             {
                 int16_t curpos = fServos[i].currentPos();
@@ -762,7 +763,7 @@ private:
         {
             if ((fServos[i].group & servoGroupMask) == 0)
                 continue;
-            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? random(moveTimeMin, moveTimeMax) : moveTimeMax;
+            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? fastRandom(moveTimeMin, moveTimeMax) : moveTimeMax;
             bool on = ((servoSetMask & (1L<<bitShift)) != 0);
             moveToPulse(i, startDelay, moveTime, fServos[i].currentPos(), (on) ? onPos : offPos);
             if (bitShift-- == 0)
@@ -777,7 +778,7 @@ private:
         {
             if ((fServos[i].group & servoGroupMask) == 0)
                 continue;
-            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? random(moveTimeMin, moveTimeMax) : moveTimeMax;
+            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? fastRandom(moveTimeMin, moveTimeMax) : moveTimeMax;
             bool on = ((servoSetMask & (1L<<bitShift)) != 0);
             int16_t curpos = fServos[i].currentPos();
             moveToPulse(i, startDelay, moveTime, curpos, curpos + ((on) ? onPos : offPos));
@@ -792,7 +793,7 @@ private:
     {
         for (uint16_t i = 0; i < numServos; i++)
         {
-            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? random(moveTimeMin, moveTimeMax) : moveTimeMax;
+            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? fastRandom(moveTimeMin, moveTimeMax) : moveTimeMax;
             if ((fServos[i].group & servoGroupMask) != 0)
             {
                 moveToPulse(i, startDelay, moveTime, fServos[i].currentPos(), scaleToPos(i, pos));
@@ -807,7 +808,7 @@ private:
         {
             if ((fServos[i].group & servoGroupMask) == 0)
                 continue;
-            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? random(moveTimeMin, moveTimeMax) : moveTimeMax;
+            uint32_t moveTime = (moveTimeMin != moveTimeMax) ? fastRandom(moveTimeMin, moveTimeMax) : moveTimeMax;
             bool on = ((servoSetMask & (1L<<bitShift)) != 0);
             VERBOSE_SERVO_DEBUG_PRINT("moveToPulse on=");
             VERBOSE_SERVO_DEBUG_PRINT(on);
@@ -2,6 +2,7 @@
 #define ServoSequencer_h
 
 #include "ReelTwo.h"
+#include "core/FastRandom.h"
 #include "core/AnimatedEvent.h"
 #include "ServoDispatch.h"
 
@@ -374,7 +375,7 @@ static const ServoSequence SeqPanelLongHarlemShake PROGMEM =
 #define SEQUENCE_PLAY_ONCE_VARSPEED(sequencer, sequence, groupMask, minspeed, maxspeed) \
     (sequencer).playVariableSpeed(sequence, SizeOfArray(sequence), groupMask, minspeed, maxspeed)
 #define SEQUENCE_PLAY_RANDOM_STEP(sequencer, sequence, groupMask) \
-    (sequencer).play(&sequence[random(SizeOfArray(sequence))], 1, groupMask)
+    (sequencer).play(&sequence[fastRandom(SizeOfArray(sequence))], 1, groupMask)
 #define SEQUENCE_PLAY_ONCE_VARSPEED_EASING(sequencer, sequence, groupMask, minspeed, maxspeed, onEasing, offEasing) \
     (sequencer).playVariableSpeed(sequence, SizeOfArray(sequence), groupMask, minspeed, maxspeed, 0.0, 1.0, onEasing, offEasing)
 
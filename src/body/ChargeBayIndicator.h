@@ -2,6 +2,7 @@
 #define ChargeBayIndicator_h
 
 #include "ReelTwo.h"
+#include "core/FastRandom.h"
 #include "core/LedControlMAX7221.h"
 #include "core/SetupEvent.h"
 #include "core/AnimatedEvent.h"
@@ -128,7 +129,7 @@ public:
         switch (selectSequence)
         {
             case kFlicker:
-                fLC.setIntensity(fID, random(15));
+                fLC.setIntensity(fID, fastRandom(15));
                 randomSEQ();
                 break;
             case kNormal:
@@ -233,13 +234,13 @@ public:
       */
     void randomSEQ()
     {
-        setRow(random(4), fLC.randomRow(random(4)));
-        if (random(100) < 30)
-            setGreenLight(random(2));
-        if (random(100) < 20)
-            setYellowLight(random(2));
-        if (random(100) < 10)
-            setRedLight(random(2));
+        setRow(fastRandom(4), fLC.randomRow(fastRandom(4)));
+        if (fastRandom(100) < 30)
+            setGreenLight(fastRandom(2));
+        if (fastRandom(100) < 20)
+            setYellowLight(fastRandom(2));
+        if (fastRandom(100) < 10)
+            setRedLight(fastRandom(2));
         fDelayTime = 300;
     }
 
@@ -2,6 +2,7 @@
 #define _DATAPANEL_H_
 
 #include "ReelTwo.h"
+#include "core/FastRandom.h"
 #include "core/LedControlMAX7221.h"
 #include "core/SetupEvent.h"
 #include "core/AnimatedEvent.h"
@@ -172,12 +173,12 @@ public:
             case kDisabled:
                 break;
             case kFlicker:
-                fLC.setIntensity(fID, random(15));
+                fLC.setIntensity(fID, fastRandom(15));
                 // Fall through
             case kNormal:
                 if (fLastTimeBar + BARGRAPHSPEED < now)
                 {
-                    byte chance = random(100);
+                    byte chance = fastRandom(100);
                     byte displayValue = getBargraph();
                     /* 10% chance of changing direction */
                     if (displayValue == fBarValue && chance < 10)
@@ -205,8 +206,8 @@ public:
                 }
                 if (fLastTimeRed + REDLEDSPEED < now)
                 {
-                    setRed1Led(random(2));
-                    setRed2Led(random(2));
+                    setRed1Led(fastRandom(2));
+                    setRed2Led(fastRandom(2));
                     fLastTimeRed = now;
                 }
                 if (fLastTimeBottom + BOTTOMLEDSPEED < now)
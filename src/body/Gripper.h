@@ -3,6 +3,7 @@
 
 #include "core/AnimatedEvent.h"
 #include "core/CommandEvent.h"
+#include "core/FastRandom.h"
 
 /**
   * \ingroup Dome
@@ -110,7 +111,7 @@ public:
         {
             if (isGripperClosed())
             {
-                fCount = random(20, 40);
+                fCount = fastRandom(20, 40);
                 fDirection = 1000;
                 fNextTime = millis();
             }
@@ -163,7 +164,7 @@ public:
         uint32_t currentTime = millis();
         if (fNextTime < currentTime)
         {
-            fNextTime = currentTime + random(150,350);
+            fNextTime = currentTime + fastRandom(150,350);
             if (fCount > 0)
             {
                 fDirection = -fDirection;
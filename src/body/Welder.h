@@ -3,6 +3,7 @@
 
 #include "core/AnimatedEvent.h"
 #include "core/CommandEvent.h"
+#include "core/FastRandom.h"
 
 /**
   * \ingroup Dome
@@ -79,7 +80,7 @@ public:
     {
         if (fArmed && fCount == 0)
         {
-            fCount = random(80, 120);
+            fCount = fastRandom(80, 120);
             fCount += !(fCount&1); // ensure count is odd
             fNextTime = millis();
         }
@@ -130,12 +131,12 @@ public:
             if (relayOn)
             {
                 digitalWrite(fRelayPin, LOW);
-                fNextTime = currentTime + random(200);
+                fNextTime = currentTime + fastRandom(200);
             }
             else
             {
                 digitalWrite(fRelayPin, HIGH);
-                fNextTime = currentTime + random(20,120);
+                fNextTime = currentTime + fastRandom(20,120);
             }
         }
     }
@@ -3,6 +3,7 @@
 
 #include "core/AnimatedEvent.h"
 #include "core/CommandEvent.h"
+#include "core/FastRandom.h"
 
 /**
   * \ingroup Dome
@@ -79,7 +80,7 @@ public:
     {
         if (fArmed && fCount == 0)
         {
-            fCount = random(10, 20);
+            fCount = fastRandom(10, 20);
             fCount += !(fCount&1); // ensure count is odd
             fNextTime = millis();
         }
@@ -130,12 +131,12 @@ public:
             if (relayOn)
             {
                 digitalWrite(fRelayPin, LOW);
-                fNextTime = currentTime + random(100,200);
+                fNextTime = currentTime + fastRandom(100,200);
             }
             else
             {
                 digitalWrite(fRelayPin, HIGH);
-                fNextTime = currentTime + random(200, 800);
+                fNextTime = currentTime + fastRandom(200, 800);
             }
         }
     }
@@ -85,16 +85,17 @@ public:
         return nullptr;
     }
 
-    static void sendPS3HID(uint16_t l2cap_cid, hid_ps3cmd_t* hid_cmd, uint8_t len)
+    static void sendHID(uint16_t l2cap_cid, const void* hid_cmd, uint16_t len)
     {
-        // Serial.println("sendPS3HID");
-        BT_HDR* p_buf = (BT_HDR *)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
+        // Allocate only what the report needs rather than BT_DEFAULT_BUFFER_SIZE (4K) per command.
+        // The buffer is owned and released by the L2CAP layer once sent.
+        BT_HDR* p_buf = (BT_HDR *)osi_malloc(sizeof(BT_HDR) + L2CAP_MIN_OFFSET + len);
         if (p_buf != nullptr)
         {
-            p_buf->len = len + sizeof(*hid_cmd) - sizeof(hid_cmd->data);
+            p_buf->len = len;
             p_buf->offset = L2CAP_MIN_OFFSET;
 
-            memcpy((uint8_t*)(p_buf + 1) + p_buf->offset, (uint8_t*)hid_cmd, p_buf->len);
+            memcpy((uint8_t*)(p_buf + 1) + p_buf->offset, hid_cmd, len);
 
             /*uint8_t result =*/ L2CA_DataWrite(l2cap_cid, p_buf);
 
@@ -109,28 +110,16 @@ public:
         }
     }
 
+    static void sendPS3HID(uint16_t l2cap_cid, hid_ps3cmd_t* hid_cmd, uint8_t len)
+    {
+        // Serial.println("sendPS3HID");
+        sendHID(l2cap_cid, hid_cmd, len + sizeof(*hid_cmd) - sizeof(hid_cmd->data));
+    }
+
     static void sendPS4HID(uint16_t l2cap_cid, hid_ps4cmd_t* hid_cmd, uint8_t len)
     {
         // Serial.println("sendPS4HID");
-        BT_HDR* p_buf = (BT_HDR *)osi_malloc(BT_DEFAULT_BUFFER_SIZE);
-        if (p_buf != nullptr)
-        {
-            p_buf->len = len + sizeof(*hid_cmd) - sizeof(hid_cmd->data);
-            p_buf->offset = L2CAP_MIN_OFFSET;
-
-            memcpy((uint8_t*)(p_buf + 1) + p_buf->offset, (uint8_t*)hid_cmd, p_buf->len);
-
-            /*uint8_t result =*/ L2CA_DataWrite(l2cap_cid, p_buf);
-
-            // if (result == L2CAP_DW_SUCCESS)
-            //     Serial.println("success");
-
-            // else if (result == L2CAP_DW_CONGESTED)
-            //     Serial.println("congested");
-
-            // else if (result == L2CAP_DW_FAILED)
-            //     Serial.println("failed");
-        }
+        sendHID(l2cap_cid, hid_cmd, len + sizeof(*hid_cmd) - sizeof(hid_cmd->data));
     }
 
     static void sendCommandPS3(uint16_t l2cap_id, PS3Command& cmd)
@@ -874,8 +863,8 @@ void PSController::parsePacket(uint8_t* packet)
 
     if (fConnected)
     {
-        state = fState;
-        event = evt;
+        queueInputEvents(prev, fState);
+        publishState(fState, evt);
         notify();
     }
     else if (fConnecting)
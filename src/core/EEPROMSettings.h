@@ -12,6 +12,22 @@
  #define EEPROM_SIZE EEPROM.length()
 #endif
 
+/**
+  * \ingroup Core
+  *
+  * \class EEPROMSettings
+  *
+  * \brief Stores a settings structure followed by a list of numbered command strings in EEPROM.
+  *
+  * The header CRC is validated once and then maintained incrementally as bytes change, so
+  * reading settings or commands does not rescan the EEPROM. Command offsets are kept in a
+  * RAM index built on first access.
+  *
+  * The command list is append-only. Replacing or deleting a command only marks the old entry
+  * as deleted and the list is compacted when it runs out of space. This spreads writes over
+  * the free space instead of rewriting the same bytes, and only bytes that actually change
+  * are written.
+  */
 template <class T, uint32_t VERSION = 0xba5eba11>
 class EEPROMSettings : public T
 {
@@ -25,14 +41,14 @@ public:
 
     bool read()
     {
-        uint32_t offs = validate();
-        if (offs)
+        if (validate())
         {
+            uint16_t offs = sizeof(uint32_t);
             uint16_t siz = 0;
             EEPROM.get(offs, siz); offs += sizeof(siz);
-            if (siz == sizeof(*this))
+            if (siz == sizeof(T))
             {
-                EEPROM.get(offs, *this);
+                EEPROM.get(offs, *data());
                 return true;
             }
         }
@@ -41,48 +57,36 @@ public:
 
     void write()
     {
-        size_t offs = 0;
-        uint32_t magic = VERSION;
-        EEPROM.put(offs, magic); offs += sizeof(magic);
-
-        uint16_t siz_offs = offs; offs += sizeof(siz_offs);
-        EEPROM.put(offs, *this);
-        offs += sizeof(*this);
-
-        // Update offset
-        uint16_t siz = offs-siz_offs-sizeof(siz_offs);
-
-        EEPROM.put(siz_offs, siz);
+        validate();
+        uint16_t offs = sizeof(uint32_t);
+        uint16_t siz = sizeof(T);
+        putBytes(offs, &siz, sizeof(siz)); offs += sizeof(siz);
+        putBytes(offs, data(), sizeof(T)); offs += sizeof(T);
 
         // Check for the command section magic code
         // if it's missing we need to write out a terminating byte
+        uint32_t magic;
         EEPROM.get(offs, magic);
         if (magic != kCommandListMagic)
         {
             magic = kCommandListMagic;
-            EEPROM.put(offs, magic); offs += sizeof(magic);
-        
-            uint8_t tag = kEndTag;
-            EEPROM.put(offs, tag); offs += sizeof(tag);
+            putBytes(offs, &magic, sizeof(magic)); offs += sizeof(magic);
+            changeByte(offs, kEndTag);
         }
-        updateCRC();
-    #ifdef EEPROM_FLASH_PARTITION_NAME
-        EEPROM.commit();
-    #endif
+        fState = kValid;
+        commit();
+        buildIndex();
     }
 
     bool clearCommands()
     {
-        uint32_t offs = validateCommandList();
-        if (offs)
+        if (validate() && fListOffset != 0)
         {
-            uint8_t tag = kEndTag;
-            EEPROM.put(offs, tag);
-
-            updateCRC();
-        #ifdef EEPROM_FLASH_PARTITION_NAME
-            EEPROM.commit();
-        #endif
+            changeByte(fListOffset, kEndTag);
+            memset(fIndex, '\0', sizeof(fIndex));
+            fEnd = fListOffset;
+            fDeleted = 0;
+            commit();
             return true;
         }
         return false;
@@ -90,372 +94,347 @@ public:
 
     size_t getCommandCount()
     {
-        unsigned count = 0;
-        uint32_t offs = validateCommandList();
-        if (offs)
-        {
-            while (offs <= EEPROM_SIZE)
-            {
-                uint8_t len;
-                uint8_t snum;
-                EEPROM.get(offs, snum); offs += sizeof(snum);
-                if (snum == kEndTag)
-                    break;
-                count++;
-                EEPROM.get(offs, len); offs += sizeof(len) + len;
-            }
-        }
+        size_t count = 0;
+        for (uint16_t offs = firstCommand(); offs != 0; offs = nextCommand(offs))
+            count++;
         return count;
     }
 
     size_t getCommands(uint8_t* buffer, size_t maxBufferSize)
     {
         size_t size = 0;
-        uint32_t offs = validateCommandList();
-        if (offs)
-        {
-            while (offs <= EEPROM_SIZE)
-            {
-                uint8_t len;
-                uint8_t snum;
-                EEPROM.get(offs, snum); offs += sizeof(snum);
-                if (snum == kEndTag)
-                    break;
-                if (size < maxBufferSize)
-                    buffer[size++] = snum;
-                EEPROM.get(offs, len); offs += sizeof(len) + len;
-            }
-        }
+        for (uint16_t offs = firstCommand(); offs != 0 && size < maxBufferSize; offs = nextCommand(offs))
+            buffer[size++] = EEPROM.read(offs);
         return size;
     }
 
     bool listCommands(Print& stream)
     {
-        uint32_t offs = validateCommandList();
-        if (offs)
-        {
-            while (offs <= EEPROM_SIZE)
-            {
-                uint8_t snum;
-                EEPROM.get(offs, snum); offs += sizeof(snum);
-                if (snum == kEndTag)
-                    break;
-                stream.print('[');
-                stream.print(snum);
-                stream.print(']');
-                stream.print(' ');
-                uint8_t len;
-                EEPROM.get(offs, len); offs += sizeof(len);
-                while (len > 0)
-                {
-                    char ch;
-                    EEPROM.get(offs, ch); offs += sizeof(ch);
-                    stream.print((char)ch);
-                    len--;
-                }
-                stream.println();
-            }
-            return true;
-        }
-        return false;
+        if (!validate() || fListOffset == 0)
+            return false;
+        for (uint16_t offs = firstCommand(); offs != 0; offs = nextCommand(offs))
+            printCommand(stream, offs);
+        return true;
     }
 
     bool listSortedCommands(Print& stream)
     {
-        typedef uint32_t BMAPWORD;
-    #define BMAPWORD_GRANULARITY    (sizeof(BMAPWORD))
-    #define BMAPWORD_BIT_SIZE       (sizeof(BMAPWORD) * 8)
-    #define BIT_MAPWORD(bitpos)     (0x1L << (BMAPWORD_BIT_SIZE - 1 - (bitpos)))
-    #define SET_MAPWORD_BIT(value, bit) {\
-        uint8_t bitpos = (value) % sizeof(usedBitmap[0]); \
-        uint8_t wordpos = (value) / sizeof(usedBitmap[0]); \
-        usedBitmap[wordpos] = (usedBitmap[wordpos] & ~(BIT_MAPWORD(bitpos))) | (uint32_t(bit) << (BMAPWORD_BIT_SIZE - 1 - bitpos)); }
-    #define MAPWORD_BIT(value) \
-        ((usedBitmap[(value) / sizeof(usedBitmap[0])] & BIT_MAPWORD((value) % sizeof(usedBitmap[0]))) != 0)
-
-        uint32_t usedBitmap[kMaxCommands / sizeof(uint32_t)+1];
-        memset(&usedBitmap, '\0', sizeof(usedBitmap));
-
-        uint32_t offs = validateCommandList();
-        if (!offs)
+        if (!validate() || fListOffset == 0)
             return false;
-
-        uint16_t scanoffs = offs;
-        while (scanoffs <= EEPROM_SIZE)
-        {
-            uint8_t snum = 0;
-            EEPROM.get(scanoffs, snum); scanoffs += sizeof(snum);
-            if (snum == kEndTag)
-                break;
-
-            SET_MAPWORD_BIT(snum, 1);
-            uint8_t len = 0;
-            EEPROM.get(scanoffs, len); scanoffs += sizeof(len) + len;
-        }
-        for (unsigned i = 0; i < 100; i++)
+        for (unsigned i = 0; i < kMaxCommands; i++)
         {
-            if (MAPWORD_BIT(i))
-            {
-                uint16_t scanoffs = offs;
-                while (scanoffs <= EEPROM_SIZE)
-                {
-                    uint8_t snum = 0;
-                    EEPROM.get(scanoffs, snum); scanoffs += sizeof(snum);
-                    if (snum == kEndTag)
-                        break;
-                    if (snum == i)
-                    {
-                        stream.print('[');
-                        stream.print(snum);
-                        stream.print(']');
-                        stream.print(' ');
-                    }
-                    uint8_t len = 0;
-                    EEPROM.get(scanoffs, len); scanoffs += sizeof(len);
-                    if (snum == i)
-                    {
-                        while (len > 0)
-                        {
-                            char ch = 0;
-                            EEPROM.get(scanoffs, ch); scanoffs += sizeof(ch);
-                            stream.print((char)ch);
-                            len--;
-                        }
-                        stream.println();
-                        break;
-                    }
-                    else
-                    {
-                        scanoffs += len;
-                    }
-                }
-            }
+            if (fIndex[i] != 0)
+                printCommand(stream, fIndex[i]);
         }
         return true;
-    #undef MAPWORD_BIT
-    #undef SET_MAPWORD_BIT
-    #undef BIT_MAPWORD
-    #undef BMAPWORD_BIT_SIZE
-    #undef BMAPWORD_GRANULARITY
     }
 
     bool readCommand(uint8_t num, char* cmd, size_t cmdBufferSize, const char* prefix = nullptr)
     {
-        return readCommandInternal(num, cmd, cmdBufferSize, nullptr, prefix);
-    }
-
-    bool deleteCommand(uint8_t num)
-    {
-        uint16_t writeoffs = 0;
-        if (!readCommandInternal(num, nullptr, 0, &writeoffs))
+        if (num >= kDeletedTag)
             return false;
-
-        uint8_t len = 0;
-        uint16_t readoffs = writeoffs + 1;
-        EEPROM.get(readoffs, len); readoffs += sizeof(len);
-        readoffs += len;
-
-        while (readoffs < EEPROM_SIZE)
+        uint16_t offs = findCommand(num);
+        if (offs == 0)
+            return false;
+        if (cmd != nullptr)
         {
-            uint8_t tag = 0;
-            EEPROM.get(readoffs, tag); readoffs += sizeof(tag);
-            EEPROM.put(writeoffs, tag); writeoffs += sizeof(tag);
-            if (tag == kEndTag)
+            char ch;
+            char* cmd_end = cmd + cmdBufferSize - 1;
+            if (prefix != nullptr)
             {
-                // End of buffer
-                break;
+                while ((ch = *prefix++) != '\0' && cmd < cmd_end)
+                {
+                    *cmd++ = ch;
+                }
             }
-            uint8_t readlen = 0;
-            EEPROM.get(readoffs, readlen); readoffs += sizeof(readlen);
-            EEPROM.put(writeoffs, readlen); writeoffs += sizeof(readlen);
-            while (readlen > 0)
+            uint8_t len = EEPROM.read(offs + 1);
+            offs += 2;
+            while (len > 0)
             {
-                char ch = 0;
-                EEPROM.get(readoffs, ch); readoffs += sizeof(ch);
-                EEPROM.put(writeoffs, ch); writeoffs += sizeof(ch);
-                readlen--;
+                ch = EEPROM.read(offs++);
+                if (cmd < cmd_end)
+                    *cmd++ = ch;
+                len--;
             }
+            *cmd = '\0';
         }
-        updateCRC();
-    #ifdef EEPROM_FLASH_PARTITION_NAME
-        EEPROM.commit();
-    #endif
+        return true;
+    }
+
+    bool deleteCommand(uint8_t num)
+    {
+        if (num >= kDeletedTag)
+            return false;
+        uint16_t offs = findCommand(num);
+        if (offs == 0)
+            return false;
+        markDeleted(offs);
+        commit();
         return true;
     }
 
     bool writeCommand(uint8_t num, const char* cmd)
     {
-        if (strlen(cmd) > kMaximumCommandLength)
+        size_t cmdlen = strlen(cmd);
+        if (cmdlen > kMaximumCommandLength || num >= kDeletedTag)
         {
-            // command too long
+            // command too long or invalid number
             return false;
         }
-        // delete old command if it exists
-        deleteCommand(num);
-
-        uint32_t offs = validate();
-        if (offs)
+        if (!validate())
+            return false;
+        if (fListOffset == 0)
         {
+            // start new command buffer
+            uint16_t offs = sizeof(uint32_t);
             uint16_t siz = 0;
             EEPROM.get(offs, siz); offs += siz + sizeof(siz);
-
-            uint32_t magic;
-            EEPROM.get(offs, magic); offs += sizeof(magic);
-            if (magic == kCommandListMagic)
-            {
-                // append command to end of buffer
-                while (offs <= EEPROM_SIZE)
-                {
-                    uint8_t tag = 0;
-                    EEPROM.get(offs, tag);
-                    if (tag == kEndTag)
-                    {
-                        EEPROM.put(offs, num); offs += sizeof(num);
-
-                        uint8_t len = strlen(cmd);
-                        EEPROM.put(offs, len); offs += sizeof(len);
-                        while (len > 0)
-                        {
-                            EEPROM.put(offs, *cmd); offs += sizeof(*cmd);
-                            cmd++;
-                            len--;
-                        }
-                        // Write terminate byte
-                        num = kEndTag;
-                        EEPROM.put(offs, num); offs += sizeof(num);
-                        updateCRC();
-                    #ifdef EEPROM_FLASH_PARTITION_NAME
-                        EEPROM.commit();
-                    #endif
-                        return true;
-                    }
-                    offs += sizeof(tag);
-                    uint8_t len = 0;
-                    EEPROM.get(offs, len); offs += sizeof(len) + len;
-                }
-            }
-            else
-            {
-                // start new command buffer
-                magic = kCommandListMagic;
-                EEPROM.put(offs, magic); offs += sizeof(magic);
-
-                EEPROM.put(offs, num); offs += sizeof(num);
-
-                uint8_t len = strlen(cmd);
-                EEPROM.put(offs, len); offs += sizeof(len);
-                while (len > 0)
-                {
-                    EEPROM.put(offs, *cmd); offs += sizeof(*cmd);
-                    cmd++;
-                    len--;
-                }
-                // Write terminate byte
-                num = kEndTag;
-                EEPROM.put(offs, num); offs += sizeof(num);
-                updateCRC();
-            #ifdef EEPROM_FLASH_PARTITION_NAME
-                EEPROM.commit();
-            #endif
-                return true;
-            }
+            uint32_t magic = kCommandListMagic;
+            putBytes(offs, &magic, sizeof(magic)); offs += sizeof(magic);
+            fListOffset = fEnd = offs;
+            fDeleted = 0;
         }
-        return false;
+        uint16_t old = findCommand(num);
+        uint16_t need = 2 + cmdlen + 1;
+        uint16_t reclaim = fDeleted + ((old != 0) ? 2 + EEPROM.read(old + 1) : 0);
+        if (fEnd + need > EEPROM_SIZE + reclaim)
+        {
+            // no space even after compacting
+            return false;
+        }
+        if (old != 0)
+            markDeleted(old);
+        if (fEnd + need > EEPROM_SIZE)
+            compact();
+
+        // append command to end of log
+        uint16_t offs = fEnd;
+        changeByte(offs++, num);
+        changeByte(offs++, uint8_t(cmdlen));
+        putBytes(offs, cmd, cmdlen); offs += cmdlen;
+        // Write terminate byte
+        changeByte(offs, kEndTag);
+        if (num < kMaxCommands)
+            fIndex[num] = fEnd;
+        fEnd = offs;
+        commit();
+        return true;
     }
 
 private:
     static uint32_t constexpr kCommandListMagic = 0xf005ba11;
     static uint8_t constexpr kEndTag = 0xff;
+    static uint8_t constexpr kDeletedTag = 0xfe;
     static uint8_t constexpr kMaxCommands = 100;
 
-    uint32_t validate()
+    enum
     {
-        uint16_t offs = 0;
-        uint32_t magic;
-        EEPROM.get(offs, magic);
-        uint32_t crc = crcFrom(sizeof(magic));
-        if (magic == (VERSION ^ crc))
+        kUnknown,
+        kInvalid,
+        kValid
+    };
+
+    // Not stored in EEPROM. Only the T base is written by write(). The first member is
+    // aligned to T so it cannot be placed in the tail padding of T and clobbered by read().
+    alignas(alignof(T)) uint8_t fState = kUnknown;
+    uint32_t fCRC = 0;
+    uint32_t fDeltaCRC = 0;
+    uint16_t fDeltaPos = 0;
+    uint16_t fListOffset = 0;
+    uint16_t fEnd = 0;
+    uint16_t fDeleted = 0;
+    uint16_t fIndex[kMaxCommands];
+
+    bool validate()
+    {
+        if (fState == kUnknown)
         {
-            offs += sizeof(magic);
+            uint32_t magic;
+            EEPROM.get(0, magic);
+            fCRC = crcFrom(sizeof(magic));
+            fDeltaCRC = 0;
+            fDeltaPos = 0;
+            fState = (magic == (VERSION ^ fCRC)) ? kValid : kInvalid;
+            buildIndex();
         }
-        return offs;
+        return (fState == kValid);
     }
 
-    uint32_t validateCommandList()
+    void buildIndex()
     {
-        uint32_t offs = validate();
-        if (offs)
+        memset(fIndex, '\0', sizeof(fIndex));
+        fListOffset = fEnd = fDeleted = 0;
+        if (fState != kValid)
+            return;
+
+        uint16_t offs = sizeof(uint32_t);
+        uint16_t siz = 0;
+        EEPROM.get(offs, siz); offs += siz + sizeof(siz);
+        uint32_t magic;
+        EEPROM.get(offs, magic); offs += sizeof(magic);
+        if (magic != kCommandListMagic)
+            return;
+        uint16_t start = offs;
+        while (offs < EEPROM_SIZE)
         {
-            uint16_t siz = 0;
-            EEPROM.get(offs, siz); offs += siz + sizeof(siz);
-
-            uint32_t magic;
-            EEPROM.get(offs, magic); offs += sizeof(magic);
-            if (magic == kCommandListMagic)
+            uint8_t tag = EEPROM.read(offs);
+            if (tag == kEndTag)
             {
-                return offs;
+                fListOffset = start;
+                fEnd = offs;
+                return;
             }
+            uint8_t len = EEPROM.read(offs + 1);
+            if (tag == kDeletedTag)
+                fDeleted += 2 + len;
+            else if (tag < kMaxCommands && fIndex[tag] == 0)
+                fIndex[tag] = offs;
+            offs += 2 + len;
+        }
+        // No terminating byte
+        memset(fIndex, '\0', sizeof(fIndex));
+        fDeleted = 0;
+    }
+
+    uint16_t findCommand(uint8_t num)
+    {
+        if (!validate() || fListOffset == 0)
+            return 0;
+        if (num < kMaxCommands)
+            return fIndex[num];
+        if (num >= kDeletedTag)
+            return 0;
+        // Commands above kMaxCommands are not indexed. Skips deleted entries and stops at the end tag.
+        for (uint16_t offs = firstCommand(); offs != 0; offs = nextCommand(offs))
+        {
+            if (EEPROM.read(offs) == num)
+                return offs;
         }
         return 0;
     }
 
-    bool readCommandInternal(uint8_t num, char* cmd, size_t cmdBufferSize, uint16_t* cmdoffs = nullptr, const char* prefix = nullptr)
+    uint16_t firstCommand()
     {
-        uint32_t offs = validateCommandList();
-        if (offs)
+        if (!validate() || fListOffset == 0)
+            return 0;
+        uint8_t tag = EEPROM.read(fListOffset);
+        return (tag == kDeletedTag) ? nextCommand(fListOffset) : (tag == kEndTag) ? 0 : fListOffset;
+    }
+
+    uint16_t nextCommand(uint16_t offs)
+    {
+        for (;;)
         {
-            while (offs <= EEPROM_SIZE)
+            offs += 2 + EEPROM.read(offs + 1);
+            if (offs >= fEnd)
+                return 0;
+            if (EEPROM.read(offs) != kDeletedTag)
+                return offs;
+        }
+    }
+
+    void printCommand(Print& stream, uint16_t offs)
+    {
+        stream.print('[');
+        stream.print(EEPROM.read(offs));
+        stream.print(']');
+        stream.print(' ');
+        uint8_t len = EEPROM.read(offs + 1);
+        offs += 2;
+        while (len > 0)
+        {
+            stream.print((char)EEPROM.read(offs++));
+            len--;
+        }
+        stream.println();
+    }
+
+    void markDeleted(uint16_t offs)
+    {
+        uint8_t num = EEPROM.read(offs);
+        changeByte(offs, kDeletedTag);
+        fDeleted += 2 + EEPROM.read(offs + 1);
+        if (num < kMaxCommands)
+            fIndex[num] = 0;
+    }
+
+    void compact()
+    {
+        uint16_t readoffs = fListOffset;
+        uint16_t writeoffs = fListOffset;
+        while (readoffs < fEnd)
+        {
+            uint8_t tag = EEPROM.read(readoffs);
+            uint16_t entrylen = 2 + EEPROM.read(readoffs + 1);
+            if (tag != kDeletedTag)
             {
-                uint8_t snum = 0;
-                EEPROM.get(offs, snum);
-                if (snum == kEndTag)
-                    break;
-                if (snum == num && cmdoffs != nullptr)
-                    *cmdoffs = offs;
-                uint8_t len = 0;
-                offs += sizeof(snum);
-                EEPROM.get(offs, len); offs += sizeof(len);
-                if (snum == num)
-                {
-                    if (cmd != nullptr)
-                    {
-                        char ch;
-                        char* cmd_end = cmd + cmdBufferSize - 1;
-                        if (prefix != nullptr)
-                        {
-                            while (prefix != nullptr && (ch = *prefix++) != '\0' && cmd < cmd_end)
-                            {
-                                *cmd++ = ch;
-                            }
-                        }
-                        while (len > 0)
-                        {
-                            EEPROM.get(offs, ch); offs += sizeof(ch);
-                            if (cmd < cmd_end)
-                                *cmd++ = ch;
-                            len--;
-                        }
-                        *cmd = '\0';
-                    }
-                    return true;
-                }
-                else
+                if (writeoffs != readoffs)
                 {
-                    offs += len;
+                    for (uint16_t i = 0; i < entrylen; i++)
+                        changeByte(writeoffs + i, EEPROM.read(readoffs + i));
                 }
+                if (tag < kMaxCommands)
+                    fIndex[tag] = writeoffs;
+                writeoffs += entrylen;
             }
+            readoffs += entrylen;
         }
-        return false;
+        changeByte(writeoffs, kEndTag);
+        fEnd = writeoffs;
+        fDeleted = 0;
+    }
+
+    void putBytes(uint16_t offs, const void* ptr, size_t len)
+    {
+        const uint8_t* bytes = (const uint8_t*)ptr;
+        while (len-- > 0)
+            changeByte(offs++, *bytes++);
+    }
+
+    /**
+      * Write a byte if it changed and accumulate its effect on the CRC. The CRC is linear so
+      * the difference caused by changed bytes can be propagated separately and folded in
+      * by commit().
+      */
+    void changeByte(uint16_t offs, uint8_t value)
+    {
+        uint8_t old = EEPROM.read(offs);
+        if (old == value)
+            return;
+        EEPROM.write(offs, value);
+        if (offs < fDeltaPos)
+            flushCRC();
+        if (fDeltaCRC == 0)
+            fDeltaPos = offs;
+        for (; fDeltaPos < offs; fDeltaPos++)
+            fDeltaCRC = crcStep(fDeltaCRC, 0);
+        fDeltaCRC = crcStep(fDeltaCRC, old ^ value);
+        fDeltaPos = offs + 1;
+    }
+
+    void flushCRC()
+    {
+        if (fDeltaCRC != 0)
+        {
+            for (uint16_t offs = fDeltaPos; offs < EEPROM_SIZE; offs++)
+                fDeltaCRC = crcStep(fDeltaCRC, 0);
+            fCRC ^= fDeltaCRC;
+        }
+        fDeltaCRC = 0;
+        fDeltaPos = 0;
     }
 
-    void updateCRC()
+    void commit()
     {
         // Update header crc
-        uint32_t crc = crcFrom(sizeof(uint32_t));
-        EEPROM.put(0, VERSION ^ crc);
+        flushCRC();
+        EEPROM.put(0, VERSION ^ fCRC);
+    #ifdef EEPROM_FLASH_PARTITION_NAME
+        EEPROM.commit();
+    #endif
     }
 
-    static uint32_t crcFrom(unsigned offset = 0)
+    static inline uint32_t crcStep(uint32_t crc, uint8_t value)
     {
         static const uint32_t crc_table[16] PROGMEM =
         {
@@ -464,13 +443,17 @@ private:
             0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
             0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
         };
+        crc = pgm_read_uint32(&crc_table[(crc ^ value) & 0x0f]) ^ (crc >> 4);
+        crc = pgm_read_uint32(&crc_table[(crc ^ (value >> 4)) & 0x0f]) ^ (crc >> 4);
+        return crc;
+    }
+
+    static uint32_t crcFrom(unsigned offset = 0)
+    {
         uint32_t crc = ~0L;
         while (offset < EEPROM_SIZE)
         {
-            uint8_t eepromByte = EEPROM.read(offset);
-            crc = pgm_read_uint32(&crc_table[(crc ^ eepromByte) & 0x0f]) ^ (crc >> 4);
-            crc = pgm_read_uint32(&crc_table[(crc ^ (eepromByte >> 4)) & 0x0f]) ^ (crc >> 4);
-            crc = ~crc;
+            crc = ~crcStep(crc, EEPROM.read(offset));
             offset += 1;
         }
         return crc;
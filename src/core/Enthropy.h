@@ -2,6 +2,7 @@
 #define RandomSeed_h
 
 #include "ReelTwo.h"
+#include "core/FastRandom.h"
 #include <avr/interrupt.h>
 #include <avr/wdt.h>
 #include <util/atomic.h>
@@ -10,38 +11,71 @@
 
 volatile uint32_t Enthropy_seed;
 volatile int8_t Enthropy_iter;
+bool Enthropy_pending;
 
 /**
   * Generate enthropy used for random seed without using analog pins. Uses jitter in
   * the watchdog interrupts instead.
+  *
+  * Collection runs in the background after start(). Call poll() from loop() to feed the
+  * result into the shared FastRandom stream once it is available.
   */
 class Enthropy
 {
 public:
-    static uint32_t generate(int8_t iter = 32)
+    /** Start collecting iter bytes of watchdog jitter. Returns immediately. */
+    static void start(int8_t iter = 32)
     {
         Enthropy_seed = 0;
         Enthropy_iter = iter;
+        Enthropy_pending = true;
 
-        // Enable watch dog
+        // Enable watch dog. The interrupt disables it again when done.
+        cli();
         setWatchDog(true);
+        sei();
+    }
 
-        while (Enthropy_iter > 0);
-
-        // Disable watch dog
-        setWatchDog(false);
+    /** True once the enthropy requested by start() has been collected */
+    static bool available()
+    {
+        return Enthropy_iter <= 0;
+    }
 
+    static uint32_t seed()
+    {
         return Enthropy_seed;
     }
 
-private:
+    /**
+      * Mixes the collected enthropy into FastRandom::shared() once it is available.
+      * Returns true if it was added.
+      */
+    static bool poll()
+    {
+        if (!Enthropy_pending || !available())
+            return false;
+        FastRandom::shared().addEntropy(seed());
+        Enthropy_pending = false;
+        return true;
+    }
+
+    /** Blocking version of start() */
+    static uint32_t generate(int8_t iter = 32)
+    {
+        start(iter);
+
+        while (!available());
+
+        return seed();
+    }
+
+    /// \private
     static void setWatchDog(bool state)
     {
-        cli();                                             
-        MCUSR = 0;                                         
+        MCUSR = 0;
         _WD_CONTROL_REG |= (1 <<_WD_CHANGE_BIT) | (state << WDE);
-        _WD_CONTROL_REG = (state << WDIE);                      
-        sei();
+        _WD_CONTROL_REG = (state << WDIE);
     }
 };
  
@@ -50,6 +84,8 @@ ISR(WDT_vect)
     Enthropy_iter--;
     Enthropy_seed = Enthropy_seed << 8;
     Enthropy_seed = Enthropy_seed ^ TCNT1L;
+    if (Enthropy_iter <= 0)
+        Enthropy::setWatchDog(false);
 }
 
 #endif
@@ -0,0 +1,145 @@
+#ifndef FastRandom_h
+#define FastRandom_h
+
+#include "ReelTwo.h"
+#ifdef ESP32
+ #if __has_include(<esp_random.h>)
+  #include <esp_random.h>
+ #else
+  #include <esp_system.h>
+ #endif
+#endif
+
+// Define to a non-zero value to start the shared stream from a fixed seed and ignore
+// addEntropy() so that effect sequences can be replayed.
+#ifndef REELTWO_RANDOM_SEED
+#define REELTWO_RANDOM_SEED 0
+#endif
+
+/**
+  * \ingroup Core
+  *
+  * \class FastRandom
+  *
+  * \brief Fast xorshift32 pseudo random number generator
+  *
+  * Replacement for Arduino random() that needs no division. Bounded values are produced by
+  * scaling a 16 or 32 bit random fraction with the range. Every instance is an independent
+  * stream, FastRandom::shared() is the stream used by fastRandom().
+  *
+  * The shared stream is seeded from the hardware RNG on ESP32 and from a fixed seed
+  * elsewhere. Entropy collected later (for example by Enthropy) can be mixed in using
+  * addEntropy().
+  */
+class FastRandom
+{
+public:
+    FastRandom(uint32_t seed = kDefaultSeed)
+    {
+        setSeed(seed);
+    }
+
+    void setSeed(uint32_t seed)
+    {
+        // Scramble the seed so that similar seeds give unrelated streams
+        seed = mix(seed);
+        fState = (seed != 0) ? seed : kDefaultSeed;
+    }
+
+    void addEntropy(uint32_t entropy)
+    {
+    #if REELTWO_RANDOM_SEED == 0
+        setSeed(fState ^ entropy);
+    #else
+        UNUSED_ARG(entropy)
+    #endif
+    }
+
+    /** Returns a new stream split off this one */
+    FastRandom split()
+    {
+        return FastRandom(next() ^ 0x85EBCA6BUL);
+    }
+
+    inline uint32_t next()
+    {
+        uint32_t x = fState;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return fState = x;
+    }
+
+    inline uint8_t random8()
+    {
+        return next() >> 24;
+    }
+
+    inline uint16_t random16()
+    {
+        return next() >> 16;
+    }
+
+    /** Random value from 0 to range-1 */
+    inline uint32_t random(uint32_t range)
+    {
+        if (range <= 0xFFFF)
+            return (uint32_t(random16()) * range) >> 16;
+        return (uint64_t(next()) * range) >> 32;
+    }
+
+    /** Random value from low to high-1 or low if the range is empty */
+    inline int32_t random(int32_t low, int32_t high)
+    {
+        return (low < high) ? int32_t(low + random(uint32_t(high) - uint32_t(low))) : low;
+    }
+
+    static FastRandom& shared()
+    {
+        static FastRandom sShared(initialSeed());
+        return sShared;
+    }
+
+private:
+    enum : uint32_t
+    {
+        kDefaultSeed = 0x9E3779B9UL
+    };
+
+    uint32_t fState;
+
+    static uint32_t mix(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x85EBCA6BUL;
+        x ^= x >> 13;
+        x *= 0xC2B2AE35UL;
+        x ^= x >> 16;
+        return x;
+    }
+
+    static uint32_t initialSeed()
+    {
+    #if REELTWO_RANDOM_SEED != 0
+        return REELTWO_RANDOM_SEED;
+    #elif defined(ESP32)
+        return esp_random();
+    #else
+        return kDefaultSeed;
+    #endif
+    }
+};
+
+/** Same as random(howbig) but using the shared FastRandom stream */
+inline long fastRandom(long howbig)
+{
+    return (howbig > 0) ? long(FastRandom::shared().random(uint32_t(howbig))) : 0;
+}
+
+/** Same as random(howsmall, howbig) but using the shared FastRandom stream */
+inline long fastRandom(long howsmall, long howbig)
+{
+    return FastRandom::shared().random(int32_t(howsmall), int32_t(howbig));
+}
+
+#endif
@@ -1,6 +1,77 @@
 #ifndef Font_h
 #define Font_h
 
+// Number of glyphs kept in RAM by FontGlyphCache (power of two)
+#ifndef FONT_GLYPH_CACHE_SIZE
+ #ifdef __AVR__
+  #define FONT_GLYPH_CACHE_SIZE 8
+ #else
+  #define FONT_GLYPH_CACHE_SIZE 32
+ #endif
+#endif
+
+/**
+  * \ingroup Font
+  *
+  * \class FontGlyphCache
+  *
+  * \brief Small RAM cache of glyphs read from PROGMEM fonts
+  *
+  * The font classes search their PROGMEM tables linearly for every lookup. Text effects
+  * look up the same few characters every frame so the result of each lookup is kept in
+  * a direct mapped cache shared by all fonts.
+*/
+class FontGlyphCache
+{
+public:
+    struct Glyph
+    {
+        const void* fFont;
+        char fChar;
+        bool fFound;
+        byte fRowBytes;
+        byte fAdvance;
+        byte fData[8];
+    };
+
+    /** Returns the cached glyph or NULL */
+    static const Glyph* lookup(const void* font, char ch)
+    {
+        Glyph& glyph = slot(font, ch);
+        return (glyph.fFont == font && glyph.fChar == ch) ? &glyph : NULL;
+    }
+
+    /** Stores a glyph replacing whatever shared its slot */
+    static void store(const void* font, char ch, bool found, const byte* data, byte size, byte rowBytes = 1, byte advance = 0)
+    {
+        Glyph& glyph = slot(font, ch);
+        glyph.fFont = font;
+        glyph.fChar = ch;
+        glyph.fFound = found;
+        glyph.fRowBytes = rowBytes;
+        glyph.fAdvance = advance;
+        memcpy(glyph.fData, data, min(size, byte(sizeof(glyph.fData))));
+    }
+
+    static void clear()
+    {
+        for (unsigned i = 0; i < FONT_GLYPH_CACHE_SIZE; i++)
+            slot(i).fFont = NULL;
+    }
+
+private:
+    static Glyph& slot(unsigned index)
+    {
+        static Glyph sGlyphs[FONT_GLYPH_CACHE_SIZE];
+        return sGlyphs[index & (FONT_GLYPH_CACHE_SIZE - 1)];
+    }
+
+    static inline Glyph& slot(const void* font, char ch)
+    {
+        return slot(byte(ch) + unsigned(uintptr_t(font) >> 3));
+    }
+};
+
 /**
   * \ingroup Font
   *
@@ -15,6 +86,20 @@ public:
 
 protected:
     bool getLetter4x4(const char inChar, byte* outBuffer, const byte* fontData, size_t fontDataSize)
+    {
+        const FontGlyphCache::Glyph* cached = FontGlyphCache::lookup(this, inChar);
+        if (cached != NULL)
+        {
+            memcpy(outBuffer, cached->fData, 3);
+            return cached->fFound;
+        }
+        bool found = findLetter(inChar, outBuffer, fontData, fontDataSize);
+        FontGlyphCache::store(this, inChar, found, outBuffer, 3);
+        return found;
+    }
+
+private:
+    bool findLetter(const char inChar, byte* outBuffer, const byte* fontData, size_t fontDataSize)
     {
         const byte* ptr = fontData;
         const byte* end = fontData + fontDataSize;
@@ -52,6 +137,20 @@ public:
 
 protected:
     bool getLetter8x5(const char inChar, byte* outBuffer, const byte* fontData, size_t fontDataSize)
+    {
+        const FontGlyphCache::Glyph* cached = FontGlyphCache::lookup(this, inChar);
+        if (cached != NULL)
+        {
+            memcpy(outBuffer, cached->fData, 5);
+            return cached->fFound;
+        }
+        bool found = findLetter(inChar, outBuffer, fontData, fontDataSize);
+        FontGlyphCache::store(this, inChar, found, outBuffer, 5);
+        return found;
+    }
+
+private:
+    bool findLetter(const char inChar, byte* outBuffer, const byte* fontData, size_t fontDataSize)
     {
         const byte* ptr = fontData;
         const byte* end = fontData + fontDataSize;
@@ -98,10 +197,26 @@ public:
 class FontVar4Pt
 {
 public:
-    virtual bool getLetter(const char inChar, byte* outBuffer, byte &rowBytes, byte& advance);
+    virtual bool getLetter(const char inChar, byte* outBuffer, byte &rowBytes, byte& advance) = 0;
 
 protected:
     bool getLetterVar4Pt(const char inChar, byte* outBuffer, byte &rowBytes, byte& advance, const byte* fontData, size_t fontDataSize)
+    {
+        const FontGlyphCache::Glyph* cached = FontGlyphCache::lookup(this, inChar);
+        if (cached != NULL)
+        {
+            rowBytes = cached->fRowBytes;
+            advance = cached->fAdvance;
+            memcpy(outBuffer, cached->fData, rowBytes * 4);
+            return cached->fFound;
+        }
+        bool found = findLetter(inChar, outBuffer, rowBytes, advance, fontData, fontDataSize);
+        FontGlyphCache::store(this, inChar, found, outBuffer, rowBytes * 4, rowBytes, advance);
+        return found;
+    }
+
+private:
+    bool findLetter(const char inChar, byte* outBuffer, byte &rowBytes, byte& advance, const byte* fontData, size_t fontDataSize)
     {
         const byte* ptr = fontData;
         const byte* end = fontData + fontDataSize;
@@ -1262,4 +1377,72 @@ public:
     }
 };
 
+/**
+  * \ingroup Font
+  *
+  * \class FontTextStrip
+  *
+  * \brief Prerendered line of text with two bits per pixel
+  *
+  * Holds a line of text rendered once as intensity levels 0 (off) to 3 (brightest) so that
+  * scrolling text only needs to copy the visible window every frame. kSize is the buffer
+  * size in bytes. begin() fails if the text does not fit.
+*/
+template <unsigned kSize>
+class FontTextStrip
+{
+public:
+    /** Clears the strip for a line of text width by height pixels */
+    bool begin(unsigned width, byte height)
+    {
+        fWidth = 0;
+        fHeight = 0;
+        if (width == 0 || height == 0 || (unsigned long)width * height > kSize * 4UL)
+            return false;
+        fWidth = width;
+        fHeight = height;
+        memset(fData, '\0', (width * height + 3) / 4);
+        return true;
+    }
+
+    inline void end()
+    {
+        fWidth = 0;
+    }
+
+    inline bool isValid() const
+    {
+        return (fWidth != 0);
+    }
+
+    inline unsigned width() const
+    {
+        return fWidth;
+    }
+
+    inline byte height() const
+    {
+        return fHeight;
+    }
+
+    /** Returns the intensity level at x,y */
+    inline byte get(unsigned x, byte y) const
+    {
+        unsigned i = y * fWidth + x;
+        return (fData[i >> 2] >> ((i & 3) << 1)) & 3;
+    }
+
+    inline void set(unsigned x, byte y, byte level)
+    {
+        unsigned i = y * fWidth + x;
+        byte shift = (i & 3) << 1;
+        fData[i >> 2] = (fData[i >> 2] & ~(3 << shift)) | ((level & 3) << shift);
+    }
+
+private:
+    unsigned fWidth = 0;
+    byte fHeight = 0;
+    byte fData[kSize];
+};
+
 #endif
@@ -0,0 +1,91 @@
+#ifndef ISRSnapshot_h
+#define ISRSnapshot_h
+
+#include "ReelTwo.h"
+
+/**
+  * \ingroup Core
+  *
+  * \class ISRSnapshot
+  *
+  * \brief Hands a small struct from an interrupt handler to the main loop without tearing
+  *
+  * The writer (normally an interrupt handler) updates the value between beginWrite() and
+  * endWrite(), which bump a sequence counter before and after the update. The reader copies
+  * the value and retries if the counter was odd or changed during the copy, so the main loop
+  * never has to mask interrupts and always sees all fields from the same update.
+  *
+  * There must only be one writer at a time. Code outside the interrupt handler that needs to
+  * modify the value must mask the interrupt around beginWrite() and endWrite().
+  */
+template <typename T>
+class ISRSnapshot
+{
+public:
+    /** Starts an update and returns the value to modify */
+    inline T& beginWrite()
+    {
+        fSeq = fSeq + 1;
+        barrier();
+        return fData;
+    }
+
+    inline void endWrite()
+    {
+        barrier();
+        fSeq = fSeq + 1;
+    }
+
+    inline void write(const T& value)
+    {
+        beginWrite() = value;
+        endWrite();
+    }
+
+    /** Current value as seen by the writer. Must only be used by the writer */
+    inline const T& writerValue() const
+    {
+        return fData;
+    }
+
+    /**
+      * Copies a consistent value into out and returns the sequence number of that update.
+      * The sequence number changes every time the value is written.
+      */
+    uint8_t read(T& out) const
+    {
+        uint8_t seq;
+        do
+        {
+            seq = fSeq;
+            barrier();
+            out = fData;
+            barrier();
+        }
+        while ((seq & 1) != 0 || seq != fSeq);
+        return seq;
+    }
+
+    inline T read() const
+    {
+        T value;
+        read(value);
+        return value;
+    }
+
+    inline uint8_t sequence() const
+    {
+        return fSeq;
+    }
+
+private:
+    volatile uint8_t fSeq = 0;
+    T fData = {};
+
+    static inline void barrier()
+    {
+        asm volatile("" ::: "memory");
+    }
+};
+
+#endif
@@ -3,6 +3,15 @@
 #define LedControlMAX7221_h
 
 #include "ReelTwo.h"
+#include "core/FastRandom.h"
+
+#ifdef USE_LEDCONTROL_SPI
+#include <SPI.h>
+#endif
+
+#ifndef LEDCONTROL_SPI_CLOCK
+#define LEDCONTROL_SPI_CLOCK 10000000
+#endif
 
 /// \private
 class LedControl
@@ -77,6 +86,14 @@ public:
 
     virtual byte getRow(byte device, byte row) = 0;
 
+    /**
+      * Defer row updates until the matching endUpdate(). Calls can be nested.
+      * Rows changed in between are sent when the outermost endUpdate() is called.
+      */
+    virtual void beginUpdate() {}
+
+    virtual void endUpdate() {}
+
     void setAllPower(bool onState)
     {
         setPower(0, onState, getDeviceCount());
@@ -95,24 +112,27 @@ public:
       */
     static byte randomRow(byte randomMode)
     {
+        // Combine the bytes of a single random word
+        uint32_t r = FastRandom::shared().next();
+        byte b0 = r, b1 = r >> 8, b2 = r >> 16, b3 = r >> 24;
         switch(randomMode)
         {
             case 0:  // stage -3
-                return (random(256)&random(256)&random(256)&random(256));
+                return (b0&b1&b2&b3);
             case 1:  // stage -2
-                return (random(256)&random(256)&random(256));
+                return (b0&b1&b2);
             case 2:  // stage -1
-                return (random(256)&random(256));
+                return (b0&b1);
             case 3: // legacy "blocky" mode
-                return random(256);
+                return b0;
             case 4:  // stage 1
-                return (random(256)|random(256));
+                return (b0|b1);
             case 5:  // stage 2
-                return (random(256)|random(256)|random(256));
+                return (b0|b1|b2);
             case 6:  // stage 3
-                return (random(256)|random(256)|random(256)|random(256));
+                return (b0|b1|b2|b3);
         }
-        return random(256);
+        return b0;
     }
 };
 
@@ -124,6 +144,12 @@ public:
   * \brief LED MAX7221 device chain
   *
   * Encapsulates an MAX7221 device chain of "numDevices" on "dataPin", "clkPin", and "csPin"
+  *
+  * Rows changed between beginUpdate() and endUpdate() are only marked dirty. flush() then
+  * sends each dirty row to every device of the chain in a single pass, so a full frame
+  * costs 8 chain passes regardless of the number of devices. On AVR the pins are driven
+  * through their port registers. Define USE_LEDCONTROL_SPI to use the hardware SPI
+  * peripheral instead (any pins on ESP32, the hardware SPI pins elsewhere).
   */
 template <byte numDevices>
 class LedControlMAX7221 : public LedControl
@@ -135,6 +161,8 @@ public:
     LedControlMAX7221(byte dataPin, byte clkPin, byte csPin) :
         fIndex(0),
         fPowerMask(0),
+        fUpdateDepth(0),
+        fDirtyRows(0),
         fSPI_MOSI(dataPin),
         fSPI_CLK(clkPin),
         fSPI_CS(csPin)
@@ -143,6 +171,18 @@ public:
         pinMode(fSPI_CLK, OUTPUT);
         pinMode(fSPI_CS, OUTPUT);
         digitalWrite(fSPI_CS, HIGH);
+    #if defined(USE_LEDCONTROL_SPI)
+      #ifdef ESP32
+        SPI.begin(fSPI_CLK, -1, fSPI_MOSI, -1);
+      #else
+        SPI.begin();
+      #endif
+    #elif defined(__AVR__)
+        fDataPort = portOutputRegister(digitalPinToPort(fSPI_MOSI));
+        fDataMask = digitalPinToBitMask(fSPI_MOSI);
+        fClkPort = portOutputRegister(digitalPinToPort(fSPI_CLK));
+        fClkMask = digitalPinToBitMask(fSPI_CLK);
+    #endif
         // set everything to 0xff so clearDisplay will zero out
         for (byte i = 0; i < sizeof(fBits); i++)
             fBits[i] = ~0;
@@ -251,7 +291,7 @@ public:
                 if (*status != 0)
                 {
                     *status = 0;
-                    spiTransfer(device, i, 0);
+                    rowChanged(device, i - 1);
                 }
             }
             device++;
@@ -286,7 +326,7 @@ public:
             if (*status != val)
             {
                 *status = val;
-                spiTransfer(device, row + 1, val);
+                rowChanged(device, row);
             }
         }
     }
@@ -307,7 +347,7 @@ public:
             if (*status != value)
             {
                 *status = value;
-                spiTransfer(device, row + 1, value);
+                rowChanged(device, row);
             }
         }
     }
@@ -326,7 +366,7 @@ public:
         {
             byte* status = &fBits[device * 8 + row];
             *status = value;
-            spiTransfer(device, row + 1, value);
+            rowChanged(device, row);
         }
     }
     
@@ -360,36 +400,123 @@ public:
         return (device < numDevices && row < 8) ? fBits[device * 8 + row] : 0;
     }
 
+    virtual void beginUpdate() override
+    {
+        fUpdateDepth++;
+    }
+
+    virtual void endUpdate() override
+    {
+        if (fUpdateDepth != 0 && --fUpdateDepth == 0)
+            flush();
+    }
+
+    /**
+      * Send all dirty rows. Each row index is written to every device in one pass of the chain.
+      */
+    void flush()
+    {
+        for (byte row = 0; fDirtyRows != 0; row++)
+        {
+            if ((fDirtyRows & (1<<row)) != 0)
+            {
+                fDirtyRows &= ~(1<<row);
+                beginTransfer();
+                for (byte i = numDevices; i-- > 0;)
+                    transfer(row + 1, fBits[i * 8 + row]);
+                endTransfer();
+            }
+        }
+    }
+
 private:
-    /* Send out a single command to the device */
-    void spiTransfer(byte device, volatile byte opcode, volatile byte data)
+    void rowChanged(byte device, byte row)
+    {
+        if (fUpdateDepth != 0)
+            fDirtyRows |= (1<<row);
+        else
+            spiTransfer(device, row + 1, fBits[device * 8 + row]);
+    }
+
+    /* Send out a single command to the device, all other devices get a no-op */
+    void spiTransfer(byte device, byte opcode, byte data)
+    {
+        beginTransfer();
+        for (byte i = numDevices; i-- > 0;)
+        {
+            if (i == device)
+                transfer(opcode, data);
+            else
+                transfer(kOP_NOOP, 0);
+        }
+        endTransfer();
+    }
+
+    inline void beginTransfer()
     {
-        //Create an array with the data to shift out
-        int offset = device * 2;
-        for (byte i = 0; i < sizeof(fSPIData); i++)
-            fSPIData[i] = (byte)0;
-        //put our device data into the array
-        fSPIData[offset + 1] = opcode;
-        fSPIData[offset] = data;
-        //enable the line 
+    #ifdef USE_LEDCONTROL_SPI
+        SPI.beginTransaction(SPISettings(LEDCONTROL_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+    #endif
+        //enable the line
         digitalWrite(fSPI_CS, LOW);
-        //Now shift out the data 
-        for (byte i = sizeof(fSPIData); i > 0; i--)
-            shiftOut(fSPI_MOSI, fSPI_CLK, MSBFIRST, fSPIData[i - 1]);
+    }
+
+    inline void endTransfer()
+    {
         //latch the data onto the display
         digitalWrite(fSPI_CS, HIGH);
+    #ifdef USE_LEDCONTROL_SPI
+        SPI.endTransaction();
+    #endif
+    }
+
+    inline void transfer(byte opcode, byte data)
+    {
+        shiftByte(opcode);
+        shiftByte(data);
+    }
+
+    inline void shiftByte(byte val)
+    {
+    #if defined(USE_LEDCONTROL_SPI)
+        SPI.transfer(val);
+    #elif defined(__AVR__)
+        // Port writes are read-modify-write so keep interrupt handlers off the port
+        uint8_t oldSREG = SREG;
+        cli();
+        for (byte bit = 0x80; bit != 0; bit >>= 1)
+        {
+            if ((val & bit) != 0)
+                *fDataPort |= fDataMask;
+            else
+                *fDataPort &= ~fDataMask;
+            *fClkPort |= fClkMask;
+            *fClkPort &= ~fClkMask;
+        }
+        SREG = oldSREG;
+    #else
+        shiftOut(fSPI_MOSI, fSPI_CLK, MSBFIRST, val);
+    #endif
     }
 
     byte fIndex;
     byte fPowerMask;
+    byte fUpdateDepth;
+    byte fDirtyRows;
     byte fBits[8 * numDevices];
-    byte fSPIData[2 * numDevices];
     byte fSPI_MOSI;
     byte fSPI_CLK;
     byte fSPI_CS;
+#if defined(__AVR__) && !defined(USE_LEDCONTROL_SPI)
+    volatile uint8_t* fDataPort;
+    volatile uint8_t* fClkPort;
+    uint8_t fDataMask;
+    uint8_t fClkMask;
+#endif
 
     const int kBrightness = 15;
     enum {
+        kOP_NOOP        = 0,
         kOP_DECODEMODE  = 9,
         kOP_INTENSITY   = 10,
         kOP_SCANLIMIT   = 11,
@@ -2,6 +2,7 @@
 #define FireStrip_h
 
 #include "ReelTwo.h"
+#include "core/FastRandom.h"
 #include "core/LEDPixelEngine.h"
 #include "core/SetupEvent.h"
 #include "core/AnimatedEvent.h"
@@ -142,13 +143,13 @@ public:
                 {
                     if (!fFlipFlop)
                     {
-                        setAll(0x33+random(0x77), 0x33+random(0x77), 0xFF);
+                        setAll(0x33+fastRandom(0x77), 0x33+fastRandom(0x77), 0xFF);
                     }
                     else
                     {
                         setAll(0, 0, 0);
                     }
-                    fNextTime = currentTime + 10+(10*random(2,5));
+                    fNextTime = currentTime + 10+(10*fastRandom(2,5));
                     fFlipFlop = !fFlipFlop;
                 }
                 break;
@@ -156,7 +157,7 @@ public:
                 if (currentTime > fNextTime)
                 {
                     fire(55, 120);
-                    fNextTime = currentTime + 10+(10*random(2,5));
+                    fNextTime = currentTime + 10+(10*fastRandom(2,5));
                     fFlipFlop = !fFlipFlop;
                 }
                 break;
@@ -275,7 +276,7 @@ private:
         // Step 1.  Cool down every cell a little
         for (int i = 0; i < NUM_LEDS; i++)
         {
-            cooldown = random(0, ((Cooling * 10) / NUM_LEDS) + 2);
+            cooldown = fastRandom(0, ((Cooling * 10) / NUM_LEDS) + 2);
     
             if (cooldown>heat[i])
             {
@@ -294,10 +295,10 @@ private:
         }
     
         // Step 3.  Randomly ignite new 'sparks' near the bottom
-        if (random(255) < Sparking)
+        if (fastRandom(255) < Sparking)
         {
-            int y = random(7);
-            heat[y] = heat[y] + random(160,255);
+            int y = fastRandom(7);
+            heat[y] = heat[y] + fastRandom(160,255);
         }
 
         // Step 4.  Convert heat to LED colors
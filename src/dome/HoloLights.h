@@ -2,6 +2,7 @@
 #define HoloLights_h
 
 #include "ReelTwo.h"
+#include "core/FastRandom.h"
 #include "core/LEDPixelEngine.h"
 #include "core/SetupEvent.h"
 #include "core/AnimatedEvent.h"
@@ -148,7 +149,7 @@ public:
     {
         setLEDTwitchInterval(45, 180);
         setLEDTwitchRunInterval(5, 25);
-        setHPTwitchInterval(45 + random(15), 120 + random(60));
+        setHPTwitchInterval(45 + fastRandom(15), 120 + fastRandom(60));
 
         fHPpins[0] = 0;
         fHPpins[1] = 0;
@@ -370,7 +371,7 @@ public:
                     if (optionState >= 0)
                     {
                         if (optionState == 0)
-                            fLEDOption1 = random(0,9);
+                            fLEDOption1 = fastRandom(0,9);
                         else
                             fLEDOption1 = optionState;
                     }
@@ -545,16 +546,16 @@ public:
         } 
         if (millis() > fTwitchLEDTime && fEnableTwitchLED >= 1 && fLEDFunction > 99)
         {
-            fTwitchLEDTime = (1000L * random(fLEDTwitchInterval[0], fLEDTwitchInterval[1])) + millis();
-            fTwitchLEDRunTime = random(fLEDTwitchRunInterval[0], fLEDTwitchRunInterval[1]);
+            fTwitchLEDTime = (1000L * fastRandom(fLEDTwitchInterval[0], fLEDTwitchInterval[1])) + millis();
+            fTwitchLEDRunTime = fastRandom(fLEDTwitchRunInterval[0], fLEDTwitchRunInterval[1]);
             flushLEDState();
             fLEDHaltTime = millis();
             varResets();
             if (fEnableTwitchLED == 2)
             {      
-                fLEDFunction = random(2,7);
-                fLEDOption1 = random(1,9);
-                fLEDOption2 = random(1,9);
+                fLEDFunction = fastRandom(2,7);
+                fLEDOption1 = fastRandom(1,9);
+                fLEDOption2 = fastRandom(1,9);
                 fLEDHalt = fTwitchLEDRunTime;
             }
             else
@@ -722,12 +723,12 @@ public:
     void resetLEDTwitch()
     {
         off();
-        fTwitchLEDTime = (1000L * random(fLEDTwitchInterval[0], fLEDTwitchInterval[1])) + millis();
+        fTwitchLEDTime = (1000L * fastRandom(fLEDTwitchInterval[0], fLEDTwitchInterval[1])) + millis();
     }
 
     void resetHPTwitch()
     {
-        fTwitchHPTime = (1000 * random(fHPTwitchInterval[0], fHPTwitchInterval[1])) + millis();  
+        fTwitchHPTime = (1000 * fastRandom(fHPTwitchInterval[0], fHPTwitchInterval[1])) + millis();  
     }
 
     void setHoloPosition(float hpos, float vpos, int speed = 0)
@@ -800,7 +801,7 @@ public:
     void twitchHP(byte randtwitch)
     {
         UNUSED_ARG(randtwitch)
-        int speed = random(SERVO_SPEED[0], SERVO_SPEED[1]);
+        int speed = fastRandom(SERVO_SPEED[0], SERVO_SPEED[1]);
     #ifdef HOLO_DEBUG
         if (randtwitch == 1)
         {
@@ -809,7 +810,7 @@ public:
             DEBUG_PRINTLN(F(" HP twitch triggered...."));
         }
     #endif
-        moveHP(random(0, kNumPositions), speed);
+        moveHP(fastRandom(0, kNumPositions), speed);
     }
 
     void wagHP(byte type)
@@ -846,11 +847,11 @@ public:
         {
             for (unsigned i = 0; i < numLEDs; i++)
             {
-                setPixelColor(i, basicColor(c, random(0,10)));
+                setPixelColor(i, basicColor(c, fastRandom(0,10)));
             }
             dirty();
             fCounter = millis();
-            fInterval = random(50,150);
+            fInterval = fastRandom(50,150);
         }
     }
 
@@ -894,12 +895,12 @@ public:
                     for (unsigned i = 0; i < numLEDs; i++)
                         setPixelColor(i, kOff);
                     fSCflag = true;
-                    fSCinterval = 10 + (fSCloop * random(15,25));
+                    fSCinterval = 10 + (fSCloop * fastRandom(15,25));
                 } 
                 else
                 {
                     for (unsigned i = 0; i < numLEDs; i++)
-                        setPixelColor(i, basicColor(c, random(0,10)));
+                        setPixelColor(i, basicColor(c, fastRandom(0,10)));
                     fSCflag = false;
                     fSCloop++;
                 }
@@ -998,7 +999,7 @@ public:
         {
             fLEDTwitchInterval[0] = minSeconds;
             fLEDTwitchInterval[1] = maxSeconds;
-            fTwitchLEDTime = (1000L * random(fLEDTwitchInterval[0], fLEDTwitchInterval[1])) + millis();
+            fTwitchLEDTime = (1000L * fastRandom(fLEDTwitchInterval[0], fLEDTwitchInterval[1])) + millis();
         }
     }
 
@@ -1008,7 +1009,7 @@ public:
         {
             fLEDTwitchRunInterval[0] = minSeconds;
             fLEDTwitchRunInterval[1] = maxSeconds;
-            fTwitchLEDRunTime = (1000L * random(fLEDTwitchRunInterval[0], fLEDTwitchRunInterval[1]));  // Randomly sets initial LED Twitch Run Time value
+            fTwitchLEDRunTime = (1000L * fastRandom(fLEDTwitchRunInterval[0], fLEDTwitchRunInterval[1]));  // Randomly sets initial LED Twitch Run Time value
         }
     }
 
@@ -1227,7 +1228,7 @@ private:
     int fWagCount = -1;
     unsigned long fWagTimer = 0;
 
-    unsigned long fTwitchLEDTime = 3800 + random(10) * 100;
+    unsigned long fTwitchLEDTime = 3800 + fastRandom(10) * 100;
     unsigned long fTwitchLEDRunTime;
 
     unsigned long fTwitchHPTime = 4000; //HPs Start 4 seconds after boot;
@@ -2,6 +2,7 @@
 #define LOGICENGINE_H
 
 #include "ReelTwo.h"
+#include "core/FastRandom.h"
 #include "core/LEDPixelEngine.h"
 #include "core/SetupEvent.h"
 #include "core/AnimatedEvent.h"
@@ -53,6 +54,15 @@
  #endif
 #endif
 
+/* Bytes used per display to keep the current text message prerendered (4 pixels per byte) */
+#ifndef LOGICENGINE_TEXT_STRIP_SIZE
+ #ifdef __AVR__
+  #define LOGICENGINE_TEXT_STRIP_SIZE 64
+ #else
+  #define LOGICENGINE_TEXT_STRIP_SIZE 256
+ #endif
+#endif
+
 /** \ingroup Dome
  *
  * \struct LEDStatus
@@ -154,6 +164,50 @@ public:
         kDefault            = 0
     };
 
+    /**
+      * Effect selection decoded into its fields. The decimal effect value is laid out as
+      * T SSS C P LL (text message, sequence, color, speed, length in seconds).
+      */
+    struct EffectParams
+    {
+        uint16_t fSequence;
+        byte fColor;
+        byte fSpeed;
+        byte fLength;
+        byte fTextMsg;
+
+        /**
+          * Decodes a decimal effect value
+          */
+        static EffectParams decode(long value)
+        {
+            EffectParams result;
+            result.fLength = value % 100;
+            value /= 100;
+            result.fSpeed = value % 10;
+            value /= 10;
+            result.fColor = value % 10;
+            value /= 10;
+            result.fSequence = value % 1000;
+            value /= 1000;
+            result.fTextMsg = value % 10;
+            return result;
+        }
+
+        /**
+          * Returns the decimal effect value
+          */
+        long encode() const
+        {
+            return
+                (long int)fTextMsg * 10000000L +
+                (long int)fSequence * 10000L +
+                (long int)fColor * 1000L +
+                (long int)fSpeed * 100 +
+                fLength;
+        }
+    };
+
     /**
       * Calculate sequence value given four parameters
       */
@@ -165,6 +219,20 @@ public:
             (long int)speedScale * 100 +
             numSeconds);
     }
+
+    /**
+      * Same as sequence() but returns the decoded fields
+      */
+    static EffectParams params(byte seq, ColorVal colorVal = kDefault, uint8_t speedScale = 0, uint8_t numSeconds = 0, byte textMsg = 0)
+    {
+        EffectParams result;
+        result.fSequence = seq;
+        result.fColor = colorVal;
+        result.fSpeed = speedScale;
+        result.fLength = numSeconds;
+        result.fTextMsg = textMsg;
+        return result;
+    }
 };
 
 /** \ingroup Dome
@@ -740,6 +808,13 @@ public:
     virtual ~LogicEffectObject() {}
 };
 
+/// \private
+struct LogicMapSpan
+{
+    byte fStart;        // LED index of the first pixel in the row
+    int8_t fStride;     // LED index step per pixel or 0 if the row is not a straight run
+};
+
 /** \ingroup Dome
  *
  * \class LogicEngineRenderer
@@ -766,12 +841,19 @@ public:
 
     ColorVal randomColor()
     {
-        return ColorVal(random(10));
+        return ColorVal(fastRandom(10));
     }
 
     void selectEffect(long inputNum)
     {
         fDisplayEffectVal = inputNum;
+        fEffectParams = EffectParams::decode(inputNum);
+    }
+
+    void selectEffect(const EffectParams& params)
+    {
+        fDisplayEffectVal = params.encode();
+        fEffectParams = params;
     }
 
     inline void selectSequence(byte seq, ColorVal colorVal = kDefault, uint8_t speedScale = 0, uint8_t numSeconds = 0)
@@ -839,7 +921,7 @@ public:
             updateMappedLED(index, fSettings.fHue);
         }
         fStatusMillis = millis();
-        fDisplayEffectVal = fSettings.fDefaultEffect;
+        selectEffect(fSettings.fDefaultEffect);
     }
 
     virtual void animate() override
@@ -853,8 +935,9 @@ public:
             fStatusMillis = currentMillis;
             fFlipFlop = !fFlipFlop;
         }
-        int selectSequence = (fDisplayEffectVal % 100000000L) / 10000L;
-        int selectLength = (fDisplayEffectVal % 100);
+        // The text message digit is part of the value passed to the effect selector
+        unsigned selectSequence = fEffectParams.fTextMsg * 1000U + fEffectParams.fSequence;
+        unsigned selectLength = fEffectParams.fLength;
 
         // byte peakVal = fPeakSource->getPeakValue();
         if (hasEffectChanged())
@@ -873,7 +956,7 @@ public:
 
         bool continueEffect = (fLogicEffect != NULL) ? fLogicEffect(*this) : false;
         fPreviousEffectVal = fDisplayEffectVal;
-        if (!continueEffect || (selectLength > 0 && unsigned(selectLength) * 1000L < fEffectMillis))
+        if (!continueEffect || (selectLength > 0 && selectLength * 1000L < fEffectMillis))
         {
             if (selectSequence == RANDOM)
             {
@@ -920,10 +1003,14 @@ public:
         return ++sID;
     }
 
+    inline const EffectParams& getEffectParams() const
+    {
+        return fEffectParams;
+    }
+
     inline int getEffectColor()
     {
-        int selectColor = (fDisplayEffectVal % 10000) / 1000;
-        return selectColor;
+        return fEffectParams.fColor;
     }
 
     inline int getEffectHue()
@@ -933,20 +1020,17 @@ public:
 
     inline int getEffectSpeed()
     {
-        int selectSpeed = (fDisplayEffectVal % 1000) / 100;
-        return selectSpeed;
+        return fEffectParams.fSpeed;
     }
 
     inline int getEffectLength()
     {
-        int selectLength = (fDisplayEffectVal % 100);
-        return selectLength;
+        return fEffectParams.fLength;
     }
 
     inline int getEffectTextMsg()
     {
-        int selectTextMsg = (fDisplayEffectVal % 100000000) / 10000000;
-        return selectTextMsg;
+        return fEffectParams.fTextMsg;
     }
 
     inline unsigned getEffectDuration()
@@ -1038,7 +1122,7 @@ public:
 
     inline void setEffectWidthRange(float percent)
     {
-        fEffectRange = max(min(1.0f, percent), 0.0f);
+        fEffectWidth = int(max(min(1.0f, percent), 0.0f) * width());
     }
 
     inline int getEffectMsgWidth()
@@ -1086,6 +1170,16 @@ public:
         return pgm_read_byte(&fLEDMap[index]);
     }
 
+    /**
+      * Returns the LED index of x,y. The coordinates must be inside the display.
+      */
+    inline unsigned mapXY(int x, int y) const
+    {
+        if (fMapSpans != NULL && fMapSpans[y].fStride != 0)
+            return fMapSpans[y].fStart + x * fMapSpans[y].fStride;
+        return pgm_read_byte(&fLEDMap[y * fWidth + x]);
+    }
+
     void setLogicEffectSelector(LogicEffectSelector selector)
     {
         fEffectSelector = selector;
@@ -1164,31 +1258,11 @@ public:
 
     void clearBlockedPortion()
     {
-        int blackX = int(fEffectRange * width());
-        if (blackX < width())
+        if (fEffectWidth < width())
         {
-            if (fLEDW)
-            {
-                CRGBW blackColor = { 0, 0, 0, 0 };
-                for (int x = blackX; x < width(); x++)
-                {
-                    for (int y = 0; y < height(); y++)
-                    {
-                        fLEDW[pgm_read_byte(&fLEDMap[y * width() + x])] = blackColor;
-                    }
-                }
-            }
-            else
-            {
-                CRGB blackColor = { 0, 0, 0 };
-                for (int x = blackX; x < width(); x++)
-                {
-                    for (int y = 0; y < height(); y++)
-                    {
-                        fLED[pgm_read_byte(&fLEDMap[y * width() + x])] = blackColor;
-                    }
-                }
-            }
+            CRGB blackColor = { 0, 0, 0 };
+            for (int y = 0; y < height(); y++)
+                fillSpan(y, fEffectWidth, width(), blackColor);
         }
     }
 
@@ -1306,14 +1380,7 @@ public:
     {
         fEffectFontNum = fontNum;
         /* Recalculate lengths if text is set */
-        if (fEffectMsgText != NULL)
-        {
-            fEffectMsgLen = measureText(fEffectMsgText, fEffectMsgWidth, fEffectMsgHeight);
-        }
-        else if (fEffectMsgTextP != NULL)
-        {
-            fEffectMsgLen = measureText(fEffectMsgTextP, fEffectMsgWidth, fEffectMsgHeight);
-        }
+        measureTextMessage();
     }
 
     inline void setTextMessage(const char* msg)
@@ -1321,8 +1388,7 @@ public:
         fEffectMsgLen = fEffectMsgWidth = 0;
         fEffectMsgText = msg;
         fEffectMsgTextP = NULL;
-        if (fEffectMsgText != NULL)
-            fEffectMsgLen = measureText(fEffectMsgText, fEffectMsgWidth, fEffectMsgHeight);
+        measureTextMessage();
     }
 
     void setupTextMessage(int selectTextMsg)
@@ -1337,14 +1403,7 @@ public:
             if (fEffectMsgTextP == NULL && fEffectMsgText == NULL)
                 fEffectMsgTextP = F("STAR WARS");
         }
-        if (fEffectMsgText != NULL)
-        {
-            fEffectMsgLen = measureText(fEffectMsgText, fEffectMsgWidth, fEffectMsgHeight);
-        }
-        else if (fEffectMsgTextP != NULL)
-        {
-            fEffectMsgLen = measureText(fEffectMsgTextP, fEffectMsgWidth, fEffectMsgHeight);
-        }
+        measureTextMessage();
     }
 
     void clear()
@@ -1383,14 +1442,33 @@ public:
         fontColors[1].setHSV(hue, sat, 16);
         fontColors[2].setHSV(hue, sat, 64); /* brightest */
         clear();
+        if (y == 0 && fEffectMsgStrip.isValid())
+        {
+            /* Copy the visible part of the prerendered message */
+            int rows = min(int(fEffectMsgStrip.height()), height());
+            int startx = max(x, 0);
+            int endx = min(x + int(fEffectMsgStrip.width()), width());
+            for (int yy = 0; yy < rows; yy++)
+            {
+                for (int xx = startx; xx < endx; xx++)
+                {
+                    byte level = fEffectMsgStrip.get(xx - x, yy);
+                    if (level != 0)
+                    {
+                        unsigned index = mapXY(xx, yy);
+                        if (fLEDW)
+                            fLEDW[index] = fontColors[level - 1];
+                        else
+                            fLED[index] = fontColors[level - 1];
+                    }
+                }
+            }
+            return;
+        }
         int startx = x;
         for (int i = 0; i < fEffectMsgLen; i++)
         {
-            char ch = 0;
-            if (fEffectMsgText != NULL)
-                ch = fEffectMsgText[i];
-            if (fEffectMsgTextP != NULL)
-                ch = pgm_read_byte(&((const char*)fEffectMsgTextP)[i]);
+            char ch = textMessageChar(i);
             if (ch == '\n')
             {
                 x = startx;
@@ -1423,41 +1501,68 @@ public:
 
     void setPixel(int x, int y, byte effectHue, byte bri)
     {
-        if (unsigned(x) < unsigned(fEffectRange * width()) && unsigned(y) < unsigned(height()))
+        if (unsigned(x) < unsigned(fEffectWidth) && unsigned(y) < unsigned(height()))
         {
-            if (fLEDW) {
-                printf("setPixel(%d,%d)\n", x, y);
-                fLEDW[pgm_read_byte(&fLEDMap[y * width() + x])].setHSV(
-                    fAllColors[0].h + effectHue, fAllColors[0].s, bri);
-            }
+            if (fLEDW)
+                fLEDW[mapXY(x, y)].setHSV(fAllColors[0].h + effectHue, fAllColors[0].s, bri);
             else
-                fLED[pgm_read_byte(&fLEDMap[y * width() + x])].setHSV(
-                    fAllColors[0].h + effectHue, fAllColors[0].s, bri);
+                fLED[mapXY(x, y)].setHSV(fAllColors[0].h + effectHue, fAllColors[0].s, bri);
         }
     }
 
     void setPixelRGB(int x, int y, const struct CRGB& val)
     {
-        if (unsigned(x) < unsigned(fEffectRange * width()) && unsigned(y) < unsigned(height()))
+        if (unsigned(x) < unsigned(fEffectWidth) && unsigned(y) < unsigned(height()))
         {
             if (fLEDW)
-                fLEDW[pgm_read_byte(&fLEDMap[y * width() + x])] = val;
+                fLEDW[mapXY(x, y)] = val;
             else
-                fLED[pgm_read_byte(&fLEDMap[y * width() + x])] = val;
+                fLED[mapXY(x, y)] = val;
         }
     }
 
     void setPixelRGBW(int x, int y, const struct CRGBW& val)
     {
-        if (unsigned(x) < unsigned(fEffectRange * width()) && unsigned(y) < unsigned(height()))
+        if (unsigned(x) < unsigned(fEffectWidth) && unsigned(y) < unsigned(height()))
         {
             if (fLEDW)
-                fLEDW[pgm_read_byte(&fLEDMap[y * width() + x])] = val;
+                fLEDW[mapXY(x, y)] = val;
             else
-                fLED[pgm_read_byte(&fLEDMap[y * width() + x])] = CRGB(val.r, val.g, val.b);
+                fLED[mapXY(x, y)] = CRGB(val.r, val.g, val.b);
         }
     }
 
+    /**
+      * Sets all pixels of the rectangle x,y,w,h to val. Clipped like setPixelRGB().
+      */
+    void fillRectRGB(int x, int y, int w, int h, const struct CRGB& val)
+    {
+        int x1 = min(x + w, fEffectWidth);
+        int y1 = min(y + h, height());
+        for (y = max(y, 0); y < y1; y++)
+            fillSpan(y, x, x1, val);
+    }
+
+    /**
+      * Sets all pixels of the rectangle x,y,w,h using the same color as setPixel().
+      */
+    void fillRect(int x, int y, int w, int h, byte effectHue, byte bri)
+    {
+        CRGB color;
+        color.setHSV(fAllColors[0].h + effectHue, fAllColors[0].s, bri);
+        fillRectRGB(x, y, w, h, color);
+    }
+
+    inline void fillRow(int y, byte effectHue, byte bri)
+    {
+        fillRect(0, y, width(), 1, effectHue, bri);
+    }
+
+    inline void fillColumn(int x, byte effectHue, byte bri)
+    {
+        fillRect(x, 0, 1, height(), effectHue, bri);
+    }
+
     void setPixelRGB(int x, int y, uint8_t r, uint8_t g, uint8_t b)
     {
         CRGB color;
@@ -1631,7 +1736,7 @@ public:
                 break;
             case 'W':
                 // Wait number of seconds and then revert to default
-                fDisplayEffectVal = (fDisplayEffectVal / 100) * 100 + arg;
+                selectEffect((fDisplayEffectVal / 100) * 100 + arg);
                 break;
             case 'Z':
                 selectEffect(TEXTSCROLLLEFT);
@@ -1710,6 +1815,7 @@ protected:
             fAllColors(allColors),
             fLEDStatus(ledStatus),
             fLEDMap(ledMap),
+            fEffectWidth(width),
             fRenderGlyph(renderGlyph)
     {
         JawaID addr = kJawaOther;
@@ -1753,6 +1859,7 @@ protected:
             fAllColors(allColors),
             fLEDStatus(ledStatus),
             fLEDMap(ledMap),
+            fEffectWidth(width),
             fRenderGlyphRGBW(renderGlyph)
     {
         JawaID addr = kJawaOther;
@@ -1781,6 +1888,30 @@ protected:
 
     static uint16_t sLastEventCount;
 
+protected:
+    /**
+      * Fills spans with the start and stride of every row of the LED map that is a
+      * straight run of LEDs, so that pixels in those rows can be addressed without
+      * reading the map. spans must have room for height() entries.
+      */
+    void setMapSpans(LogicMapSpan* spans)
+    {
+        for (int y = 0; y < fHeight; y++)
+        {
+            const byte* row = &fLEDMap[y * fWidth];
+            int start = pgm_read_byte(&row[0]);
+            int stride = (fWidth > 1) ? pgm_read_byte(&row[1]) - start : 1;
+            for (int x = 2; x < fWidth && stride != 0; x++)
+            {
+                if (pgm_read_byte(&row[x]) != start + x * stride)
+                    stride = 0;
+            }
+            spans[y].fStart = start;
+            spans[y].fStride = (stride >= -127 && stride <= 127) ? stride : 0;
+        }
+        fMapSpans = spans;
+    }
+
 private:
     byte fID;
     int fWidth;
@@ -1796,6 +1927,7 @@ private:
     HSVColor* fAllColors;
     LEDStatus* fLEDStatus;
     const byte* fLEDMap;
+    const LogicMapSpan* fMapSpans = NULL;
     byte fMaxBrightness = MAX_BRIGHTNESS;
 
     byte fDisplayEffect = 0;
@@ -1808,6 +1940,7 @@ private:
 
     long fDisplayEffectVal = NORMVAL;
     long fPreviousEffectVal = ~fDisplayEffectVal;
+    EffectParams fEffectParams = EffectParams::decode(NORMVAL);
     uint32_t fEffectStartMillis = 0;
     unsigned int fEffectMillis = 0;
     LogicEffect fLogicEffect;
@@ -1816,7 +1949,7 @@ private:
     LogicEffectObject* fEffectObject = NULL;
     uint32_t fEffectData = 0;
     uint32_t fEffectData2 = 0;
-    float fEffectRange = 1.0;
+    int fEffectWidth;
     int fEffectMsgStartX;
     int fEffectMsgLen;
     int fEffectMsgWidth;
@@ -1825,15 +1958,142 @@ private:
     byte fEffectFontNum = 0;
     const char* fEffectMsgText = NULL;
     PROGMEMString fEffectMsgTextP = NULL;
+    FontTextStrip<LOGICENGINE_TEXT_STRIP_SIZE> fEffectMsgStrip;
     union {
         LogicRenderGlyph fRenderGlyph;
         LogicRenderGlyphRGBW fRenderGlyphRGBW;
     };
 
+    /**
+      * Sets pixels x0 to x1-1 of row y. Only clipped to the display.
+      */
+    void fillSpan(int y, int x0, int x1, const CRGB& color)
+    {
+        x0 = max(x0, 0);
+        x1 = min(x1, width());
+        if (x0 >= x1 || unsigned(y) >= unsigned(height()))
+            return;
+        if (fLEDW)
+            fillSpan(fLEDW, y, x0, x1, color);
+        else
+            fillSpan(fLED, y, x0, x1, color);
+    }
+
+    template <typename ColorType>
+    void fillSpan(ColorType* leds, int y, int x0, int x1, const CRGB& color)
+    {
+        if (fMapSpans != NULL && fMapSpans[y].fStride != 0)
+        {
+            int stride = fMapSpans[y].fStride;
+            ColorType* led = &leds[fMapSpans[y].fStart + x0 * stride];
+            for (int x = x0; x < x1; x++, led += stride)
+                *led = color;
+        }
+        else
+        {
+            const byte* map = &fLEDMap[y * fWidth];
+            for (int x = x0; x < x1; x++)
+                leds[pgm_read_byte(&map[x])] = color;
+        }
+    }
+
     inline int actualColorNum(int x) const
     {
         return (x >= fTotalColors) ? (fTotalColors - 2) - (x - fTotalColors) : x;
     }
+
+    inline char textMessageChar(int i) const
+    {
+        if (fEffectMsgTextP != NULL)
+            return pgm_read_byte(&((const char*)fEffectMsgTextP)[i]);
+        return (fEffectMsgText != NULL) ? fEffectMsgText[i] : 0;
+    }
+
+    void measureTextMessage()
+    {
+        if (fEffectMsgText != NULL)
+        {
+            fEffectMsgLen = measureText(fEffectMsgText, fEffectMsgWidth, fEffectMsgHeight);
+        }
+        else if (fEffectMsgTextP != NULL)
+        {
+            fEffectMsgLen = measureText(fEffectMsgTextP, fEffectMsgWidth, fEffectMsgHeight);
+        }
+        fEffectMsgStrip.end();
+        if (fLEDW)
+            prerenderText<CRGBW>(fRenderGlyphRGBW);
+        else
+            prerenderText<CRGB>(fRenderGlyph);
+    }
+
+    /**
+      * Renders a single line message once into fEffectMsgStrip. Every glyph is drawn by the
+      * display's own glyph renderer using marker colors for the three intensity levels, so
+      * the strip matches what renderText() would draw at y=0. Glyphs are drawn two rows at
+      * a time into a small scratch buffer, moving the glyph up by an even number of rows
+      * keeps the row parity staggered fonts depend on. Messages that are too long, span
+      * several lines or whose glyphs do not fit the scratch buffer are rendered glyph by
+      * glyph every frame instead.
+      */
+    template <typename ColorType, typename RenderGlyph>
+    void prerenderText(RenderGlyph renderGlyph)
+    {
+        enum
+        {
+            kScratchWidth = 16,
+            kScratchHeight = 2,
+            kMaxGlyphHeight = 8,
+            kStaggerSlack = 4
+        };
+        static const byte sScratchMap[kScratchWidth * kScratchHeight] PROGMEM = {
+              0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,  15,
+             16,  17,  18,  19,  20,  21,  22,  23,  24,  25,  26,  27,  28,  29,  30,  31
+        };
+        CRGB markers[3] = { CRGB(1, 0, 0), CRGB(2, 0, 0), CRGB(3, 0, 0) };
+        ColorType scratch[kScratchWidth * kScratchHeight];
+        byte glyphHeight = 0;
+
+        if (fEffectMsgLen == 0 || fEffectMsgWidth <= 0)
+            return;
+        renderGlyph(' ', fEffectFontNum, NULL, 0, 0, NULL, NULL, 0, 0, &glyphHeight);
+        if (fEffectMsgHeight != glyphHeight || glyphHeight > kMaxGlyphHeight)
+            return;
+        if (!fEffectMsgStrip.begin(fEffectMsgWidth + kStaggerSlack, glyphHeight))
+            return;
+        int x = 0;
+        for (int i = 0; i < fEffectMsgLen; i++)
+        {
+            char ch = textMessageChar(i);
+            int adv = 0;
+            for (byte row = 0; row < glyphHeight; row += kScratchHeight)
+            {
+                memset((void*)scratch, '\0', sizeof(scratch));
+                adv = renderGlyph(ch, fEffectFontNum, markers, 0, -int(row),
+                    scratch, sScratchMap, kScratchWidth, kScratchHeight, NULL);
+                if (adv + kStaggerSlack > kScratchWidth)
+                {
+                    fEffectMsgStrip.end();
+                    return;
+                }
+                for (byte yy = 0; yy < kScratchHeight && row + yy < glyphHeight; yy++)
+                {
+                    for (int xx = 0; xx < kScratchWidth; xx++)
+                    {
+                        byte level = scratch[yy * kScratchWidth + xx].r;
+                        if (level == 0)
+                            continue;
+                        if (level > 3 || unsigned(x + xx) >= fEffectMsgStrip.width())
+                        {
+                            fEffectMsgStrip.end();
+                            return;
+                        }
+                        fEffectMsgStrip.set(x + xx, row + yy, level);
+                    }
+                }
+            }
+            x += adv;
+        }
+    }
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -1872,6 +2132,7 @@ public:
     {
         defaultSettings();
         fEffectSelector = (selector == NULL) ? LogicEffectDefaultSelector : selector;
+        setMapSpans(fMapSpanStorage);
         fPCB.init();
     }
 
@@ -1898,6 +2159,7 @@ public:
 protected:
     PCB fPCB;
     HSVColor fAllColorsStorage[TOTALCOLORS];
+    LogicMapSpan fMapSpanStorage[PCB::height];
     LogicEngineSettings* fDefaults;
 };
 
@@ -1926,6 +2188,7 @@ public:
     {
         defaultSettings();
         fEffectSelector = (selector == NULL) ? LogicEffectDefaultSelector : selector;
+        setMapSpans(fMapSpanStorage);
         fPCB.init();
     }
 
@@ -1952,6 +2215,7 @@ public:
 protected:
     PCB fPCB;
     HSVColor fAllColorsStorage[TOTALCOLORS];
+    LogicMapSpan fMapSpanStorage[PCB::height];
     LogicEngineSettings* fDefaults;
 };
 
@@ -2199,7 +2463,6 @@ static bool LogicPSIColorWipeEffect(LogicEngineRenderer& r)
     }
     if (r.getEffectFlip())
     {
-        int y;
         int x = r.getEffectData() & 0xFF;
         int px = (r.getEffectData() >> 8) & 0xFF;
         int dir = (r.getEffectData() >> 16) & 0x1;
@@ -2207,8 +2470,7 @@ static bool LogicPSIColorWipeEffect(LogicEngineRenderer& r)
         // if (px != x)
         //     for (y = 0; y < r.height(); y++)
         //         r.setPixel(px, y, r.getEffectHue(), 0);
-        for (y = 0; y < r.height(); y++)
-            r.setPixel(x, y, (dir) ? r.mapSelectColorToHue(altColor) : r.getEffectHue(), 200);
+        r.fillColumn(x, (dir) ? r.mapSelectColorToHue(altColor) : r.getEffectHue(), 200);
         px = x;
         x += (!dir) ? 1 : -1;
         int pdir = dir;
@@ -2224,12 +2486,12 @@ static bool LogicPSIColorWipeEffect(LogicEngineRenderer& r)
         }
         if (pdir != dir)
         {
-            r.setEffectDelay(1000+2000*random(3));
+            r.setEffectDelay(1000+2000*fastRandom(3));
         }
         //decide if we're going to get 'stuck'
-        else if (random(100) <= 5)
+        else if (fastRandom(100) <= 5)
         {
-            r.setEffectDelay(1000+2000*random(3));
+            r.setEffectDelay(1000+2000*fastRandom(3));
         }
         else
         {
@@ -2481,8 +2743,7 @@ static bool LogicRoamingPixelEffect(LogicEngineRenderer& r)
         x += 1;
         if (x > r.width())
         {
-            for (x = 0; x < r.width(); x++)
-                r.setPixel(x, y, r.getEffectHue(), 0);
+            r.fillRow(y, r.getEffectHue(), 0);
             x = 0;
             y += 1;
         }
@@ -2515,15 +2776,12 @@ static bool LogicHorizontalScanLineEffect(LogicEngineRenderer& r)
     }
     else if (r.getEffectFlip())
     {
-        int x;
         int y = r.getEffectData() & 0xFF;
         int py = (r.getEffectData() >> 8) & 0xFF;
         int dir = (r.getEffectData() >> 16) & 0x1;
         if (py != y)
-            for (x = 0; x < r.width(); x++)
-                r.setPixel(x, py, r.getEffectHue(), 0);
-        for (x = 0; x < r.width(); x++)
-            r.setPixel(x, y, r.getEffectHue(), 200);
+            r.fillRow(py, r.getEffectHue(), 0);
+        r.fillRow(y, r.getEffectHue(), 200);
         py = y;
         y += (!dir) ? 1 : -1;
         if (y >= r.height())
@@ -2561,15 +2819,12 @@ static bool LogicVerticalScanLineEffect(LogicEngineRenderer& r)
     }
     else if (r.getEffectFlip())
     {
-        int y;
         int x = r.getEffectData() & 0xFF;
         int px = (r.getEffectData() >> 8) & 0xFF;
         int dir = (r.getEffectData() >> 16) & 0x1;
         if (px != x)
-            for (y = 0; y < r.height(); y++)
-                r.setPixel(px, y, r.getEffectHue(), 0);
-        for (y = 0; y < r.height(); y++)
-            r.setPixel(x, y, r.getEffectHue(), 200);
+            r.fillColumn(px, r.getEffectHue(), 0);
+        r.fillColumn(x, r.getEffectHue(), 200);
         px = x;
         x += (!dir) ? 1 : -1;
         if (x >= r.width())
@@ -2639,7 +2894,7 @@ static bool LogicFireEffect(LogicEngineRenderer& r)
         /* Generate line */
         for (uint8_t x = 0; x < width; x++)
         {
-           ledStatus[x].fColorPause = random(64, 255);
+           ledStatus[x].fColorPause = fastRandom(64, 255);
         }
     }
     if (r.getEffectFlip())
@@ -2662,7 +2917,7 @@ static bool LogicFireEffect(LogicEngineRenderer& r)
             /* Generate line */
             for (uint8_t x = 0; x < width; x++)
             {
-               ledStatus[x].fColorPause = random(64, 255);
+               ledStatus[x].fColorPause = fastRandom(64, 255);
             }
         }
         int nextv;
@@ -2725,24 +2980,14 @@ static bool LogicPulseEffect(LogicEngineRenderer& r)
     }
     else if (r.getEffectFlip())
     {
-        float xmid = r.width()/2;
-        float ymid = r.height()/2;
-        int dy;
-        int dx;
+        int xmid = r.width()/2;
+        int ymid = r.height()/2;
         int x = r.getEffectData() & 0xFF;
         int px = (r.getEffectData() >> 8) & 0xFF;
         int dir = (r.getEffectData() >> 16) & 0x1;
 
-        for (dy = 0; dy < r.height(); dy++) {
-            for (dx = 0; dx < r.width(); dx++) {
-                if ((dy+px >= ymid && dy-px <= ymid) && (dx+px >= xmid && dx-px <= xmid)) 
-                {
-                    r.setPixel(dx, dy, r.getEffectHue(), 150);
-                } else {
-                    r.setPixel(dx, dy, r.getEffectHue(), 0);
-                }
-            }
-        }
+        r.fillRect(0, 0, r.width(), r.height(), r.getEffectHue(), 0);
+        r.fillRect(xmid - px, ymid - px, px * 2 + 1, px * 2 + 1, r.getEffectHue(), 150);
         px += (!dir) ? 1 : -1;
         if (px > r.width()/2 || px < 1) {
             dir =  !dir;
@@ -2785,7 +3030,7 @@ LogicEffect LogicEffectDefaultSelector(unsigned selectSequence)
         LogicPulseEffect,
     };
     if (selectSequence == LogicEngineDefaults::RANDOM)
-        selectSequence = random(SizeOfArray(sLogicEffects));
+        selectSequence = fastRandom(SizeOfArray(sLogicEffects));
     if (selectSequence > SizeOfArray(sLogicEffects))
         selectSequence = 0;
     return LogicEffect(sLogicEffects[selectSequence]);
@@ -2,11 +2,215 @@
 #define MagicPanel_h
 
 #include "ReelTwo.h"
+#include "core/FastRandom.h"
 #include "core/SetupEvent.h"
 #include "core/AnimatedEvent.h"
 #include "core/CommandEvent.h"
 #include "core/LedControlMAX7221.h"
 
+/** Packs eight row bytes (row 0 first, column 0 in the MSB) into a MagicPanelFrame value */
+#define MAGIC_PANEL_FRAME(r0, r1, r2, r3, r4, r5, r6, r7) \
+    (uint64_t(r0) | (uint64_t(r1) << 8) | (uint64_t(r2) << 16) | (uint64_t(r3) << 24) | \
+    (uint64_t(r4) << 32) | (uint64_t(r5) << 40) | (uint64_t(r6) << 48) | (uint64_t(r7) << 56))
+
+/**
+  * \ingroup Dome
+  *
+  * \class MagicPanelFrame
+  *
+  * \brief Packed 8x8 frame buffer of a Magic Panel
+  *
+  * The whole panel is held in one 64-bit word. Byte y is row y and column 0 is the most
+  * significant bit of each row. Shifts, scrolls, masks and blits operate on all 64 pixels
+  * at once.
+  */
+class MagicPanelFrame
+{
+public:
+    constexpr MagicPanelFrame(uint64_t bits = 0) :
+        fBits(bits)
+    {
+    }
+
+    /** Reads a frame stored in PROGMEM */
+    static MagicPanelFrame fromProgmem(const uint64_t* ptr)
+    {
+        uint64_t bits;
+        memcpy_P(&bits, ptr, sizeof(bits));
+        return MagicPanelFrame(bits);
+    }
+
+    inline uint64_t bits() const
+    {
+        return fBits;
+    }
+
+    inline bool isEmpty() const
+    {
+        return fBits == 0;
+    }
+
+    inline void clear()
+    {
+        fBits = 0;
+    }
+
+    inline byte getRow(byte y) const
+    {
+        return byte(fBits >> (y * 8));
+    }
+
+    inline void setRow(byte y, byte bits)
+    {
+        fBits = (fBits & ~(uint64_t(0xFF) << (y * 8))) | (uint64_t(bits) << (y * 8));
+    }
+
+    inline bool getPixel(byte x, byte y) const
+    {
+        return ((fBits >> (y * 8 + 7 - x)) & 1) != 0;
+    }
+
+    inline void setPixel(byte x, byte y, bool on)
+    {
+        uint64_t mask = uint64_t(1) << (y * 8 + 7 - x);
+        fBits = (on) ? (fBits | mask) : (fBits & ~mask);
+    }
+
+    inline void setCol(byte x, bool on)
+    {
+        uint64_t mask = kColumn0 >> x;
+        fBits = (on) ? (fBits | mask) : (fBits & ~mask);
+    }
+
+    /** Replaces the pixels selected by mask with the pixels of src */
+    inline void blit(MagicPanelFrame src, uint64_t mask = ~uint64_t(0))
+    {
+        fBits = (fBits & ~mask) | (src.fBits & mask);
+    }
+
+    inline void mask(uint64_t mask)
+    {
+        fBits &= mask;
+    }
+
+    inline void blitOr(MagicPanelFrame src)
+    {
+        fBits |= src.fBits;
+    }
+
+    inline void blitXor(MagicPanelFrame src)
+    {
+        fBits ^= src.fBits;
+    }
+
+    inline void invert()
+    {
+        fBits = ~fBits;
+    }
+
+    /** Moves all pixels towards column 0, clearing the last columns */
+    inline void shiftLeft(byte n = 1)
+    {
+        fBits = (n < 8) ? ((fBits << n) & (kAll * byte(0xFF << n))) : 0;
+    }
+
+    /** Moves all pixels towards column 7, clearing the first columns */
+    inline void shiftRight(byte n = 1)
+    {
+        fBits = (n < 8) ? ((fBits >> n) & (kAll * byte(0xFF >> n))) : 0;
+    }
+
+    /** Moves all pixels towards row 0, clearing the last rows */
+    inline void shiftUp(byte n = 1)
+    {
+        fBits = (n < 8) ? (fBits >> (n * 8)) : 0;
+    }
+
+    /** Moves all pixels towards row 7, clearing the first rows */
+    inline void shiftDown(byte n = 1)
+    {
+        fBits = (n < 8) ? (fBits << (n * 8)) : 0;
+    }
+
+    /** Same as shiftLeft() but columns wrap around */
+    inline void scrollLeft(byte n = 1)
+    {
+        n &= 7;
+        if (n != 0)
+            fBits = ((fBits << n) & (kAll * byte(0xFF << n))) | ((fBits >> (8 - n)) & (kAll * byte(0xFF >> (8 - n))));
+    }
+
+    /** Same as shiftRight() but columns wrap around */
+    inline void scrollRight(byte n = 1)
+    {
+        scrollLeft(8 - (n & 7));
+    }
+
+    /** Same as shiftUp() but rows wrap around */
+    inline void scrollUp(byte n = 1)
+    {
+        n &= 7;
+        if (n != 0)
+            fBits = (fBits >> (n * 8)) | (fBits << (64 - n * 8));
+    }
+
+    /** Same as shiftDown() but rows wrap around */
+    inline void scrollDown(byte n = 1)
+    {
+        scrollUp(8 - (n & 7));
+    }
+
+    /**
+      * Advances the frame by one generation of Conway's Game of Life on a torus. The
+      * eight neighbour frames are summed with a bit sliced counter so all cells are
+      * updated together.
+      */
+    void life()
+    {
+        MagicPanelFrame row[3] = { *this, *this, *this };
+        row[0].scrollUp();
+        row[2].scrollDown();
+        uint64_t ones = 0, twos = 0, fours = 0;
+        for (byte i = 0; i < 3; i++)
+        {
+            MagicPanelFrame left = row[i];
+            MagicPanelFrame right = row[i];
+            left.scrollLeft();
+            right.scrollRight();
+            uint64_t neighbours[3] = { left.fBits, row[i].fBits, right.fBits };
+            for (byte j = 0; j < 3; j++)
+            {
+                // Skip the cell itself
+                if (i == 1 && j == 1)
+                    continue;
+                uint64_t n = neighbours[j];
+                uint64_t carry = ones & n;
+                ones ^= n;
+                fours |= twos & carry;
+                twos ^= carry;
+            }
+        }
+        // Two neighbours keep a live cell alive, three bring any cell to life
+        fBits = ~fours & twos & (ones | fBits);
+    }
+
+    inline bool operator==(const MagicPanelFrame& other) const
+    {
+        return fBits == other.fBits;
+    }
+
+    inline bool operator!=(const MagicPanelFrame& other) const
+    {
+        return fBits != other.fBits;
+    }
+
+private:
+    static constexpr uint64_t kAll = 0x0101010101010101ULL;
+    static constexpr uint64_t kColumn0 = 0x8080808080808080ULL;
+
+    uint64_t fBits;
+};
+
 /**
   * \ingroup Dome
   *
@@ -29,13 +233,10 @@ public:
         fLC(ledControl),
         fDisplayEffect(kNormal),
         fPreviousEffect(~fDisplayEffect),
-        fFlipFlop(false),
-        fFlipFlopLast(false),
         fStatusDelay(1000),
         fStatusMillis(0),
         fEffectSeqCount(0),
         fEffectSeqDir(0),
-        fPrevEffectSeqCount(0),
         fEffectLengthMillis(0),
         fEffectStartMillis(0),
         fDisplayEffectVal(0)
@@ -72,6 +273,7 @@ public:
       */
     virtual void setup() override
     {
+        FastRandom::shared().addEntropy(analogRead(A0) ^ micros());
         selectEffect(80000 + 100);
         fStatusMillis = millis();
     }
@@ -138,256 +340,82 @@ public:
         {
             timerExpired = true;
             fStatusMillis = currentMillis;
-            fFlipFlop = !fFlipFlop;
             fEffectSeqCount += fEffectSeqDir;
-            randomSeed(analogRead(A0));
         }
 
         int selectSequence = (fDisplayEffectVal % 1000000) / 10000;
         // 100ms - 9s
         int selectSpeed = (fDisplayEffectVal % 10000) / 100;
         int selectLength = (fDisplayEffectVal % 100);
-        int defaultSpeed = 200;
+        if (selectSequence > kCistercian)
+            selectSequence = kNormal;
 
-        switch (selectSequence)
-        {
-            case kNormal:
-            case kSolid:
-            case kToggle:
-                defaultSpeed = 1000;
-                break;
-            case kFlash:
-            case kHorizontalScan:
-            case kVerticalScan:
-            case kExpandSolid:
-            case kExpandHollow:
-            case kForwardQ:
-            case kCollapseSolid:
-            case kCollapseHollow:
-            case kReverseQ:
-            case kLife:
-                break;
-            case kCistercian:
-                defaultSpeed = 1000;
-                break;
-            case kAlert:
-                selectSequence = kForwardQ;
-                defaultSpeed = 100;
-                break;
-            default:
-                selectSequence = kNormal;
-                defaultSpeed = 1000;
-                break;
-        }
         fDisplayEffect = selectSequence;
-        if (fPreviousEffect != fDisplayEffect)
+        bool effectChanged = (fPreviousEffect != fDisplayEffect);
+        if (effectChanged)
         {
+            getEffect(selectSequence, fEffect);
             timerExpired = true;
             fEffectSeqDir = +1;
             fEffectSeqCount = 0;
-            switch (selectSequence)
+            if (fEffect.fFlags & kFlagReverse)
             {
-                case kCollapseSolid:
-                case kCollapseHollow:
-                case kReverseQ:
-                    // move frame to end of sequence
-                    fEffectSeqDir = -1;
-                    fEffectSeqCount = 0x7FFF;
-                    break;
+                // move frame to end of sequence
+                fEffectSeqDir = -1;
+                fEffectSeqCount = 0x7FFF;
             }
-            fPrevEffectSeqCount = 0;
-            fStatusDelay = (selectSpeed) ? 100 * (selectSpeed) : defaultSpeed;
+            fStatusDelay = (selectSpeed) ? 100 * (selectSpeed) : fEffect.fSpeed;
             fEffectStartMillis = currentMillis;
             fEffectLengthMillis = selectLength * 1000;
             fLC.clearAllDisplays();
+            fFrame.clear();
+            fShown.clear();
         }
         unsigned int effectMillis = currentMillis - fEffectStartMillis;
         if (timerExpired)
         {
-            switch (fDisplayEffect)
+            switch (fEffect.fFlags & kEffectTypeMask)
             {
-                case kNormal:
+                case kEffectBlank:
                     /* Do nothing */
                     break;
-                case kSolid:
-                {
-                    if (fPreviousEffect != fDisplayEffect)
-                    {
-                        for (int i = 0; i < 8; i++)
-                            setRow(i, B11111111);
-                    }
-                    break;
-                }
-                case kToggle:
-                {
-                    int i;
-                    for (i = 0; i < 4; i++)
-                        setRow(i, (!fFlipFlop) ? B11111111 : B00000000);
-                    for (; i < 8; i++)
-                        setRow(i, (!fFlipFlop) ? B00000000 : B11111111);
-                    break;
-                }
-                case kFlash:
-                {
-                    if (!fFlipFlop)
-                    {
-                        for (int i = 0; i < 8; i++)
-                            setRow(i, B11111111);
-                    }
-                    else
-                    {
-                        for (int i = 0; i < 8; i++)
-                            setRow(i, B00000000);
-                    }
-                    break;
-                }
-                case kHorizontalScan:
-                {
-                    if (fPrevEffectSeqCount != fEffectSeqCount)
-                        setCol(fPrevEffectSeqCount, 0);
-                    if (fEffectSeqCount > 7)
-                    {
-                        fEffectSeqDir = -1;
-                        fEffectSeqCount += fEffectSeqDir;
-                    }
-                    else if (fEffectSeqCount < 0)
-                    {
-                        fEffectSeqDir = +1;
-                        fEffectSeqCount += fEffectSeqDir;
-                    }
-                    setCol(fEffectSeqCount, 1);
-                    break;
-                }
-                case kVerticalScan:
-                {
-                    if (fPrevEffectSeqCount != fEffectSeqCount)
-                        setRow(fPrevEffectSeqCount, B00000000);
-                    if (fEffectSeqCount > 7)
-                    {
-                        fEffectSeqDir = -1;
-                        fEffectSeqCount += fEffectSeqDir;
-                    }
-                    else if (fEffectSeqCount < 0)
-                    {
-                        fEffectSeqDir = +1;
-                        fEffectSeqCount += fEffectSeqDir;
-                    }
-                    setRow(fEffectSeqCount, B11111111);
+                case kEffectFrames:
+                    fFrame = MagicPanelFrame::fromProgmem(&fEffect.fFrames[nextFrameIndex()]);
                     break;
-                }
-                case kLife:
+                case kEffectLife:
                 {
-                    if (fPreviousEffect != fDisplayEffect)
+                    if (effectChanged)
                     {
                         for (int i = 0; i < 8; i++)
-                            setRow(i, random(255));
-                    }
-                    play();
-                    bool empty = true;
-                    for (int y = 0; y < 8; y++)
-                    {
-                        if (getRow(y) != 0)
-                        {
-                            empty = false;
-                            break;
-                        }
+                            fFrame.setRow(i, fastRandom(255));
                     }
-                    if (empty)
+                    fFrame.life();
+                    if (fFrame.isEmpty())
                     {
                         selectEffect(30000 + 100 + 2);
                     }
                     else
                     {
-                        setPixel(random(8), random(8), 1);
+                        byte x = fastRandom(8);
+                        fFrame.setPixel(x, fastRandom(8), 1);
                     }
                     break;
                 }
-                case kExpandSolid:
-                case kCollapseSolid:
+                case kEffectCistercian:
                 {
-                    const byte* ptr = getFrame_ExpandSolid(fEffectSeqCount, fEffectSeqDir);
-                    for (int i = 0; i < 8; i++, ptr++)
+                    // Overlay the glyph of every non zero digit, 9 glyphs per decimal place
+                    unsigned count = unsigned(fEffectSeqCount) % 10000;
+                    fFrame.clear();
+                    for (byte place = 0; count != 0; place++, count /= 10)
                     {
-                        setRow(i, pgm_read_byte(ptr));
-                    }
-                    break;
-                }
-                case kExpandHollow:
-                case kCollapseHollow:
-                {
-                    const byte* ptr = getFrame_ExpandHollow(fEffectSeqCount, fEffectSeqDir);
-                    for (int i = 0; i < 8; i++, ptr++)
-                    {
-                        setRow(i, pgm_read_byte(ptr));
-                    }
-                    break;
-                }
-                case kForwardQ:
-                case kReverseQ:
-                {
-                    const byte* ptr = getFrame_Q(fEffectSeqCount, fEffectSeqDir);
-                    for (int i = 0; i < 8; i++, ptr++)
-                    {
-                        setRow(i, pgm_read_byte(ptr));
-                    }
-                    break;
-                }
-                case kCistercian:
-                {
-                    unsigned count = fEffectSeqCount;
-                    unsigned thousands = count / 1000;
-                    count -= thousands*1000;
-                    unsigned hundreds = count / 100;
-                    count -= hundreds*100;
-                    unsigned tens = count / 10;
-                    count -= tens*10;
-                    unsigned ones = count;
-                    DEBUG_PRINT(thousands); DEBUG_PRINT(' ');
-                    DEBUG_PRINT(hundreds); DEBUG_PRINT(' ');
-                    DEBUG_PRINT(tens); DEBUG_PRINT(' ');
-                    DEBUG_PRINTLN(ones);
-                    byte frame[8];
-                    memset(frame, '\0', sizeof(frame));
-                    if (thousands != 0)
-                    {
-                        const byte* ptr = getFrame_Cistercian(thousands*1000);
-                        for (int i = 0; i < 8; i++, ptr++)
-                        {
-                            frame[i] |= pgm_read_byte(ptr);
-                        }
-                    }
-                    if (hundreds != 0)
-                    {
-                        const byte* ptr = getFrame_Cistercian(hundreds*100);
-                        for (int i = 0; i < 8; i++, ptr++)
-                        {
-                            frame[i] |= pgm_read_byte(ptr);
-                        }
-                    }
-                    if (tens != 0)
-                    {
-                        const byte* ptr = getFrame_Cistercian(tens*10);
-                        for (int i = 0; i < 8; i++, ptr++)
-                        {
-                            frame[i] |= pgm_read_byte(ptr);
-                        }
-                    }
-                    if (ones != 0)
-                    {
-                        const byte* ptr = getFrame_Cistercian(ones);
-                        for (int i = 0; i < 8; i++, ptr++)
-                        {
-                            frame[i] |= pgm_read_byte(ptr);
-                        }
-                    }
-                    for (int i = 0; i < 8; i++)
-                    {
-                        setRow(i, frame[i]);
+                        byte digit = count % 10;
+                        if (digit != 0)
+                            fFrame.blitOr(MagicPanelFrame::fromProgmem(&fEffect.fFrames[place * 9 + digit - 1]));
                     }
                     break;
                 }
             }
-            fPrevEffectSeqCount = fEffectSeqCount;
+            show();
         }
         if (fEffectLengthMillis > 0 && fEffectLengthMillis < effectMillis)
         {
@@ -396,20 +424,71 @@ public:
         fPreviousEffect = fDisplayEffect;
     }
 
+    /**
+      * Returns the frame buffer shown by the panel
+      */
+    inline const MagicPanelFrame& frame() const
+    {
+        return fFrame;
+    }
+
 private:
+    enum
+    {
+        // Effect types
+        kEffectBlank = 0,
+        kEffectFrames = 1,
+        kEffectLife = 2,
+        kEffectCistercian = 3,
+        kEffectTypeMask = 0x0F,
+
+        // Frame sequence flags
+        kFlagBounce = 0x10,     // play forward and backward instead of wrapping around
+        kFlagReverse = 0x20     // start at the last frame and play backward
+    };
+
+    /**
+      * Precompiled effect stored in PROGMEM
+      */
+    struct Effect
+    {
+        const uint64_t* fFrames;
+        uint8_t fFrameCount;
+        uint8_t fFlags;
+        uint16_t fSpeed;
+    };
+
     LedControl& fLC;
     unsigned long fDisplayEffect;
     unsigned long fPreviousEffect;
-    bool fFlipFlop; 
-    bool fFlipFlopLast;
     unsigned long fStatusDelay;
     unsigned long fStatusMillis;
     int fEffectSeqCount;
     int fEffectSeqDir;
-    int fPrevEffectSeqCount;
     unsigned int fEffectLengthMillis;
     unsigned long fEffectStartMillis;
     unsigned long fDisplayEffectVal;
+    Effect fEffect = {};
+    MagicPanelFrame fFrame;
+    MagicPanelFrame fShown;
+
+    /**
+      * Writes the rows that differ from what is currently shown
+      */
+    void show()
+    {
+        uint64_t changed = fFrame.bits() ^ fShown.bits();
+        if (changed == 0)
+            return;
+        fLC.beginUpdate();
+        for (byte y = 0; y < 8; y++, changed >>= 8)
+        {
+            if (byte(changed) != 0)
+                setRow(y, fFrame.getRow(y));
+        }
+        fLC.endUpdate();
+        fShown = fFrame;
+    }
 
     void setRow(int row, uint8_t bits)
     {
@@ -420,559 +499,524 @@ private:
         fLC.setRow(device, row+1, (byte)(bits & 0XF));
     }
 
-    byte getRow(int y)
-    {
-        y *= 2;
-        byte device = (y / 8);
-        y %= 8;
-        return fLC.getRow(device, y) |
-                fLC.getRow(device, y+1);
-    }
-
-    byte getPixel(int x, int y)
-    {
-        y *= 2;
-        byte device = (y / 8);
-        y %= 8;
-        if (x < 4)
-        {
-            byte bits = fLC.getRow(device, y) >> 4;
-            return ((bits & (1<<(3-x))) != 0);
-        }
-        else
-        {
-            byte bits = fLC.getRow(device, y+1);
-            return ((bits & (1<<(7-x))) != 0);
-        }
-    }
-
-    void setPixel(int x, int y, uint8_t set)
+    /**
+      * Keeps the sequence counter inside the frames of the current effect
+      */
+    unsigned nextFrameIndex()
     {
-        y *= 2;
-        byte device = (y / 8);
-        y %= 8;
-        if (x < 4)
+        int frameCount = fEffect.fFrameCount;
+        if (fEffect.fFlags & kFlagBounce)
         {
-            byte bits = fLC.getRow(device, y) >> 4;
-            bits = (set) ? (bits | (1<<(3-x))) : (bits & ~(1<<(3-x)));
-            bits <<= 4;
-            fLC.setRow(device, y, (byte)((bits >> 4) << 4));
+            if (fEffectSeqCount >= frameCount)
+            {
+                fEffectSeqDir = -1;
+                fEffectSeqCount = frameCount - 1;
+            }
+            else if (fEffectSeqCount < 0)
+            {
+                fEffectSeqDir = +1;
+                fEffectSeqCount = 0;
+            }
         }
-        else
+        else if (unsigned(fEffectSeqCount) >= unsigned(frameCount))
         {
-            byte bits = fLC.getRow(device, y+1);
-            bits = (set) ? (bits | (1<<(7-x))) : (bits & ~(1<<(7-x)));
-            fLC.setRow(device, y+1, (byte)(bits & 0XF));
+            fEffectSeqCount = (fEffectSeqDir > 0) ? 0 : frameCount - 1;
         }
+        return fEffectSeqCount;
     }
 
-    void setCol(int col, uint8_t bit)
+    static void getEffect(unsigned seq, Effect& effect)
     {
-        for (int y = 0; y < 8; y++)
-        {
-            setPixel(col, y, bit);
-        }
-    }
-
-    static const byte* getFrame_Cistercian(unsigned number)
-    {
-        static const byte sFrameData[] PROGMEM = {
-            ///////// 1
-            B00001111,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 2
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001111,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 3
-            B00001000,
-            B00001100,
-            B00001010,
-            B00001001,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 4
-            B00001001,
-            B00001010,
-            B00001100,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 5
-            B00001111,
-            B00001010,
-            B00001100,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 6
-            B00001001,
-            B00001001,
-            B00001001,
-            B00001001,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 7
-            B00001111,
-            B00001001,
-            B00001001,
-            B00001001,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 8
-            B00001001,
-            B00001001,
-            B00001001,
-            B00001111,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 9
-            B00001111,
-            B00001001,
-            B00001001,
-            B00001111,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 10
-            B01111000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 20
-            B00001000,
-            B00001000,
-            B00001000,
-            B01111000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 30
-            B00001000,
-            B00011000,
-            B00101000,
-            B01001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 40
-            B01001000,
-            B00101000,
-            B00011000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 50
-            B01111000,
-            B00101000,
-            B00011000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 60
-            B01001000,
-            B01001000,
-            B01001000,
-            B01001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 70
-            B01111000,
-            B01001000,
-            B01001000,
-            B01001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 80
-            B01001000,
-            B01001000,
-            B01001000,
-            B01111000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 90
-            B01111000,
-            B01001000,
-            B01001000,
-            B01111000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 100
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001111,
-            ///////// 200
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001111,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 300
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001001,
-            B00001010,
-            B00001100,
-            B00001000,
-            ///////// 400
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001100,
-            B00001010,
-            B00001001,
-            ///////// 500
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001100,
-            B00001010,
-            B00001111,
-            ///////// 600
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001001,
-            B00001001,
-            B00001001,
-            B00001001,
-            ///////// 700
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001001,
-            B00001001,
-            B00001001,
-            B00001111,
-            ///////// 800
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001111,
-            B00001001,
-            B00001001,
-            B00001001,
-            ///////// 900
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001111,
-            B00001001,
-            B00001001,
-            B00001111,
-            ///////// 1000
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B01111000,
-            ///////// 2000
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B01111000,
-            B00001000,
-            B00001000,
-            B00001000,
-            ///////// 3000
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B01001000,
-            B00101000,
-            B00011000,
-            B00001000,
-            ///////// 4000
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00011000,
-            B00101000,
-            B01001000,
-            ///////// 5000
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B00011000,
-            B00101000,
-            B01111000,
-            ///////// 6000
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B01001000,
-            B01001000,
-            B01001000,
-            B01001000,
-            ///////// 7000
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B01001000,
-            B01001000,
-            B01001000,
-            B01111000,
-            ///////// 8000
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B01111000,
-            B01001000,
-            B01001000,
-            B01001000,
-            ///////// 9000
-            B00001000,
-            B00001000,
-            B00001000,
-            B00001000,
-            B01111000,
-            B01001000,
-            B01001000,
-            B01111000,
+        static const uint64_t sSolid[] PROGMEM = {
+            0xFFFFFFFFFFFFFFFFULL
         };
-        unsigned ln = log10(number);
-        DEBUG_PRINT("number: "); DEBUG_PRINT(number);
-        if (ln > 0)
-            number /= (ln*10);
-        DEBUG_PRINT(" frame: "); DEBUG_PRINTLN((number-1)+ln*9);
-        return &sFrameData[((number-1)+ln*9)*8];
-    }
-
-    static const byte* getFrame_ExpandSolid(int &frameIndex, int direction)
-    {
-        static const byte sFrameData[] PROGMEM = {
-            B00000000,
-            B00000000,
-            B00000000,
-            B00011000,
-            B00011000,
-            B00000000,
-            B00000000,
-            B00000000,
-            /////////
-            B00000000,
-            B00000000,
-            B00111100,
-            B00111100,
-            B00111100,
-            B00111100,
-            B00000000,
-            B00000000,
-            /////////
-            B00000000,
-            B01111110,
-            B01111110,
-            B01111110,
-            B01111110,
-            B01111110,
-            B01111110,
-            B00000000,
-            /////////
-            B11111111,
-            B11111111,
-            B11111111,
-            B11111111,
-            B11111111,
-            B11111111,
-            B11111111,
-            B11111111
+        static const uint64_t sToggle[] PROGMEM = {
+            MAGIC_PANEL_FRAME(B11111111,
+                              B11111111,
+                              B11111111,
+                              B11111111,
+                              B00000000,
+                              B00000000,
+                              B00000000,
+                              B00000000),
+            MAGIC_PANEL_FRAME(B00000000,
+                              B00000000,
+                              B00000000,
+                              B00000000,
+                              B11111111,
+                              B11111111,
+                              B11111111,
+                              B11111111)
         };
-        unsigned frameCount = sizeof(sFrameData) / 8;
-        if (unsigned(frameIndex) >= frameCount)
-            frameIndex = (direction > 0) ? 0 : frameCount-1;
-        return &sFrameData[frameIndex*8];
-    }
-
-    static const byte* getFrame_ExpandHollow(int &frameIndex, int direction)
-    {
-        static const byte sFrameData[] PROGMEM = {
-            B00000000,
-            B00000000,
-            B00000000,
-            B00011000,
-            B00011000,
-            B00000000,
-            B00000000,
-            B00000000,
-            /////////
-            B00000000,
-            B00000000,
-            B00111100,
-            B00100100,
-            B00100100,
-            B00111100,
-            B00000000,
-            B00000000,      
-            /////////
-            B00000000,
-            B01111110,
-            B01000010,
-            B01000010,
-            B01000010,
-            B01000010,
-            B01111110,
-            B00000000,
-            /////////
-            B11111111,
-            B10000001,
-            B10000001,
-            B10000001,
-            B10000001,
-            B10000001,
-            B10000001,
-            B11111111,
-            /////////
-            B00000000,
-            B00000000,
-            B00000000,
-            B00000000,
-            B00000000,
-            B00000000,
-            B00000000,
-            B00000000
+        static const uint64_t sFlash[] PROGMEM = {
+            0xFFFFFFFFFFFFFFFFULL,
+            0x0000000000000000ULL
         };
-        unsigned frameCount = sizeof(sFrameData) / 8;
-        if (unsigned(frameIndex) >= frameCount)
-            frameIndex = (direction > 0) ? 0 : frameCount-1;
-        return &sFrameData[frameIndex*8];
-    }
-
-    static const byte* getFrame_Q(int &frameIndex, int direction)
-    {
-        static const byte sFrameData[] PROGMEM = {
-            B00001111,
-            B00001111,
-            B00001111,
-            B00001111,
-            B11110000,
-            B11110000,
-            B11110000,
-            B11110000,
-            /////////
-            B11110000,
-            B11110000,
-            B11110000,
-            B11110000,
-            B00001111,
-            B00001111,
-            B00001111,
-            B00001111
+        // One column at a time
+        static const uint64_t sHorizontalScan[] PROGMEM = {
+            0x8080808080808080ULL,
+            0x4040404040404040ULL,
+            0x2020202020202020ULL,
+            0x1010101010101010ULL,
+            0x0808080808080808ULL,
+            0x0404040404040404ULL,
+            0x0202020202020202ULL,
+            0x0101010101010101ULL
         };
-        unsigned frameCount = sizeof(sFrameData) / 8;
-        if (unsigned(frameIndex) >= frameCount)
-            frameIndex = (direction > 0) ? 0 : frameCount-1;
-        return &sFrameData[frameIndex*8];
-    }
-
-    static inline int wrap(int i, int a)
-    {
-        i += a;
-        while (i < 0)
-            i += 8;
-        while (i >= 8)
-            i -= 8;
-        return i;
-    }
-
-    void play()
-    {
-        byte newbits[8];
-        for (int y = 0; y < 8; y++)
-        {
-            newbits[y] = 0;
-            for (int x = 0; x < 8; x++)
-            {
-                int a = 0;
-                for (int k = -1; k <= 1; k++)
-                {
-                    for (int l = -1; l <= 1; l++)
-                    {
-                        if (k || l)
-                        {
-                            a += getPixel(wrap(x, k), wrap(y, l));
-                        }
-                    }
-                }
-                if (a == 2) newbits[y] |= (getPixel(x, y)<<(7-x));
-                if (a == 3) newbits[y] |= (1<<(7-x));
-            }
-        }
-        for (int y = 0; y < 8; y++)
-        {
-            setRow(y, newbits[y]);
-        }
+        // One row at a time
+        static const uint64_t sVerticalScan[] PROGMEM = {
+            0x00000000000000FFULL,
+            0x000000000000FF00ULL,
+            0x0000000000FF0000ULL,
+            0x00000000FF000000ULL,
+            0x000000FF00000000ULL,
+            0x0000FF0000000000ULL,
+            0x00FF000000000000ULL,
+            0xFF00000000000000ULL
+        };
+        static const uint64_t sExpandSolid[] PROGMEM = {
+            MAGIC_PANEL_FRAME(B00000000,
+                              B00000000,
+                              B00000000,
+                              B00011000,
+                              B00011000,
+                              B00000000,
+                              B00000000,
+                              B00000000),
+            MAGIC_PANEL_FRAME(B00000000,
+                              B00000000,
+                              B00111100,
+                              B00111100,
+                              B00111100,
+                              B00111100,
+                              B00000000,
+                              B00000000),
+            MAGIC_PANEL_FRAME(B00000000,
+                              B01111110,
+                              B01111110,
+                              B01111110,
+                              B01111110,
+                              B01111110,
+                              B01111110,
+                              B00000000),
+            MAGIC_PANEL_FRAME(B11111111,
+                              B11111111,
+                              B11111111,
+                              B11111111,
+                              B11111111,
+                              B11111111,
+                              B11111111,
+                              B11111111)
+        };
+        static const uint64_t sExpandHollow[] PROGMEM = {
+            MAGIC_PANEL_FRAME(B00000000,
+                              B00000000,
+                              B00000000,
+                              B00011000,
+                              B00011000,
+                              B00000000,
+                              B00000000,
+                              B00000000),
+            MAGIC_PANEL_FRAME(B00000000,
+                              B00000000,
+                              B00111100,
+                              B00100100,
+                              B00100100,
+                              B00111100,
+                              B00000000,
+                              B00000000),
+            MAGIC_PANEL_FRAME(B00000000,
+                              B01111110,
+                              B01000010,
+                              B01000010,
+                              B01000010,
+                              B01000010,
+                              B01111110,
+                              B00000000),
+            MAGIC_PANEL_FRAME(B11111111,
+                              B10000001,
+                              B10000001,
+                              B10000001,
+                              B10000001,
+                              B10000001,
+                              B10000001,
+                              B11111111),
+            MAGIC_PANEL_FRAME(B00000000,
+                              B00000000,
+                              B00000000,
+                              B00000000,
+                              B00000000,
+                              B00000000,
+                              B00000000,
+                              B00000000)
+        };
+        static const uint64_t sQ[] PROGMEM = {
+            MAGIC_PANEL_FRAME(B00001111,
+                              B00001111,
+                              B00001111,
+                              B00001111,
+                              B11110000,
+                              B11110000,
+                              B11110000,
+                              B11110000),
+            MAGIC_PANEL_FRAME(B11110000,
+                              B11110000,
+                              B11110000,
+                              B11110000,
+                              B00001111,
+                              B00001111,
+                              B00001111,
+                              B00001111)
+        };
+        // Digits 1-9 for ones, tens, hundreds and thousands
+        static const uint64_t sCistercian[] PROGMEM = {
+            // 1
+            MAGIC_PANEL_FRAME(B00001111,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 2
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001111,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 3
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001100,
+                              B00001010,
+                              B00001001,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 4
+            MAGIC_PANEL_FRAME(B00001001,
+                              B00001010,
+                              B00001100,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 5
+            MAGIC_PANEL_FRAME(B00001111,
+                              B00001010,
+                              B00001100,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 6
+            MAGIC_PANEL_FRAME(B00001001,
+                              B00001001,
+                              B00001001,
+                              B00001001,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 7
+            MAGIC_PANEL_FRAME(B00001111,
+                              B00001001,
+                              B00001001,
+                              B00001001,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 8
+            MAGIC_PANEL_FRAME(B00001001,
+                              B00001001,
+                              B00001001,
+                              B00001111,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 9
+            MAGIC_PANEL_FRAME(B00001111,
+                              B00001001,
+                              B00001001,
+                              B00001111,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 10
+            MAGIC_PANEL_FRAME(B01111000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 20
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B01111000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 30
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00011000,
+                              B00101000,
+                              B01001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 40
+            MAGIC_PANEL_FRAME(B01001000,
+                              B00101000,
+                              B00011000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 50
+            MAGIC_PANEL_FRAME(B01111000,
+                              B00101000,
+                              B00011000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 60
+            MAGIC_PANEL_FRAME(B01001000,
+                              B01001000,
+                              B01001000,
+                              B01001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 70
+            MAGIC_PANEL_FRAME(B01111000,
+                              B01001000,
+                              B01001000,
+                              B01001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 80
+            MAGIC_PANEL_FRAME(B01001000,
+                              B01001000,
+                              B01001000,
+                              B01111000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 90
+            MAGIC_PANEL_FRAME(B01111000,
+                              B01001000,
+                              B01001000,
+                              B01111000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 100
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001111),
+            // 200
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001111,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 300
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001001,
+                              B00001010,
+                              B00001100,
+                              B00001000),
+            // 400
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001100,
+                              B00001010,
+                              B00001001),
+            // 500
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001100,
+                              B00001010,
+                              B00001111),
+            // 600
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001001,
+                              B00001001,
+                              B00001001,
+                              B00001001),
+            // 700
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001001,
+                              B00001001,
+                              B00001001,
+                              B00001111),
+            // 800
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001111,
+                              B00001001,
+                              B00001001,
+                              B00001001),
+            // 900
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001111,
+                              B00001001,
+                              B00001001,
+                              B00001111),
+            // 1000
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B01111000),
+            // 2000
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B01111000,
+                              B00001000,
+                              B00001000,
+                              B00001000),
+            // 3000
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B01001000,
+                              B00101000,
+                              B00011000,
+                              B00001000),
+            // 4000
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00011000,
+                              B00101000,
+                              B01001000),
+            // 5000
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B00011000,
+                              B00101000,
+                              B01111000),
+            // 6000
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B01001000,
+                              B01001000,
+                              B01001000,
+                              B01001000),
+            // 7000
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B01001000,
+                              B01001000,
+                              B01001000,
+                              B01111000),
+            // 8000
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B01111000,
+                              B01001000,
+                              B01001000,
+                              B01001000),
+            // 9000
+            MAGIC_PANEL_FRAME(B00001000,
+                              B00001000,
+                              B00001000,
+                              B00001000,
+                              B01111000,
+                              B01001000,
+                              B01001000,
+                              B01111000)
+        };
+        #define MAGIC_PANEL_EFFECT(frames, flags, speed) \
+            { frames, SizeOfArray(frames), flags, speed }
+        static const Effect sEffects[] PROGMEM = {
+            /* kNormal */           { nullptr, 0, kEffectBlank, 1000 },
+            /* kSolid */            MAGIC_PANEL_EFFECT(sSolid, kEffectFrames, 1000),
+            /* kToggle */           MAGIC_PANEL_EFFECT(sToggle, kEffectFrames, 1000),
+            /* kFlash */            MAGIC_PANEL_EFFECT(sFlash, kEffectFrames, 200),
+            /* kAlert */            MAGIC_PANEL_EFFECT(sQ, kEffectFrames, 100),
+            /* kHorizontalScan */   MAGIC_PANEL_EFFECT(sHorizontalScan, kEffectFrames | kFlagBounce, 200),
+            /* kVerticalScan */     MAGIC_PANEL_EFFECT(sVerticalScan, kEffectFrames | kFlagBounce, 200),
+            /* kLife */             { nullptr, 0, kEffectLife, 200 },
+            /* kExpandSolid */      MAGIC_PANEL_EFFECT(sExpandSolid, kEffectFrames, 200),
+            /* kCollapseSolid */    MAGIC_PANEL_EFFECT(sExpandSolid, kEffectFrames | kFlagReverse, 200),
+            /* kExpandHollow */     MAGIC_PANEL_EFFECT(sExpandHollow, kEffectFrames, 200),
+            /* kCollapseHollow */   MAGIC_PANEL_EFFECT(sExpandHollow, kEffectFrames | kFlagReverse, 200),
+            /* kForwardQ */         MAGIC_PANEL_EFFECT(sQ, kEffectFrames, 200),
+            /* kReverseQ */         MAGIC_PANEL_EFFECT(sQ, kEffectFrames | kFlagReverse, 200),
+            /* kCistercian */       MAGIC_PANEL_EFFECT(sCistercian, kEffectCistercian, 1000)
+        };
+        #undef MAGIC_PANEL_EFFECT
+        static_assert(SizeOfArray(sEffects) == kCistercian + 1, "Missing effect");
+        memcpy_P(&effect, &sEffects[(seq < SizeOfArray(sEffects)) ? seq : unsigned(kNormal)], sizeof(effect));
     }
 };
 
@@ -8,6 +8,120 @@
 #include "core/AnimatedEvent.h"
 #include "core/LedControlMAX7221.h"
 
+/// \private
+/**
+  * Frame buffer of a Teeces logic display packed in the layout of its MAX7221 devices.
+  * Each device drives a 5 x 9 section of the logical grid. Columns 0-7 map to the bits of
+  * device rows 0-4 (column 0 is the MSB) and column 8 maps to device row 5 (row 0 is the MSB).
+  * Random patterns are generated a 32-bit word at a time from a FastRandom stream.
+  */
+template <byte numDevices>
+class TeecesLogicsFrame
+{
+public:
+    enum
+    {
+        kRows = 5,
+        kColumns = 9 * numDevices
+    };
+
+    void seed(uint32_t seed)
+    {
+        fRandom.setSeed(seed);
+    }
+
+    void clear()
+    {
+        for (byte i = 0; i < SizeOfArray(fWords); i++)
+            fWords[i] = 0;
+    }
+
+    void setPixel(byte row, byte col, bool on)
+    {
+        byte dev = col / 9;
+        byte bit = col % 9;
+        if (row >= kRows || dev >= numDevices)
+            return;
+        byte* bits = &fRows[dev][(bit < 8) ? row : byte(kRows)];
+        byte mask = 0x80 >> ((bit < 8) ? bit : row);
+        if (on)
+            *bits |= mask;
+        else
+            *bits &= ~mask;
+    }
+
+    /** Set a grid row from a bit mask with column 0 in bit 0 */
+    void setRow(byte row, uint32_t bits)
+    {
+        if (row >= kRows)
+            return;
+        for (byte dev = 0; dev < numDevices; dev++, bits >>= 9)
+        {
+            fRows[dev][row] = rev(bits);
+            if ((bits & (1L<<8)) != 0)
+                fRows[dev][kRows] |= 0x80 >> row;
+            else
+                fRows[dev][kRows] &= ~(0x80 >> row);
+        }
+    }
+
+    void setCol(byte col, uint8_t data)
+    {
+        for (byte row = 0; row < kRows; row++)
+            setPixel(kRows - 1 - row, col, (data & (1<<row)) != 0);
+    }
+
+    /**
+      * Fill all device rows with random bits. Every bit is the OR of density+1 random
+      * bits plus one more for a random half of the rows, the higher the density the more
+      * LEDs are on.
+      */
+    void randomize(byte density)
+    {
+        for (byte i = 0; i < SizeOfArray(fWords); i++)
+        {
+            uint32_t bits = fRandom.next();
+            for (byte j = 0; j < density; j++)
+                bits |= fRandom.next();
+            // Expand one random bit per byte lane to a mask selecting the rows
+            bits |= fRandom.next() & ((fRandom.next() & 0x01010101UL) * 0xFF);
+            fWords[i] = bits;
+        }
+    }
+
+    /** Send the frame to the devices starting at firstDevice. Only changed rows are sent. */
+    void show(LedControl& lc, byte firstDevice)
+    {
+        lc.beginUpdate();
+        for (byte dev = 0; dev < numDevices; dev++)
+        {
+            for (byte row = 0; row <= kRows; row++)
+                lc.setRow(firstDevice + dev, row, fRows[dev][row]);
+        }
+        lc.endUpdate();
+    }
+
+private:
+    FastRandom fRandom;
+    union
+    {
+        byte fRows[numDevices][kRows + 1];
+        uint32_t fWords[(numDevices * (kRows + 1) + 3) / 4];
+    };
+
+    static uint8_t rev(uint8_t n)
+    {
+        // byte reversal fast RAM lookup table
+        static uint8_t revlookup[] = {
+            0x0, 0x8, 0x4, 0xC,
+            0x2, 0xA, 0x6, 0xE,
+            0x1, 0x9, 0x5, 0xD,
+            0x3, 0xB, 0x7, 0xF
+        };
+        return (revlookup[n & 0x0F] << 4) | revlookup[n >> 4];
+    }
+};
+
 /**
   * \ingroup Dome
   *
@@ -46,18 +160,20 @@ public:
 
     int numRows() const
     {
-        return SizeOfArray(LEDgrid);
+        return fFrame.kRows;
     }
 
     int numColumns() const
     {
-        return 27;
+        return fFrame.kColumns;
     }
 
     virtual void setup() override
     {
         fLC.setPower(fID, true, NUMDEVICES);
         fLC.setIntensity(fID, 5, NUMDEVICES);
+        FastRandom::shared().addEntropy(analogRead(A0) ^ micros());
+        fFrame.seed(FastRandom::shared().next());
 
         selectEffect(10000);
         fStatusMillis = millis();
@@ -92,7 +208,6 @@ public:
             fStatusMillis = currentMillis;
             fFlipFlop = !fFlipFlop;
             fEffectSeqCount += fEffectSeqDir;
-            randomSeed(analogRead(A0));
         }
 
         int selectSequence = (fDisplayEffectVal % 1000000) / 10000;
@@ -131,7 +246,7 @@ public:
         unsigned int effectMillis = currentMillis - fEffectStartMillis;
         if (timerExpired)
         {
-            clear();
+            fFrame.clear();
             switch (fDisplayEffect)
             {
                 case kNormal:
@@ -139,11 +254,7 @@ public:
                     break;
                 case kSolid:
                 {
-                    for (int dev = 0; dev < 3; dev++)
-                    {
-                       for (int row = 0; row < 6; row++)
-                            fLC.setRowNoCache(fID+dev, row, randomRow(2));
-                    }
+                    fFrame.randomize(2);
                     break;
                 }
                 // case kToggle:
@@ -242,13 +353,13 @@ public:
                 // }
             }
             fPrevEffectSeqCount = fEffectSeqCount;
+            fFrame.show(fLC, fID);
         }
         if (fEffectLengthMillis > 0 && fEffectLengthMillis < effectMillis)
         {
             selectEffect(kNormalVal); //go back to normal operation if its time
         }
         fPreviousEffect = fDisplayEffect;
-        // show();
     }
 
     enum
@@ -285,81 +396,7 @@ private:
     unsigned int fEffectLengthMillis;
     unsigned long fEffectStartMillis;
     unsigned long fDisplayEffectVal;
-    unsigned long LEDgrid[5]; 
-
-    void setRow(byte row, uint32_t bits)
-    {
-        if (row < SizeOfArray(LEDgrid))
-            LEDgrid[row] = bits;
-    }
-
-    void clear()
-    {
-        for (byte row = 0; row < SizeOfArray(LEDgrid); row++)
-        {
-            LEDgrid[row] = 0L;
-        }
-    }
-
-    void setCol(byte col, uint8_t data)
-    {
-        for (byte row = 0; row < SizeOfArray(LEDgrid); row++)
-        {
-           // test if LED is on
-            byte LEDon = (data & 1<<row);
-            if (LEDon)
-                LEDgrid[4-row] |= (1L << col);  // set column bit
-            else
-                LEDgrid[4-row] &= ~(1L << col); // reset column bit
-        }
-    }
-
-    static uint8_t rev(uint8_t n)
-    {
-        // byte reversal fast RAM lookup table
-        static uint8_t revlookup[] = {
-            0x0, 0x8, 0x4, 0xC,
-            0x2, 0xA, 0x6, 0xE,
-            0x1, 0x9, 0x5, 0xD,
-            0x3, 0xB, 0x7, 0xF
-        };
-        return (revlookup[n & 0x0F] << 4) | revlookup[n >> 4];
-    }
-
-    byte randomRow(int loop)
-    {
-        loop += random(2);
-        byte val = random(256);
-        while (loop-- > 0)
-            val |= random(256);
-        return (random(2) == 1) ? rev(val) : val;
-    }
-
-    void show()
-    {
-        // Every 9th column of the displays maps to the 6th row of the Maxim chip
-        unsigned char col8 = 0;  // 9th column of FLDs and RLD, maps to 6th row of device 0
-        unsigned char col17 = 0; // 18th column of RLD, goes to 6th row of RLD device 1
-        unsigned char col26 = 0; // 27th column of RLD, goes to 6th row of RLD device 2 
-
-        // Colums 0-7 map with a byte reversal
-        for (byte row = 0; row < SizeOfArray(LEDgrid); row++)
-        {
-            for (int dev = 0; dev < 3; dev++) // RLD has 3 Maxim chip devices
-            {
-                // extract byte at column 0, 9 and 18, reverse byte order, and send to device
-                fLC.setRowNoCache(fID+dev, row, rev((LEDgrid[row] & 255L << (9 * dev)) >> (9 * dev)));
-            }
-            // If the LED at column 8, 17 or 26 is on, add it to the extra row (starting "left" at MSB)
-            if ((LEDgrid[row] & 1L<<8) == 1L<<8)   col8 += 128 >> row;
-            if ((LEDgrid[row] & 1L<<17) == 1L<<17) col17 += 128 >> row;
-            if ((LEDgrid[row] & 1L<<26) == 1L<<26) col26 += 128 >> row;
-        }
-        // send the extra columns as a 6th row or the Maxim (logical row 5)
-        fLC.setRowNoCache(fID+0, 5, col8);
-        fLC.setRowNoCache(fID+1, 5, col17);
-        fLC.setRowNoCache(fID+2, 5, col26);
-    }
+    TeecesLogicsFrame<NUMDEVICES> fFrame;
 };
 
 /**
@@ -402,18 +439,20 @@ public:
 
     int numRows() const
     {
-        return SizeOfArray(LEDgrid);
+        return fFrame.kRows;
     }
 
     int numColumns() const
     {
-        return 27;
+        return fFrame.kColumns;
     }
 
     virtual void setup() override
     {
         fLC.setPower(fID, true);
         fLC.setIntensity(fID, 5);
+        FastRandom::shared().addEntropy(analogRead(A0) ^ micros());
+        fFrame.seed(FastRandom::shared().next());
 
         selectEffect(10000);
         fStatusMillis = millis();
@@ -456,7 +495,6 @@ public:
             fStatusMillis = currentMillis;
             fFlipFlop = !fFlipFlop;
             fEffectSeqCount += fEffectSeqDir;
-            randomSeed(analogRead(A0));
         }
 
         int selectSequence = (fDisplayEffectVal % 1000000) / 10000;
@@ -495,7 +533,7 @@ public:
         unsigned int effectMillis = currentMillis - fEffectStartMillis;
         if (timerExpired)
         {
-            clear();
+            fFrame.clear();
             switch (fDisplayEffect)
             {
                 case kNormal:
@@ -503,11 +541,7 @@ public:
                     break;
                 case kSolid:
                 {
-                    for (int dev = 0; dev < 3; dev++)
-                    {
-                       for (int row = 0; row < 6; row++)
-                            fLC.setRowNoCache(fID+dev, row, randomRow(2));
-                    }
+                    fFrame.randomize(2);
                     break;
                 }
                 // case kToggle:
@@ -606,13 +640,13 @@ public:
                 // }
             }
             fPrevEffectSeqCount = fEffectSeqCount;
+            fFrame.show(fLC, fID);
         }
         if (fEffectLengthMillis > 0 && fEffectLengthMillis < effectMillis)
         {
             selectEffect(kNormalVal); //go back to normal operation if its time
         }
         fPreviousEffect = fDisplayEffect;
-        // show();
     }
 
     enum
@@ -634,6 +668,7 @@ public:
     };
 
 private:
+    static const byte NUMDEVICES = 1;
     LedControl& fLC;
     byte fID;
     unsigned long fDisplayEffect;
@@ -648,81 +683,7 @@ private:
     unsigned int fEffectLengthMillis;
     unsigned long fEffectStartMillis;
     unsigned long fDisplayEffectVal;
-    unsigned long LEDgrid[5]; 
-
-    void setRow(byte row, uint32_t bits)
-    {
-        if (row < SizeOfArray(LEDgrid))
-            LEDgrid[row] = bits;
-    }
-
-    void clear()
-    {
-        for (byte row = 0; row < SizeOfArray(LEDgrid); row++)
-        {
-            LEDgrid[row] = 0L;
-        }
-    }
-
-    void setCol(byte col, uint8_t data)
-    {
-        for (byte row = 0; row < SizeOfArray(LEDgrid); row++)
-        {
-           // test if LED is on
-            byte LEDon = (data & 1<<row);
-            if (LEDon)
-                LEDgrid[4-row] |= (1L << col);  // set column bit
-            else
-                LEDgrid[4-row] &= ~(1L << col); // reset column bit
-        }
-    }
-
-    static uint8_t rev(uint8_t n)
-    {
-        // byte reversal fast RAM lookup table
-        static uint8_t revlookup[] = {
-            0x0, 0x8, 0x4, 0xC,
-            0x2, 0xA, 0x6, 0xE,
-            0x1, 0x9, 0x5, 0xD,
-            0x3, 0xB, 0x7, 0xF
-        };
-        return (revlookup[n & 0x0F] << 4) | revlookup[n >> 4];
-    }
-
-    byte randomRow(int loop)
-    {
-        loop += random(2);
-        byte val = random(256);
-        while (loop-- > 0)
-            val |= random(256);
-        return (random(2) == 1) ? rev(val) : val;
-    }
-
-    void show()
-    {
-        // Every 9th column of the displays maps to the 6th row of the Maxim chip
-        unsigned char col8 = 0;  // 9th column of FLDs and RLD, maps to 6th row of device 0
-        unsigned char col17 = 0; // 18th column of RLD, goes to 6th row of RLD device 1
-        unsigned char col26 = 0; // 27th column of RLD, goes to 6th row of RLD device 2 
-
-        // Colums 0-7 map with a byte reversal
-        for (byte row = 0; row < SizeOfArray(LEDgrid); row++)
-        {
-            for (int dev = 0; dev < 3; dev++) // RLD has 3 Maxim chip devices
-            {
-                // extract byte at column 0, 9 and 18, reverse byte order, and send to device
-                fLC.setRowNoCache(fID+dev, row, rev((LEDgrid[row] & 255L << (9 * dev)) >> (9 * dev)));
-            }
-            // If the LED at column 8, 17 or 26 is on, add it to the extra row (starting "left" at MSB)
-            if ((LEDgrid[row] & 1L<<8) == 1L<<8)   col8 += 128 >> row;
-            if ((LEDgrid[row] & 1L<<17) == 1L<<17) col17 += 128 >> row;
-            if ((LEDgrid[row] & 1L<<26) == 1L<<26) col26 += 128 >> row;
-        }
-        // send the extra columns as a 6th row or the Maxim (logical row 5)
-        fLC.setRowNoCache(fID+0, 5, col8);
-        fLC.setRowNoCache(fID+1, 5, col17);
-        fLC.setRowNoCache(fID+2, 5, col26);
-    }
+    TeecesLogicsFrame<NUMDEVICES> fFrame;
 };
 
 /**
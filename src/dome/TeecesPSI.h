@@ -3,6 +3,7 @@
 #define TeecesPSI_h
 
 #include "ReelTwo.h"
+#include "core/FastRandom.h"
 #include "core/SetupEvent.h"
 #include "core/AnimatedEvent.h"
 #include "core/JawaEvent.h"
@@ -27,9 +28,9 @@ public:
         fID(ledControl.addDevice()),
         fState(0),
         fPauseTime(0),
-        fPause(1000+2000*random(3)),
+        fPause(1000+2000*fastRandom(3)),
         fAnimate(true),
-        fDelay(50 + random(3) * 25),
+        fDelay(50 + fastRandom(3) * 25),
         fStuck(15)
     {
         JawaID addr = kJawaOther;
@@ -163,11 +164,11 @@ public:
             else
             {
                 //we're pausing
-                fPauseTime = random(fPause);
+                fPauseTime = fastRandom(fPause);
                 //decide if we're going to get 'stuck'
-                if (random(100) <= fStuck)
+                if (fastRandom(100) <= fStuck)
                 {
-                    fState = (fState == 0) ? random(1, 3) : random(3, 5);
+                    fState = (fState == 0) ? fastRandom(1, 3) : fastRandom(3, 5);
                 }
             }
             setState(fState);
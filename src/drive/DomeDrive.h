@@ -222,9 +222,59 @@ public:
         fUseLeftStick = false;
     }
 
+    enum MotionProfile
+    {
+        kLinearProfile,
+        kTrapezoidalProfile,
+        kSCurveProfile
+    };
+
+    MotionProfile getMotionProfile() const
+    {
+        return fMotionProfile;
+    }
+
+    /**
+      * Select how the speed ramps down within the deceleration window (getThrottleDecelerationScale()
+      * degrees) when moving to a target position.
+      */
+    void setMotionProfile(MotionProfile profile)
+    {
+        fMotionProfile = profile;
+    }
+
+    bool getPredictive() const
+    {
+        return fPredictive;
+    }
+
+    /**
+      * When enabled the dome brakes early based on its position predicted from the measured
+      * velocity, the position sensor latency and the serial command latency. Disabled by default.
+      */
+    void setPredictive(bool predictive)
+    {
+        fPredictive = predictive;
+    }
+
+    uint32_t getMotorRefreshInterval() const
+    {
+        return fMotorRefreshInterval;
+    }
+
+    /**
+      * Only resend an unchanged motor command after this many milliseconds. Zero sends the
+      * motor command on every update.
+      */
+    void setMotorRefreshInterval(uint32_t ms)
+    {
+        fMotorRefreshInterval = ms;
+    }
+
     virtual void stop()
     {
         fMotorStopped = true;
+        fLastMotorValid = false;
         fDrive = 0;
         fAutoDrive = 0;
         fMoving = false;
@@ -301,38 +351,14 @@ protected:
         return 0.0f;
     }
 
-    static bool withinArc(double p1, double p2, double p3)
-    {
-        return fmod(p2 - p1 + 2*360, 360) >= fmod(p3 - p1 + 2*360, 360);
-    }
-
-    int normalize(int degrees)
+    static bool withinArc(long p1, long p2, long p3)
     {
-        degrees = fmod(degrees, 360);
-        if (degrees < 0)
-            degrees += 360;
-        return degrees;
+        return DomePosition::withinArc(p1, p2, p3);
     }
 
-    int shortestDistance(int origin, int target)
+    static int normalize(int degrees)
     {
-        int result = 0.0;
-        int diff = fmod(fmod(abs(origin - target), 360), 360);
-
-        if (diff > 180)
-        {
-            //There is a shorter path in opposite direction
-            result = (360 - diff);
-            if (target > origin)
-                result *= -1;
-        }
-        else
-        {
-            result = diff;
-            if (origin > target)
-                result *= -1;
-        }
-        return result;
+        return DomePosition::normalize(degrees);
     }
 
     float getSpeed(float percentage)
@@ -342,17 +368,51 @@ protected:
         return getMaxSpeed() * percentage;
     }
 
+    /**
+      * Scale factor for the speed when dist degrees remain to the target. Inside the
+      * deceleration window the speed follows the selected motion profile down to zero.
+      */
+    float profileScale(int dist)
+    {
+        float decelerationScale = getThrottleDecelerationScale();
+        if (dist >= decelerationScale || decelerationScale <= 0)
+            return 1.0f;
+        if (dist <= 0)
+            return 0.0f;
+        float r = dist / decelerationScale;
+        switch (fMotionProfile)
+        {
+            case kTrapezoidalProfile:
+                // Constant deceleration: velocity is proportional to sqrt of the remaining distance
+                return sqrtf(r);
+            case kSCurveProfile:
+                // Smoothstep eases both into and out of the deceleration
+                return r * r * (3 - 2 * r);
+            case kLinearProfile:
+            default:
+                return r;
+        }
+    }
+
     bool moveDomeToTarget(int pos, int target, int fudge, float speed, float &m)
     {
         if (!withinArc(target - fudge, target + fudge, pos))
         {
-            int dist = shortestDistance(pos, target);
-            float decelerationScale = getThrottleDecelerationScale();
-            if (abs(dist) <= decelerationScale)
-                speed *= (abs(dist) / decelerationScale);
-            speed = getSpeed(speed);
+            // Position once the next motor command takes effect
+            int predicted = (fPredictive && fDomePosition != nullptr) ?
+                fDomePosition->getPredictedDomePosition(fSerialLatency) : pos;
+            int dist = DomePosition::shortestDistance(pos, target);
+            int remaining = DomePosition::shortestDistance(predicted, target);
+            if ((remaining < 0) != (dist < 0) || withinArc(target - fudge, target + fudge, predicted))
+            {
+                // Dome will coast onto or past the target: brake now
+                remaining = 0;
+            }
+            speed *= profileScale(abs(remaining));
+            speed = (speed > 0) ? getSpeed(speed) : 0;
             VERBOSE_DOME_DEBUG_PRINT("POS: "); VERBOSE_DOME_DEBUG_PRINT(pos);
             VERBOSE_DOME_DEBUG_PRINT(" DST: "); VERBOSE_DOME_DEBUG_PRINT(dist);
+            VERBOSE_DOME_DEBUG_PRINT(" REM: "); VERBOSE_DOME_DEBUG_PRINT(remaining);
             VERBOSE_DOME_DEBUG_PRINT(" SPD: "); VERBOSE_DOME_DEBUG_PRINTLN(speed);
             if (dist > 0)
             {
@@ -369,14 +429,16 @@ protected:
 
     void domeStick(JoystickController* stick, float speedModifier)
     {
+        JoystickController::State state;
+        stick->getSnapshot(state);
         fWasConnected = true;
         if (!fEnabled)
         {
             stop();
         }
         else if (useHardStop() &&
-                ((useLeftStick() && stick->state.button.l1) ||
-                 (useRightStick() && stick->state.button.r1)))
+                ((useLeftStick() && state.button.l1) ||
+                 (useRightStick() && state.button.r1)))
         {
             if (!fMotorStopped)
             {
@@ -389,7 +451,7 @@ protected:
             uint32_t currentMillis = millis();
             if (currentMillis - fLastCommand > fSerialLatency)
             {
-                auto stickx = useLeftStick() ? stick->state.analog.stick.lx : stick->state.analog.stick.rx;
+                auto stickx = useLeftStick() ? state.analog.stick.lx : state.analog.stick.rx;
                 auto drive_mod = throttleSpeed(speedModifier);
                 auto m = (float)(stickx + 128) / 127.5f - 1.0f;
 
@@ -569,12 +631,7 @@ protected:
                                     int dist = abs(relativeDegrees - fDomePosition->getRelativeDegrees());
                                     if (abs(fDomePosition->getRelativeDegrees()) < abs(relativeDegrees))
                                     {
-                                        float decelerationScale = getThrottleDecelerationScale();
-                                        if (dist <= decelerationScale)
-                                        {
-                                            speed *= (dist / decelerationScale);
-                                        }
-                                        speed = getSpeed(speed);
+                                        speed = getSpeed(speed * profileScale(dist));
                                         if (relativeDegrees > 0)
                                         {
                                             m = -speed;
@@ -670,7 +727,16 @@ protected:
                         }
                     }
                 }
-                motor(getInverted() ? -m : m);
+                float out = getInverted() ? -m : m;
+                if (!fLastMotorValid || out != fLastMotor || fMotorRefreshInterval == 0 ||
+                    currentMillis - fLastMotorMS >= fMotorRefreshInterval)
+                {
+                    motor(out);
+                    stick->recordInputLatency();
+                    fLastMotor = out;
+                    fLastMotorMS = currentMillis;
+                    fLastMotorValid = true;
+                }
                 fLastCommand = currentMillis;
                 fMoving = (abs(m) != 0.0);
                 fMotorStopped = false;
@@ -703,6 +769,12 @@ protected:
     int fLastDomePosition = -1;
     uint32_t fSerialLatency = 0;
     uint32_t fLastCommand = 0;
+    MotionProfile fMotionProfile = kLinearProfile;
+    bool fPredictive = false;
+    bool fLastMotorValid = false;
+    float fLastMotor = 0;
+    uint32_t fLastMotorMS = 0;
+    uint32_t fMotorRefreshInterval = 0;
     uint32_t fLastDomeMovement = 0;
     bool fDomeMovementStarted = false;
     unsigned fThrottleAccelerationScale = 0;
@@ -182,25 +182,13 @@ public:
         return fDomeRelativeTargetPos;
     }
 
-    int shortestDistance(int origin, int target)
+    /**
+      * Signed shortest distance in degrees from origin to target in the range -180 to 180
+      */
+    static int shortestDistance(int origin, int target)
     {
-        int result = 0.0;
-        int diff = fmod(fmod(abs(origin - target), 360), 360);
-
-        if (diff > 180)
-        {
-            //There is a shorter path in opposite direction
-            result = (360 - diff);
-            if (target > origin)
-                result *= -1;
-        }
-        else
-        {
-            result = diff;
-            if (origin > target)
-                result *= -1;
-        }
-        return result;
+        int diff = (int)normalize(long(target) - long(origin));
+        return (diff > 180) ? diff - 360 : diff;
     }
 
     unsigned getDomePosition()
@@ -223,6 +211,33 @@ public:
         return fRelativeDegrees;
     }
 
+    /**
+      * Measured dome velocity in degrees per second as reported by the position provider
+      */
+    float getDomeVelocity()
+    {
+        return fProvider.getVelocity();
+    }
+
+    /**
+      * Age in milliseconds of the most recent position sample
+      */
+    uint32_t getDomeSampleAge()
+    {
+        return fProvider.getSampleAge();
+    }
+
+    /**
+      * Estimate the dome position after the specified number of milliseconds based on
+      * the measured velocity and the age of the last position sample.
+      */
+    unsigned getPredictedDomePosition(uint32_t ms)
+    {
+        long pos = getDomePosition();
+        long travel = lround(getDomeVelocity() * long(ms + getDomeSampleAge()) / 1000.0f);
+        return normalize(pos + travel);
+    }
+
     void resetDefaultMode()
     {
         setDomeMode(getDomeDefaultMode());
@@ -250,14 +265,22 @@ public:
         return normalize(long(getDomePosition()) - long(getDomeHome()));
     }
 
-    long normalize(long degrees)
+    static long normalize(long degrees)
     {
-        degrees = (long)fmod(degrees, 360);
+        degrees %= 360;
         if (degrees < 0)
             degrees += 360;
         return degrees;
     }
 
+    /**
+      * Returns true if p3 lies on the arc going clockwise from p1 to p2
+      */
+    static bool withinArc(long p1, long p2, long p3)
+    {
+        return normalize(p2 - p1) >= normalize(p3 - p1);
+    }
+
     bool isAtPosition(long degrees)
     {
         long fudge = getDomeFudge();
@@ -268,17 +291,11 @@ public:
 
     void setDomeHomePosition(long degrees)
     {
-        degrees = (long)fmod(degrees, 360);
-        if (degrees < 0)
-            degrees += 360;
         fDomeHome = normalize(degrees);
     }
 
     void setDomeTargetPosition(long degrees)
     {
-        degrees = (long)fmod(degrees, 360);
-        if (degrees < 0)
-            degrees += 360;
         fDomeTargetPos = normalize(degrees);
         fDomeRelativeTargetPos = 0;
     }
@@ -298,10 +315,7 @@ public:
 
     void setDomeHomeRelativeHomePosition(long degrees)
     {
-        degrees = (long)fmod(degrees + getDomeHome(), 360);
-        if (degrees < 0)
-            degrees += 360;
-        fDomeHome = normalize(degrees);
+        fDomeHome = normalize(degrees + getDomeHome());
     }
 
     inline void setDomeHomeSpeed(uint8_t speed)
@@ -434,10 +448,6 @@ private:
     void (*fHomeTargetReached)() = nullptr;
     void (*fAutoTargetReached)() = nullptr;
 
-    static bool withinArc(double p1, double p2, double p3)
-    {
-        return fmod(p2 - p1 + 2*360, 360) >= fmod(p3 - p1 + 2*360, 360);
-    }
 };
 
 #endif
@@ -6,6 +6,12 @@ class DomePositionProvider
 public:
     virtual bool ready() = 0;
     virtual int getAngle() = 0;
+
+    /** Angular velocity in degrees per second, positive when the angle is increasing */
+    virtual float getVelocity() { return 0; }
+
+    /** Age in milliseconds of the sample returned by getAngle() */
+    virtual uint32_t getSampleAge() { return 0; }
 };
 
 #endif
@@ -10,6 +10,22 @@
 #define DOMESENSOR_BAUD_RATE 57600  /* default */
 #endif
 
+#ifndef DOMESENSOR_SAMPLE_QUEUE_SIZE
+#define DOMESENSOR_SAMPLE_QUEUE_SIZE 8  /* must be a power of two */
+#endif
+
+#if defined(__AVR__)
+ #define DOMESENSOR_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+ #define DOMESENSOR_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+#if defined(ESP32) && defined(ESP_ARDUINO_VERSION_VAL)
+ #if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(2, 0, 3)
+  #define DOMESENSOR_USE_RECEIVE_CALLBACK
+ #endif
+#endif
+
 #ifdef USE_DOME_SENSOR_SERIAL_DEBUG
 #define DOME_SENSOR_SERIAL_PRINT(s) DEBUG_PRINT(s)
 #define DOME_SENSOR_SERIAL_PRINTLN(s) DEBUG_PRINTLN(s)
@@ -22,6 +38,22 @@
 #define DOME_SENSOR_SERIAL_PRINTLN_HEX(s)
 #endif
 
+/**
+  * \ingroup Drive
+  *
+  * \class DomeSensorRingSerialListener
+  *
+  * \brief Receives "#DP@angle" position reports from the dome sensor ring.
+  *
+  * Incoming characters are parsed as they arrive into a small queue of timestamped
+  * angle samples. On ESP32 the parser is driven by the HardwareSerial receive callback
+  * so samples are timestamped when they arrive rather than when animate() next runs.
+  * On other platforms animate() drains the stream completely on every call.
+  *
+  * animate() consumes the queued samples, updates the median filtered position and
+  * estimates the angular velocity. Sample age and interval statistics are kept so
+  * that DomeDrive can compensate for sensor latency.
+  */
 class DomeSensorRingSerialListener : public DomePositionProvider, protected AnimatedEvent
 {
 public:
@@ -30,11 +62,64 @@ public:
     {
     }
 
+#ifdef DOMESENSOR_USE_RECEIVE_CALLBACK
+    /** \brief Constructor
+      *
+      * Parse incoming characters from the UART receive callback instead of animate().
+      */
+    DomeSensorRingSerialListener(HardwareSerial& serial) :
+        fStream(&serial),
+        fUseCallback(true)
+    {
+        serial.onReceive([this]() { receive(); });
+    }
+#endif
+
     inline unsigned getErrorCount()
     {
         return fErrorCount;
     }
 
+    /** Number of samples dropped because animate() did not keep up. The oldest samples are dropped. */
+    inline unsigned getOverflowCount()
+    {
+        return fOverflowCount;
+    }
+
+    /** Minimum age in milliseconds of a sample when it was consumed by animate() */
+    inline uint32_t getLatencyMin()
+    {
+        return fLatencyMin;
+    }
+
+    /** Maximum age in milliseconds of a sample when it was consumed by animate() */
+    inline uint32_t getLatencyMax()
+    {
+        return fLatencyMax;
+    }
+
+    /** Average age in milliseconds of a sample when it was consumed by animate() */
+    inline uint32_t getLatencyAverage()
+    {
+        return (fLatencyCount != 0) ? fLatencySum / fLatencyCount : 0;
+    }
+
+    /** Smoothed interval in milliseconds between samples sent by the sensor ring */
+    inline uint32_t getSampleInterval()
+    {
+        return fSampleInterval;
+    }
+
+    void resetStatistics()
+    {
+        fLatencyMin = ~0u;
+        fLatencyMax = 0;
+        fLatencySum = 0;
+        fLatencyCount = 0;
+        fOverflowCount = 0;
+        fErrorCount = 0;
+    }
+
     virtual bool ready() override
     {
         return (fPosition != -1);
@@ -45,85 +130,194 @@ public:
         return fPosition;
     }
 
+    virtual float getVelocity() override
+    {
+        // Velocity is stale if the sensor has stopped reporting
+        uint32_t timeout = max(fSampleInterval * 4, uint32_t(100));
+        return (getSampleAge() < timeout) ? fVelocity : 0;
+    }
+
+    virtual uint32_t getSampleAge() override
+    {
+        return (fPosition != -1) ? millis() - fPositionTime : 0;
+    }
+
     virtual void animate() override
     {
-        // append commands to command buffer
-        while (fStream->available())
+        if (!fUseCallback)
+            receive();
+
+        // fHead and fTail count samples. The receive callback never waits for animate()
+        // and overwrites the oldest sample when the queue is full.
+        uint8_t head = fHead;
+        DOMESENSOR_MEMORY_BARRIER();
+        uint8_t tail = fTail;
+        if (uint8_t(head - tail) > DOMESENSOR_SAMPLE_QUEUE_SIZE - 1)
         {
-            int ch = fStream->read();
-            if (ch == '\r' || ch == '\n')
+            // The slot after the newest sample may be overwritten next
+            uint8_t oldest = head - (DOMESENSOR_SAMPLE_QUEUE_SIZE - 1);
+            fOverflowCount += uint8_t(oldest - tail);
+            tail = oldest;
+        }
+        while (tail != head)
+        {
+            Sample sample = fQueue[tail & (DOMESENSOR_SAMPLE_QUEUE_SIZE - 1)];
+            DOMESENSOR_MEMORY_BARRIER();
+            if (uint8_t(fHead - tail) >= DOMESENSOR_SAMPLE_QUEUE_SIZE)
             {
-                if (fState == 4)
-                {
-                    // Update position
-                    fSamples.append(fValue);
-                    if (fSampleCount < 6)
-                    {
-                        fPosition = fValue;
-                        fSampleCount++;
-                    }
-                    else
-                    {
-                        // Return the filtered angle
-                        fPosition = fSamples.median();
-                    }
-                    DOME_SENSOR_SERIAL_PRINT(" - ");
-                    DOME_SENSOR_SERIAL_PRINTLN(fPosition);
-                }
-                fState = 0;
-                if (fStream->available() < 10)
-                    return;
-                continue;
+                // Overwritten while it was copied
+                fOverflowCount++;
             }
             else
             {
-                DOME_SENSOR_SERIAL_PRINT((char)ch);
-            }
-            if (fState == -1)
-                continue;
-            switch (fState)
-            {
-                case 0:
-                    fState = (ch == '#') ? fState+1 : -1;
-                    break;
-                case 1:
-                    fState = (ch == 'D') ? fState+1 : -1;
-                    break;
-                case 2:
-                    fState = (ch == 'P') ? fState+1 : -1;
-                    break;
-                case 3:
-                    fState = (ch == '@') ? fState+1 : -1;
-                    fValue = 0;
-                    break;
-                case 4:
-                    if (ch >= '0' && ch <= '9')
-                    {
-                        fValue = fValue * 10 + (ch - '0');
-                    }
-                    else
-                    {
-                        fState = -1;
-                    }
-                    break;
-            }
-            if (fState == -1)
-            {
-                // ERROR: Ignore remaining input
-                DEBUG_PRINTLN("[DOME SENSOR] ERROR READING POSITION");
-                fErrorCount++;
+                update(sample.fAngle, sample.fTime);
             }
+            tail++;
         }
+        fTail = tail;
     }
 
 private:
+    static_assert((DOMESENSOR_SAMPLE_QUEUE_SIZE & (DOMESENSOR_SAMPLE_QUEUE_SIZE - 1)) == 0 &&
+                    DOMESENSOR_SAMPLE_QUEUE_SIZE <= 128,
+        "DOMESENSOR_SAMPLE_QUEUE_SIZE must be a power of two");
+
+    struct Sample
+    {
+        uint32_t fTime;
+        short fAngle;
+    };
+
     Stream* fStream;
+    bool fUseCallback = false;
     int fPosition = -1;
     int8_t fState = 0;
     int fValue = 0;
     int fSampleCount = 0;
     unsigned fErrorCount = 0;
+    unsigned fOverflowCount = 0;
     MedianSampleBuffer<short, 5> fSamples;
+
+    Sample fQueue[DOMESENSOR_SAMPLE_QUEUE_SIZE];
+    volatile uint8_t fHead = 0;
+    uint8_t fTail = 0;
+
+    uint32_t fPositionTime = 0;
+    int fLastAngle = -1;
+    uint32_t fLastTime = 0;
+    float fVelocity = 0;
+    uint32_t fSampleInterval = 0;
+    uint32_t fLatencyMin = ~0u;
+    uint32_t fLatencyMax = 0;
+    uint32_t fLatencySum = 0;
+    uint32_t fLatencyCount = 0;
+
+    // Called from the receive callback or animate()
+    void receive()
+    {
+        while (fStream->available())
+            parse(fStream->read());
+    }
+
+    void parse(int ch)
+    {
+        if (ch == '\r' || ch == '\n')
+        {
+            if (fState == 4)
+                push(fValue);
+            fState = 0;
+            return;
+        }
+        DOME_SENSOR_SERIAL_PRINT((char)ch);
+        switch (fState)
+        {
+            case -1:
+                return;
+            case 0:
+                fState = (ch == '#') ? fState+1 : -1;
+                break;
+            case 1:
+                fState = (ch == 'D') ? fState+1 : -1;
+                break;
+            case 2:
+                fState = (ch == 'P') ? fState+1 : -1;
+                break;
+            case 3:
+                fState = (ch == '@') ? fState+1 : -1;
+                fValue = 0;
+                break;
+            case 4:
+                if (ch >= '0' && ch <= '9')
+                {
+                    fValue = fValue * 10 + (ch - '0');
+                }
+                else
+                {
+                    fState = -1;
+                }
+                break;
+        }
+        if (fState == -1)
+        {
+            // ERROR: Ignore remaining input
+            DEBUG_PRINTLN("[DOME SENSOR] ERROR READING POSITION");
+            fErrorCount++;
+        }
+    }
+
+    void push(int angle)
+    {
+        // Only the receive callback writes fHead, animate() only reads it
+        uint8_t head = fHead;
+        Sample& sample = fQueue[head & (DOMESENSOR_SAMPLE_QUEUE_SIZE - 1)];
+        sample.fTime = millis();
+        sample.fAngle = angle;
+        DOMESENSOR_MEMORY_BARRIER();
+        fHead = head + 1;
+        // Publish the count before the next push can overwrite the oldest slot
+        DOMESENSOR_MEMORY_BARRIER();
+    }
+
+    void update(int angle, uint32_t timestamp)
+    {
+        uint32_t age = millis() - timestamp;
+        if (age < fLatencyMin)
+            fLatencyMin = age;
+        if (age > fLatencyMax)
+            fLatencyMax = age;
+        fLatencySum += age;
+        fLatencyCount++;
+
+        if (fLastAngle != -1)
+        {
+            uint32_t dt = timestamp - fLastTime;
+            if (dt != 0)
+            {
+                // Shortest signed distance in degrees between the two samples
+                int dist = (angle - fLastAngle + 540) % 360 - 180;
+                float velocity = dist * 1000.0f / dt;
+                fVelocity += (velocity - fVelocity) * 0.5f;
+                fSampleInterval = (fSampleInterval != 0) ? (fSampleInterval * 3 + dt) / 4 : dt;
+            }
+        }
+        fLastAngle = angle;
+        fLastTime = timestamp;
+
+        fSamples.append(angle);
+        if (fSampleCount < 6)
+        {
+            fPosition = angle;
+            fSampleCount++;
+        }
+        else
+        {
+            // Return the filtered angle
+            fPosition = fSamples.median();
+        }
+        fPositionTime = timestamp;
+        DOME_SENSOR_SERIAL_PRINT(" - ");
+        DOME_SENSOR_SERIAL_PRINTLN(fPosition);
+    }
 };
 
 #endif
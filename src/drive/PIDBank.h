@@ -0,0 +1,323 @@
+#ifndef PIDBank_h
+#define PIDBank_h
+
+#include "ReelTwo.h"
+
+/**
+  * \ingroup Drive
+  *
+  * \class PIDBank
+  *
+  * \brief Updates N independent PID loops in a single pass.
+  *
+  * Unlike PID, which binds one loop to external input/output/setpoint variables,
+  * PIDBank owns its state as structure-of-arrays so that process() is a single
+  * branch-free loop over N channels that the compiler can vectorise.
+  *
+  * Each channel supports:
+  *   - proportional on error, integral and derivative on measurement
+  *   - first order low pass filter on the derivative term
+  *   - back-calculation anti-windup of the integral term
+  *   - optional feed-forward term added before saturation
+  *
+  * \code
+  * PIDBank<float, 2> pid;
+  * pid.setTunings(0, 1.0, 0.1, 0.1);
+  * pid.setTunings(1, 0.5, 0.05, 0.02);
+  * pid.setOutputLimits(-1, 1);
+  * pid.setAutomatic(true);
+  *
+  * pid.setInput(0, distance);
+  * pid.setInput(1, angle);
+  * if (pid.process())
+  *     drive(pid.getOutput(0), pid.getOutput(1));
+  * \endcode
+  */
+template<typename T, unsigned N> class PIDBank
+{
+public:
+    enum Direction
+    {
+        kDirect,
+        kReverse
+    };
+
+    /** \brief Constructor
+      *
+      * All channels start with zero gains, output limits of 0-255 and no derivative filtering.
+      */
+    PIDBank(uint32_t sampleTime = 100) :
+        fAuto(false),
+        fSampleTime(sampleTime)
+    {
+        for (unsigned i = 0; i < N; i++)
+        {
+            fKpOrg[i] = fKiOrg[i] = fKdOrg[i] = 0;
+            fKp[i] = fKi[i] = fKd[i] = 0;
+            fKff[i] = 0;
+            fKaw[i] = fKawOrg[i] = 0;
+            fAlpha[i] = 1;
+            fDirection[i] = kDirect;
+            fOutMin[i] = 0;
+            fOutMax[i] = 255;
+            fInput[i] = 0;
+            fSetpoint[i] = 0;
+            fFeedForward[i] = 0;
+            fOutput[i] = 0;
+            fIntegral[i] = 0;
+            fLastInput[i] = 0;
+            fDInput[i] = 0;
+        }
+        fLastTime = millis() - fSampleTime;
+    }
+
+    static constexpr unsigned size()
+    {
+        return N;
+    }
+
+    /**
+      * Update all channels if the sample time has elapsed. Returns true if the outputs were updated.
+      */
+    bool process()
+    {
+        uint32_t now = millis();
+        if (fAuto && uint32_t(now - fLastTime) >= fSampleTime)
+        {
+            compute();
+            fLastTime = now;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+      * Update all channels unconditionally, ignoring the sample time. Use this when the caller
+      * already runs at a fixed rate.
+      */
+    void compute()
+    {
+        for (unsigned i = 0; i < N; i++)
+        {
+            T input = fInput[i];
+            T error = fSetpoint[i] - input;
+            T dInput = fDInput[i] + fAlpha[i] * ((input - fLastInput[i]) - fDInput[i]);
+            T unclamped = fKp[i] * error + fIntegral[i] - fKd[i] * dInput + fKff[i] * fFeedForward[i];
+            T output = (unclamped > fOutMax[i]) ? fOutMax[i] : unclamped;
+            output = (output < fOutMin[i]) ? fOutMin[i] : output;
+            /* Back-calculation: bleed the integral by the amount the output was saturated */
+            fIntegral[i] += fKi[i] * error + fKaw[i] * (output - unclamped);
+            fDInput[i] = dInput;
+            fLastInput[i] = input;
+            fOutput[i] = output;
+        }
+    }
+
+    void setAutomatic(bool automatic)
+    {
+        if (automatic && !fAuto)
+            init();
+        fAuto = automatic;
+    }
+
+    inline bool getAutomatic() const
+    {
+        return fAuto;
+    }
+
+    inline void setInput(unsigned i, T input)
+    {
+        fInput[i] = input;
+    }
+
+    inline void setSetpoint(unsigned i, T setpoint)
+    {
+        fSetpoint[i] = setpoint;
+    }
+
+    inline void setFeedForward(unsigned i, T value)
+    {
+        fFeedForward[i] = value;
+    }
+
+    inline T getOutput(unsigned i) const
+    {
+        return fOutput[i];
+    }
+
+    inline T getInput(unsigned i) const
+    {
+        return fInput[i];
+    }
+
+    inline T getSetpoint(unsigned i) const
+    {
+        return fSetpoint[i];
+    }
+
+    /** Direct access to the input array for callers that fill all channels at once */
+    inline T* inputs()
+    {
+        return fInput;
+    }
+
+    /** Direct access to the setpoint array */
+    inline T* setpoints()
+    {
+        return fSetpoint;
+    }
+
+    /** Direct access to the feed-forward array */
+    inline T* feedForwards()
+    {
+        return fFeedForward;
+    }
+
+    /** Read-only access to the output array */
+    inline const T* outputs() const
+    {
+        return fOutput;
+    }
+
+    /**
+      * Set the gains for channel i. Kaw is the back-calculation anti-windup gain in 1/seconds,
+      * if negative it defaults to Ki/Kp (or Ki if Kp is zero).
+      */
+    void setTunings(unsigned i, T Kp, T Ki, T Kd, T Kaw = -1)
+    {
+        if (Kp < 0 || Ki < 0 || Kd < 0)
+            return;
+
+        fKpOrg[i] = Kp;
+        fKiOrg[i] = Ki;
+        fKdOrg[i] = Kd;
+        if (Kaw < 0)
+            Kaw = (Kp > 0) ? Ki / Kp : Ki;
+        fKawOrg[i] = Kaw;
+        updateGains(i);
+    }
+
+    /**
+      * Set the feed-forward gain for channel i. The feed-forward value is multiplied by this gain
+      * and added to the output before saturation.
+      */
+    void setFeedForwardGain(unsigned i, T Kff)
+    {
+        fKff[i] = Kff;
+    }
+
+    /**
+      * Set the derivative low pass filter coefficient for channel i (0 < alpha <= 1). A value of 1
+      * disables filtering, smaller values filter more heavily.
+      */
+    void setDerivativeFilter(unsigned i, T alpha)
+    {
+        if (alpha > 0 && alpha <= 1)
+            fAlpha[i] = alpha;
+    }
+
+    void setDirection(unsigned i, Direction direction)
+    {
+        fDirection[i] = direction;
+        updateGains(i);
+    }
+
+    void setOutputLimits(unsigned i, T outputMin, T outputMax)
+    {
+        if (outputMin >= outputMax)
+            return;
+        fOutMin[i] = outputMin;
+        fOutMax[i] = outputMax;
+        if (fAuto)
+        {
+            fOutput[i] = clamp(i, fOutput[i]);
+            fIntegral[i] = clamp(i, fIntegral[i]);
+        }
+    }
+
+    void setOutputLimits(T outputMin, T outputMax)
+    {
+        for (unsigned i = 0; i < N; i++)
+            setOutputLimits(i, outputMin, outputMax);
+    }
+
+    void setSampleTime(unsigned sampleTime)
+    {
+        if (sampleTime == 0)
+            return;
+        fSampleTime = sampleTime;
+        for (unsigned i = 0; i < N; i++)
+            updateGains(i);
+    }
+
+    inline uint32_t getSampleTime() const    { return fSampleTime; }
+    inline T getKp(unsigned i) const         { return fKpOrg[i];   }
+    inline T getKi(unsigned i) const         { return fKiOrg[i];   }
+    inline T getKd(unsigned i) const         { return fKdOrg[i];   }
+    inline T getKaw(unsigned i) const        { return fKawOrg[i];  }
+    inline T getKff(unsigned i) const        { return fKff[i];     }
+    inline T getOutputMin(unsigned i) const  { return fOutMin[i];  }
+    inline T getOutputMax(unsigned i) const  { return fOutMax[i];  }
+    inline Direction getDirection(unsigned i) const { return fDirection[i]; }
+
+private:
+    bool fAuto;
+    uint32_t fSampleTime;
+    uint32_t fLastTime;
+
+    T fKpOrg[N];
+    T fKiOrg[N];
+    T fKdOrg[N];
+    T fKawOrg[N];
+    Direction fDirection[N];
+
+    /* Per channel gains scaled by sample time and direction */
+    T fKp[N];
+    T fKi[N];
+    T fKd[N];
+    T fKaw[N];
+    T fKff[N];
+    T fAlpha[N];
+    T fOutMin[N];
+    T fOutMax[N];
+
+    T fInput[N];
+    T fSetpoint[N];
+    T fFeedForward[N];
+    T fOutput[N];
+
+    T fIntegral[N];
+    T fLastInput[N];
+    T fDInput[N];
+
+    inline T clamp(unsigned i, T val) const
+    {
+        if (val > fOutMax[i])
+            return fOutMax[i];
+        if (val < fOutMin[i])
+            return fOutMin[i];
+        return val;
+    }
+
+    void updateGains(unsigned i)
+    {
+        T sampleTimeInSec = ((T)fSampleTime) / 1000;
+        T sign = (fDirection[i] == kReverse) ? -1 : 1;
+        fKp[i] = sign * fKpOrg[i];
+        fKi[i] = sign * fKiOrg[i] * sampleTimeInSec;
+        fKd[i] = sign * fKdOrg[i] / sampleTimeInSec;
+        /* Anti-windup acts on the output error which already carries the direction sign */
+        fKaw[i] = fKawOrg[i] * sampleTimeInSec;
+    }
+
+    void init()
+    {
+        for (unsigned i = 0; i < N; i++)
+        {
+            fIntegral[i] = clamp(i, fOutput[i]);
+            fLastInput[i] = fInput[i];
+            fDInput[i] = 0;
+        }
+    }
+};
+#endif
@@ -350,14 +350,16 @@ protected:
 
     void driveStick(JoystickController* stick, float speedModifier)
     {
+        JoystickController::State state;
+        stick->getSnapshot(state);
         fWasConnected = true;
         if (!fEnabled)
         {
             stop();
         }
         else if (useHardStop() &&
-                ((useLeftStick() && stick->state.button.l1) ||
-                 (useRightStick() && stick->state.button.r1)))
+                ((useLeftStick() && state.button.l1) ||
+                 (useRightStick() && state.button.r1)))
         {
             if (!fMotorsStopped)
             {
@@ -371,8 +373,8 @@ protected:
         {
             if (millis() - fLastCommand > fSerialLatency)
             {
-                auto stickx = useLeftStick() ? stick->state.analog.stick.lx : stick->state.analog.stick.rx;
-                auto sticky = useLeftStick() ? stick->state.analog.stick.ly : stick->state.analog.stick.ry;
+                auto stickx = useLeftStick() ? state.analog.stick.lx : state.analog.stick.rx;
+                auto sticky = useLeftStick() ? state.analog.stick.ly : state.analog.stick.ry;
                 // float drive_mod = speedModifier * -1.0f;
                 auto drive_mod = throttleSpeed(speedModifier);
                 auto turning = (float)(stickx + 128) / 127.5f - 1.0f;
@@ -541,6 +543,7 @@ protected:
                 target_right = max(-1.0f, min(target_right, 1.0f));
 
                 motor(target_left, target_right, drive_mod);
+                stick->recordInputLatency();
                 fLastCommand = millis();
                 fMotorsStopped = false;
             }
@@ -25,8 +25,6 @@ public:
 		fButtonPin[2] = buttonDown;
 		fButtonPin[3] = buttonRight;
 		fButtonPin[4] = buttonIn;
-		memset(&fButtonState, '\0', sizeof(fButtonState));
-		memset(&fButtonOldState, '\0', sizeof(fButtonOldState));
 		for (unsigned i = 0; i < sizeof(fButtonPin); i++)
 	    	fPinManager.pinMode(fButtonPin[i], INPUT_PULLUP);
 	}
@@ -44,70 +42,65 @@ public:
 
 	bool hasButtonStateChanged() const
 	{
-		return fButtonStateChanged;
+		return (fButtonMask != fButtonOldMask);
 	}
 
+	/**
+	  * Returns the buttons pressed at the last animated event. Bit 0 is up, 1 is left,
+	  * 2 is down, 3 is right and 4 is in.
+	  */
 	uint8_t getButtonPressedMask() const
 	{
-		uint8_t mask = 0;
-		for (unsigned i = 0; i < sizeof(fButtonPin); i++)
-		{
-			if (fButtonState[i])
-				mask |= (1<<i);
-		}
-		return mask;
+		return fButtonMask;
 	}
 
 	bool isButtonPressed(byte pin) const
 	{
-		for (unsigned i = 0; i < sizeof(fButtonPin); i++)
-		{
-			if (fButtonPin[i] == pin)
-				return fButtonState[i];
-		}
-		return false;
+		return (fButtonMask & buttonBit(pin)) != 0;
 	}
 
 	bool isButtonReleased(byte pin) const
 	{
-		for (unsigned i = 0; i < sizeof(fButtonPin); i++)
-		{
-			if (fButtonPin[i] == pin)
-			{
-				return fButtonOldState[i] && !fButtonState[i];
-			}
-		}
-		return false;
+		return (fButtonOldMask & ~fButtonMask & buttonBit(pin)) != 0;
 	}
 
     virtual void animate() override
     {
-    	fButtonStateChanged = false;
     	RotaryEncoder::animate();
+    	// Sample all buttons once per frame so every query in this frame agrees
+		uint8_t mask = 0;
 		for (unsigned i = 0; i < sizeof(fButtonPin); i++)
 		{
-			bool newState = !fPinManager.digitalRead(fButtonPin[i]);
-			fButtonOldState[i] = fButtonState[i];
-			if (newState != fButtonState[i])
-			{
-				fButtonState[i] = newState;
-				fButtonStateChanged = true;
-				if (fButtonNotify[i] != nullptr)
-				{
-					fButtonNotify[i](newState);
-				}
-			}
+			if (!fPinManager.digitalRead(fButtonPin[i]))
+				mask |= (1<<i);
+		}
+		fButtonOldMask = fButtonMask;
+		fButtonMask = mask;
+		uint8_t changed = fButtonOldMask ^ fButtonMask;
+		for (unsigned i = 0; changed != 0; i++, changed >>= 1)
+		{
+			if ((changed & 1) && fButtonNotify[i] != nullptr)
+				fButtonNotify[i]((fButtonMask & (1<<i)) != 0);
 		}
     }
 
 private:
 	typedef void (*ButtonNotifyProc)(bool pressed);
 	byte fButtonPin[5];
-	bool fButtonState[sizeof(fButtonPin)];
-	bool fButtonOldState[sizeof(fButtonPin)];
-    ButtonNotifyProc fButtonNotify[sizeof(fButtonPin)];
-    bool fButtonStateChanged = false;
+	uint8_t fButtonMask = 0;
+	uint8_t fButtonOldMask = 0;
+    ButtonNotifyProc fButtonNotify[sizeof(fButtonPin)] = {};
     PinManager &fPinManager;
+
+	uint8_t buttonBit(byte pin) const
+	{
+		for (unsigned i = 0; i < sizeof(fButtonPin); i++)
+		{
+			if (fButtonPin[i] == pin)
+				return (1<<i);
+		}
+		return 0;
+	}
 };
 
 #endif
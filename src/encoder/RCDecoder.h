@@ -0,0 +1,769 @@
+#ifndef RCDecoder_h
+#define RCDecoder_h
+
+#include "ReelTwo.h"
+#include "core/SetupEvent.h"
+#include "core/AnimatedEvent.h"
+#include "core/ISRSnapshot.h"
+
+#if defined(ESP32) && __has_include("driver/rmt_rx.h")
+#define RC_DECODER_USE_RMT 1
+#include "driver/rmt_rx.h"
+#else
+#define RC_DECODER_USE_RMT 0
+#endif
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#endif
+
+#ifndef RC_DECODER_MAX_CHANNELS
+ #ifdef __AVR__
+  #define RC_DECODER_MAX_CHANNELS 8
+ #else
+  #define RC_DECODER_MAX_CHANNELS 18
+ #endif
+#endif
+
+#ifndef RC_DECODER_MAX_SOURCES
+#define RC_DECODER_MAX_SOURCES 8
+#endif
+
+// Pulses outside of this range (in microseconds) are treated as noise
+#ifndef RC_DECODER_MIN_PULSE
+#define RC_DECODER_MIN_PULSE 850
+#endif
+
+#ifndef RC_DECODER_MAX_PULSE
+#define RC_DECODER_MAX_PULSE 2150
+#endif
+
+// A PPM gap longer than this (in microseconds) starts a new frame
+#ifndef RC_DECODER_PPM_SYNC
+#define RC_DECODER_PPM_SYNC 2700
+#endif
+
+// A channel without a valid sample for this many milliseconds is inactive
+#ifndef RC_DECODER_TIMEOUT
+#define RC_DECODER_TIMEOUT 250
+#endif
+
+// Default per channel deadband (in microseconds) applied after the median filter
+#ifndef RC_DECODER_DEADBAND
+#define RC_DECODER_DEADBAND 4
+#endif
+
+// Bit mask of the AVR pin change vectors (PCINT0_vect ... PCINT3_vect) owned by RCDecoder.
+// Clear the bits of vectors already used by other libraries such as SoftwareSerial.
+#ifndef RC_DECODER_PCINT_VECTORS
+#define RC_DECODER_PCINT_VECTORS 0x0F
+#endif
+
+#ifndef RC_DECODER_RMT_SYMBOLS
+#define RC_DECODER_RMT_SYMBOLS 24
+#endif
+
+/**
+  * \ingroup Core
+  *
+  * \class RCDecoder
+  *
+  * \brief Decodes RC receiver PWM, PPM and SBUS inputs into one set of channels
+  *
+  * Inputs are registered using addPWM(), addPPM() and addSBUS() and can be freely mixed.
+  * Each input is assigned a consecutive range of channels. Edges are captured with as little
+  * work in interrupt context as possible:
+  *
+  * - ESP32: RMT receive channels capture a complete pulse or PPM frame in hardware and
+  *   raise a single interrupt per frame. If no RMT channel is available the pin falls back
+  *   to an edge interrupt.
+  * - AVR: pin change interrupts read the whole input port once and timestamp all changed
+  *   pins of that port with a single call to micros().
+  * - SBUS frames (100000 baud 8E2, inverted) are parsed from a Stream in animate().
+  *
+  * Interrupt handlers only store the raw pulse width and capture time of a channel. Range
+  * checking happens on capture, while median filtering, deadband, timeout and change
+  * notification happen in animate(). A timestamped snapshot of all channels is available
+  * from readFrame().
+  *
+  * \code
+  * RCDecoder rc;
+  * int steering = rc.addPWM(2);
+  * int ppm = rc.addPPM(3, 8);
+  * \endcode
+  */
+class RCDecoder : public SetupEvent, AnimatedEvent
+{
+public:
+    struct Frame
+    {
+        /** micros() at which the newest sample of this frame was captured */
+        uint32_t fTimestamp;
+        /** Bit mask of active channels */
+        uint32_t fActive;
+        uint8_t fCount;
+        uint16_t fValue[RC_DECODER_MAX_CHANNELS];
+    };
+
+    RCDecoder(void (*changeNotify)(unsigned channel, uint16_t pulse) = nullptr) :
+        fChangeNotify(changeNotify)
+    {
+    }
+
+    ~RCDecoder()
+    {
+        end();
+    }
+
+    /**
+      * Adds a single channel servo PWM input. Returns the channel number or -1.
+      */
+    int addPWM(uint8_t pin, bool activeHigh = true)
+    {
+        return addSource(kPWM, pin, 1, activeHigh);
+    }
+
+    /**
+      * Adds a PPM input carrying channelCount channels. Returns the first channel number or -1.
+      */
+    int addPPM(uint8_t pin, uint8_t channelCount, bool activeHigh = true)
+    {
+        return addSource(kPPM, pin, channelCount, activeHigh);
+    }
+
+    /**
+      * Adds an SBUS input. The stream must already be configured for 100000 baud 8E2 with
+      * inverted logic (or an external inverter). Only one SBUS input is supported. Returns the
+      * first channel number or -1.
+      */
+    int addSBUS(Stream& stream, uint8_t channelCount = 16)
+    {
+        if (fSBUS.fStream != nullptr || channelCount > 16)
+            return -1;
+        int first = allocChannels(channelCount);
+        if (first >= 0)
+        {
+            fSBUS.fStream = &stream;
+            fSBUS.fFirst = first;
+            fSBUS.fCount = channelCount;
+            fSBUS.fPos = 0;
+        }
+        return first;
+    }
+
+    virtual void setup() override
+    {
+        begin();
+    }
+
+    bool begin()
+    {
+        if (fStarted)
+            return true;
+        bool success = true;
+        for (unsigned i = 0; i < fNumSources; i++)
+        {
+            Source& src = fSources[i];
+            pinMode(src.fPin, INPUT_PULLUP);
+            src.fIndex = src.fCount;
+            src.fLastEdge = micros();
+        #if RC_DECODER_USE_RMT
+            if (beginRMT(src))
+                continue;
+        #endif
+            if (!attachSource(src))
+            {
+                DEBUG_PRINT("RCDecoder: no capture for pin ");
+                DEBUG_PRINTLN(src.fPin);
+                success = false;
+            }
+        }
+        fStarted = true;
+        return success;
+    }
+
+    void end()
+    {
+        if (!fStarted)
+            return;
+        for (unsigned i = 0; i < fNumSources; i++)
+        {
+            Source& src = fSources[i];
+        #if RC_DECODER_USE_RMT
+            if (src.fReceiver != nullptr)
+            {
+                rmt_disable(src.fReceiver);
+                rmt_del_channel(src.fReceiver);
+                src.fReceiver = nullptr;
+                continue;
+            }
+        #endif
+            detachSource(src);
+        }
+        fStarted = false;
+    }
+
+    virtual void animate() override
+    {
+        if (fSBUS.fStream != nullptr)
+            pollSBUS();
+
+        uint32_t now = millis();
+        for (unsigned i = 0; i < fNumChannels; i++)
+        {
+            Channel& ch = fChannels[i];
+            Sample sample;
+            uint8_t seq = ch.fSample.read(sample);
+            if (seq != ch.fLastSeq)
+            {
+                ch.fLastSeq = seq;
+                ch.fLastSample = now;
+                ch.fStamp = sample.fStamp;
+                if (int32_t(sample.fStamp - fFrame.fTimestamp) > 0)
+                    fFrame.fTimestamp = sample.fStamp;
+                fFrameUpdated = true;
+                filter(i, sample.fWidth);
+            }
+            bool active = (ch.fValue != 0 && now - ch.fLastSample < RC_DECODER_TIMEOUT);
+            ch.fStateChange = (active != ch.fAlive);
+            ch.fAlive = active;
+            if (active)
+                fFrame.fActive |= (1UL << i);
+            else
+                fFrame.fActive &= ~(1UL << i);
+        }
+    }
+
+    inline unsigned numChannels() const
+    {
+        return fNumChannels;
+    }
+
+    /** Filtered pulse width of the channel in microseconds or 0 if nothing was received yet */
+    inline uint16_t getValue(unsigned ch) const
+    {
+        return (ch < fNumChannels) ? fChannels[ch].fValue : 0;
+    }
+
+    inline uint16_t channel(unsigned ch) const
+    {
+        return getValue(ch);
+    }
+
+    /** micros() at which the last sample of the channel was captured */
+    inline uint32_t getTimestamp(unsigned ch) const
+    {
+        return (ch < fNumChannels) ? fChannels[ch].fStamp : 0;
+    }
+
+    /** Milliseconds since the last sample of the channel */
+    inline unsigned long getAge(unsigned ch) const
+    {
+        return (ch < fNumChannels) ? millis() - fChannels[ch].fLastSample : ~0UL;
+    }
+
+    inline bool isActive(unsigned ch) const
+    {
+        return (ch < fNumChannels && fChannels[ch].fAlive);
+    }
+
+    inline bool becameActive(unsigned ch) const
+    {
+        return (ch < fNumChannels && fChannels[ch].fStateChange && fChannels[ch].fAlive);
+    }
+
+    inline bool becameInactive(unsigned ch) const
+    {
+        return (ch < fNumChannels && fChannels[ch].fStateChange && !fChannels[ch].fAlive);
+    }
+
+    /** True if the SBUS receiver reported failsafe in its last frame */
+    inline bool isFailsafe() const
+    {
+        return fSBUS.fFailsafe;
+    }
+
+    /**
+      * Sets the deadband in microseconds and enables or disables the 3 sample median filter
+      * for the channel.
+      */
+    void setFilter(unsigned ch, uint8_t deadband, bool median = true)
+    {
+        if (ch < fNumChannels)
+        {
+            fChannels[ch].fDeadband = deadband;
+            fChannels[ch].fMedian = median;
+        }
+    }
+
+    /**
+      * Copies the filtered values of all channels into frame. Returns true if any channel
+      * received a new sample since the previous call.
+      */
+    bool readFrame(Frame& frame)
+    {
+        fFrame.fCount = fNumChannels;
+        for (unsigned i = 0; i < fNumChannels; i++)
+            fFrame.fValue[i] = fChannels[i].fValue;
+        frame = fFrame;
+        bool updated = fFrameUpdated;
+        fFrameUpdated = false;
+        return updated;
+    }
+
+private:
+    enum
+    {
+        kPWM,
+        kPPM
+    };
+
+    struct Sample
+    {
+        uint16_t fWidth;
+        uint32_t fStamp;
+    };
+
+    struct Channel
+    {
+        // Written by the capture interrupt
+        ISRSnapshot<Sample> fSample;
+        // Owned by animate()
+        uint8_t fLastSeq;
+        uint8_t fDeadband;
+        bool fMedian;
+        bool fAlive;
+        bool fStateChange;
+        uint8_t fHistoryPos;
+        uint16_t fHistory[3];
+        uint16_t fValue;
+        uint32_t fStamp;
+        uint32_t fLastSample;
+    };
+
+    struct Source
+    {
+        RCDecoder* fDecoder;
+        uint8_t fType;
+        uint8_t fPin;
+        uint8_t fFirst;
+        uint8_t fCount;
+        bool fActiveHigh;
+        volatile uint8_t fIndex;
+        volatile uint32_t fLastEdge;
+    #if RC_DECODER_USE_RMT
+        rmt_channel_handle_t fReceiver;
+        rmt_symbol_word_t fSymbols[RC_DECODER_RMT_SYMBOLS];
+    #endif
+    };
+
+    struct SBUS
+    {
+        Stream* fStream;
+        uint8_t fFirst;
+        uint8_t fCount;
+        uint8_t fPos;
+        bool fFailsafe;
+        uint8_t fBuffer[25];
+    };
+
+    bool fStarted = false;
+    uint8_t fNumChannels = 0;
+    uint8_t fNumSources = 0;
+    bool fFrameUpdated = false;
+    Channel fChannels[RC_DECODER_MAX_CHANNELS] = {};
+    Source fSources[RC_DECODER_MAX_SOURCES] = {};
+    SBUS fSBUS = {};
+    Frame fFrame = {};
+    void (*fChangeNotify)(unsigned channel, uint16_t pulse);
+
+    static_assert(RC_DECODER_MAX_CHANNELS <= 32, "RC_DECODER_MAX_CHANNELS must be 32 or less");
+
+    int allocChannels(uint8_t count)
+    {
+        if (fStarted || count == 0 || fNumChannels + count > RC_DECODER_MAX_CHANNELS)
+            return -1;
+        int first = fNumChannels;
+        for (unsigned i = first; i < unsigned(first + count); i++)
+        {
+            fChannels[i].fDeadband = RC_DECODER_DEADBAND;
+            fChannels[i].fMedian = true;
+        }
+        fNumChannels += count;
+        return first;
+    }
+
+    int addSource(uint8_t type, uint8_t pin, uint8_t count, bool activeHigh)
+    {
+        if (fNumSources >= RC_DECODER_MAX_SOURCES)
+            return -1;
+        int first = allocChannels(count);
+        if (first >= 0)
+        {
+            Source& src = fSources[fNumSources++];
+            src.fDecoder = this;
+            src.fType = type;
+            src.fPin = pin;
+            src.fFirst = first;
+            src.fCount = count;
+            src.fActiveHigh = activeHigh;
+        }
+        return first;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Interrupt side
+    ///////////////////////////////////////////////////////////////////////////
+
+    static void IRAM_ATTR storeSample(Channel& ch, uint32_t width, uint32_t now)
+    {
+        if (width < RC_DECODER_MIN_PULSE || width > RC_DECODER_MAX_PULSE)
+            return;
+        Sample& sample = ch.fSample.beginWrite();
+        sample.fWidth = width;
+        sample.fStamp = now;
+        ch.fSample.endWrite();
+    }
+
+    /** Processes one edge of a source captured at time now */
+    static void IRAM_ATTR handleEdge(Source& src, bool level, uint32_t now)
+    {
+        Channel* channels = src.fDecoder->fChannels;
+        bool leading = (level == src.fActiveHigh);
+        if (src.fType == kPWM)
+        {
+            // fIndex is zero while a pulse started by a seen leading edge is in progress
+            if (leading)
+            {
+                src.fLastEdge = now;
+                src.fIndex = 0;
+            }
+            else if (src.fIndex == 0)
+            {
+                storeSample(channels[src.fFirst], now - src.fLastEdge, now);
+                src.fIndex = 1;
+            }
+        }
+        else if (leading)
+        {
+            // PPM channels are measured from leading edge to leading edge
+            uint32_t width = now - src.fLastEdge;
+            src.fLastEdge = now;
+            if (width > RC_DECODER_PPM_SYNC)
+            {
+                src.fIndex = 0;
+            }
+            else if (src.fIndex < src.fCount)
+            {
+                storeSample(channels[src.fFirst + src.fIndex], width, now);
+                src.fIndex = src.fIndex + 1;
+            }
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Filtering
+    ///////////////////////////////////////////////////////////////////////////
+
+    static inline uint16_t median3(uint16_t a, uint16_t b, uint16_t c)
+    {
+        if (a > b)
+        {
+            uint16_t t = a; a = b; b = t;
+        }
+        return (c <= a) ? a : ((c >= b) ? b : c);
+    }
+
+    void filter(unsigned i, uint16_t raw)
+    {
+        Channel& ch = fChannels[i];
+        uint16_t value = raw;
+        if (ch.fValue == 0)
+        {
+            // Prime the history with the first sample
+            ch.fHistory[0] = ch.fHistory[1] = ch.fHistory[2] = raw;
+        }
+        else if (ch.fMedian)
+        {
+            ch.fHistory[ch.fHistoryPos] = raw;
+            ch.fHistoryPos = (ch.fHistoryPos < 2) ? ch.fHistoryPos + 1 : 0;
+            value = median3(ch.fHistory[0], ch.fHistory[1], ch.fHistory[2]);
+        }
+        if (ch.fValue == 0 || abs(int32_t(value) - int32_t(ch.fValue)) > ch.fDeadband)
+        {
+            ch.fValue = value;
+            if (fChangeNotify != nullptr)
+                fChangeNotify(i, value);
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // SBUS
+    ///////////////////////////////////////////////////////////////////////////
+
+    void pollSBUS()
+    {
+        Stream* stream = fSBUS.fStream;
+        while (stream->available() > 0)
+        {
+            uint8_t b = stream->read();
+            if (fSBUS.fPos == 0 && b != 0x0F)
+                continue;
+            fSBUS.fBuffer[fSBUS.fPos++] = b;
+            if (fSBUS.fPos < sizeof(fSBUS.fBuffer))
+                continue;
+            fSBUS.fPos = 0;
+            // SBUS ends with 0x00, SBUS2 with 0x04/0x14/0x24/0x34
+            if (b != 0x00 && (b & 0x0F) != 0x04)
+                continue;
+            decodeSBUS(micros());
+        }
+    }
+
+    void decodeSBUS(uint32_t now)
+    {
+        const uint8_t* data = &fSBUS.fBuffer[1];
+        uint8_t flags = fSBUS.fBuffer[23];
+        fSBUS.fFailsafe = ((flags & 0x08) != 0);
+        if (fSBUS.fFailsafe || (flags & 0x04) != 0)
+            return;
+        // 16 channels of 11 bits packed LSB first
+        uint32_t bits = 0;
+        unsigned numBits = 0;
+        for (unsigned i = 0; i < fSBUS.fCount; i++)
+        {
+            while (numBits < 11)
+            {
+                bits |= uint32_t(*data++) << numBits;
+                numBits += 8;
+            }
+            int32_t value = bits & 0x7FF;
+            bits >>= 11;
+            numBits -= 11;
+            // 172..1811 maps to 988..2012us
+            storeSample(fChannels[fSBUS.fFirst + i], uint32_t(1500 + ((value - 992) * 5) / 8), now);
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    // ESP32 RMT capture
+    ///////////////////////////////////////////////////////////////////////////
+
+#if RC_DECODER_USE_RMT
+    static const rmt_receive_config_t& receiveConfig()
+    {
+        // The idle time ending a reception is the PPM sync gap. PWM pulses are followed by a
+        // much longer gap so every reception holds exactly one pulse or one PPM frame.
+        static const rmt_receive_config_t sConfig = {
+            .signal_range_min_ns = 1250,
+            .signal_range_max_ns = RC_DECODER_PPM_SYNC * 1000UL
+        };
+        return sConfig;
+    }
+
+    static bool IRAM_ATTR receiveDone(rmt_channel_handle_t rxChannel, const rmt_rx_done_event_data_t* edata, void* arg)
+    {
+        Source& src = *(Source*)arg;
+        Channel* channels = src.fDecoder->fChannels;
+        uint32_t now = micros();
+        const rmt_symbol_word_t* sym = edata->received_symbols;
+        size_t count = edata->num_symbols;
+        if (src.fType == kPWM)
+        {
+            if (count >= 1 && sym[0].level0 == src.fActiveHigh)
+                storeSample(channels[src.fFirst], sym[0].duration0, now);
+        }
+        else
+        {
+            // Every symbol is one pulse plus the gap to the next pulse. The last
+            // symbol is the terminating pulse followed by the sync gap.
+            if (count > src.fCount)
+                count = src.fCount + 1;
+            for (size_t i = 0; i + 1 < count; i++)
+                storeSample(channels[src.fFirst + i], sym[i].duration0 + sym[i].duration1, now);
+        }
+        rmt_receive(rxChannel, src.fSymbols, sizeof(src.fSymbols), &receiveConfig());
+        return false;
+    }
+
+    bool beginRMT(Source& src)
+    {
+        rmt_rx_channel_config_t rxConfig = {};
+        rxConfig.gpio_num = gpio_num_t(src.fPin);
+        rxConfig.clk_src = RMT_CLK_SRC_DEFAULT;
+        rxConfig.resolution_hz = 1000000;
+        rxConfig.mem_block_symbols = 48;
+        if (rmt_new_rx_channel(&rxConfig, &src.fReceiver) != ESP_OK)
+        {
+            src.fReceiver = nullptr;
+            return false;
+        }
+        rmt_rx_event_callbacks_t callbacks = {};
+        callbacks.on_recv_done = receiveDone;
+        rmt_rx_register_event_callbacks(src.fReceiver, &callbacks, &src);
+        rmt_enable(src.fReceiver);
+        rmt_receive(src.fReceiver, src.fSymbols, sizeof(src.fSymbols), &receiveConfig());
+        return true;
+    }
+#endif
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Edge interrupt capture
+    ///////////////////////////////////////////////////////////////////////////
+
+#if defined(__AVR__) && defined(PCICR)
+    struct PortGroup
+    {
+        volatile uint8_t* fInput;
+        uint8_t fMask;
+        uint8_t fLast;
+        Source* fSource[8];
+    };
+
+    // At most two ports share a pin change group (PCINT1 on the ATmega2560)
+    struct PinChange
+    {
+        PortGroup fPort[4][2];
+    };
+
+    static PinChange& pinChange()
+    {
+        static PinChange sPinChange;
+        return sPinChange;
+    }
+
+    bool attachSource(Source& src)
+    {
+        volatile uint8_t* pcicr = digitalPinToPCICR(src.fPin);
+        if (pcicr == nullptr)
+            return false;
+        uint8_t group = digitalPinToPCICRbit(src.fPin);
+        if (group >= 4 || (RC_DECODER_PCINT_VECTORS & (1 << group)) == 0)
+            return false;
+        volatile uint8_t* input = portInputRegister(digitalPinToPort(src.fPin));
+        uint8_t mask = digitalPinToBitMask(src.fPin);
+        for (unsigned i = 0; i < 2; i++)
+        {
+            PortGroup& port = pinChange().fPort[group][i];
+            if (port.fInput != nullptr && port.fInput != input)
+                continue;
+            uint8_t bit = 0;
+            while ((mask >> bit) != 1)
+                bit++;
+            uint8_t oldSREG = SREG;
+            cli();
+            port.fInput = input;
+            port.fSource[bit] = &src;
+            port.fLast = (port.fLast & ~mask) | (*input & mask);
+            port.fMask |= mask;
+            *digitalPinToPCMSK(src.fPin) |= _BV(digitalPinToPCMSKbit(src.fPin));
+            *pcicr |= _BV(group);
+            SREG = oldSREG;
+            return true;
+        }
+        return false;
+    }
+
+    void detachSource(Source& src)
+    {
+        volatile uint8_t* pcicr = digitalPinToPCICR(src.fPin);
+        if (pcicr == nullptr)
+            return;
+        uint8_t group = digitalPinToPCICRbit(src.fPin);
+        uint8_t mask = digitalPinToBitMask(src.fPin);
+        if (group >= 4)
+            return;
+        uint8_t oldSREG = SREG;
+        cli();
+        *digitalPinToPCMSK(src.fPin) &= ~_BV(digitalPinToPCMSKbit(src.fPin));
+        for (unsigned i = 0; i < 2; i++)
+        {
+            PortGroup& port = pinChange().fPort[group][i];
+            if (port.fInput == portInputRegister(digitalPinToPort(src.fPin)))
+                port.fMask &= ~mask;
+        }
+        SREG = oldSREG;
+    }
+
+public:
+    /// \private
+    static inline void handlePinChange(uint8_t group)
+    {
+        // One timestamp and one port read for all pins that changed
+        uint32_t now = micros();
+        for (unsigned i = 0; i < 2; i++)
+        {
+            PortGroup& port = pinChange().fPort[group][i];
+            if (port.fMask == 0)
+                continue;
+            uint8_t value = *port.fInput;
+            uint8_t changed = (value ^ port.fLast) & port.fMask;
+            port.fLast = value;
+            for (uint8_t bit = 0; changed != 0; bit++, changed >>= 1)
+            {
+                if (changed & 1)
+                    handleEdge(*port.fSource[bit], (value >> bit) & 1, now);
+            }
+        }
+    }
+
+private:
+#elif defined(ESP32)
+    static void IRAM_ATTR edgeISR(void* arg)
+    {
+        Source& src = *(Source*)arg;
+        handleEdge(src, digitalRead(src.fPin), micros());
+    }
+
+    bool attachSource(Source& src)
+    {
+        attachInterruptArg(digitalPinToInterrupt(src.fPin), edgeISR, &src, CHANGE);
+        return true;
+    }
+
+    void detachSource(Source& src)
+    {
+        detachInterrupt(digitalPinToInterrupt(src.fPin));
+    }
+#else
+    bool attachSource(Source& src)
+    {
+        UNUSED_ARG(src)
+        return false;
+    }
+
+    void detachSource(Source& src)
+    {
+        UNUSED_ARG(src)
+    }
+#endif
+};
+
+#if defined(__AVR__) && defined(PCICR)
+#if defined(PCINT0_vect) && (RC_DECODER_PCINT_VECTORS & 0x01)
+ISR(PCINT0_vect)
+{
+    RCDecoder::handlePinChange(0);
+}
+#endif
+#if defined(PCINT1_vect) && (RC_DECODER_PCINT_VECTORS & 0x02)
+ISR(PCINT1_vect)
+{
+    RCDecoder::handlePinChange(1);
+}
+#endif
+#if defined(PCINT2_vect) && (RC_DECODER_PCINT_VECTORS & 0x04)
+ISR(PCINT2_vect)
+{
+    RCDecoder::handlePinChange(2);
+}
+#endif
+#if defined(PCINT3_vect) && (RC_DECODER_PCINT_VECTORS & 0x08)
+ISR(PCINT3_vect)
+{
+    RCDecoder::handlePinChange(3);
+}
+#endif
+#endif
+
+#endif
@@ -5,6 +5,7 @@
 #include "core/SetupEvent.h"
 #include "core/AnimatedEvent.h"
 #include "core/PinInterruptHandler.h"
+#include "core/ISRSnapshot.h"
 
 /**
   * \ingroup Core
@@ -15,6 +16,17 @@
   *
   * Decodes the signals from a rotary encoder (quadrature pulses) and translates
   * them into a counter position.
+  *
+  * The interrupt handler publishes the position through an ISRSnapshot so getState()
+  * always returns position, timing and error counts from the same transition. The
+  * state seen by the last animate() is available from getFrameState() so that everything
+  * processed in one loop iteration agrees.
+  *
+  * An interrupt on any encoder pin samples every interrupt driven encoder. On AVR both
+  * pins of an encoder are read with a single port read when they share a port, and
+  * encoders on the same port reuse that read. Transitions are decoded with a 16 entry
+  * table. If a state was skipped the step is recovered from the previous direction and
+  * counted as missed, otherwise it is counted as invalid.
   */
 class RotaryEncoder: public SetupEvent, AnimatedEvent, PinInterruptHandler
 {
@@ -30,7 +42,16 @@ public:
     {
         kFour3 = 1, // 4 steps, Latch at position 3 only (compatible to older versions)
         kFour0 = 2, // 4 steps, Latch at position 0 (reverse wirings)
-        kTwo03 = 3  // 2 steps, Latch at position 0 and 3 
+        kTwo03 = 3  // 2 steps, Latch at position 0 and 3
+    };
+
+    struct State
+    {
+        long fPosition;         // External position
+        uint32_t fTime;         // The time the last position change was detected.
+        uint32_t fTimePrev;     // The time the previous position change was detected.
+        uint16_t fMissed;       // Transitions that skipped a state and were recovered
+        uint16_t fInvalid;      // Transitions that skipped a state and were dropped
     };
 
     RotaryEncoder(byte pin1, byte pin2, LatchMode mode = LatchMode::kFour0, bool useInterrupt = true) :
@@ -42,16 +63,35 @@ public:
         pinMode(fPin1, INPUT_PULLUP);
         pinMode(fPin2, INPUT_PULLUP);
 
+    #ifdef __AVR__
+        fInput1 = portInputRegister(digitalPinToPort(fPin1));
+        fInput2 = portInputRegister(digitalPinToPort(fPin2));
+        fMask1 = digitalPinToBitMask(fPin1);
+        fMask2 = digitalPinToBitMask(fPin2);
+    #endif
         // when not started in motion, the current
         // state of the encoder should be 3
-        int sig1 = digitalRead(fPin1);
-        int sig2 = digitalRead(fPin2);
-        fOldState = sig1 | (sig2 << 1);
+        fOldState = readState();
 
         // start with position 0;
         fPosition = 0;
-        fPositionExt = 0;
         fPositionExtPrev = 0;
+
+        fNext = head();
+        head() = this;
+    }
+
+    ~RotaryEncoder()
+    {
+        end();
+        for (RotaryEncoder** enc = &head(); *enc != nullptr; enc = &(*enc)->fNext)
+        {
+            if (*enc == this)
+            {
+                *enc = fNext;
+                break;
+            }
+        }
     }
 
     virtual void setup() override
@@ -61,16 +101,10 @@ public:
 
     virtual void animate() override
     {
-        int32_t val = getValue();
-        int32_t curval = fValue;
         if (!fUseInterrupt)
-            interrupt();
-        if (val != curval)
-        {
-            // if (fChangeNotify != NULL)
-            //     fChangeNotify(val);
-            fValue = val;
-        }
+            update(readState());
+        fState.read(fFrame);
+        fValue = fFrame.fPosition;
     }
 
     void begin()
@@ -85,6 +119,7 @@ public:
         {
             detachInterrupt(fPin1);
             detachInterrupt(fPin2);
+            fUseInterrupt = 2;
         }
     }
 
@@ -101,7 +136,39 @@ public:
       */
     long getValue()
     {
-        return fPositionExt;
+        return getState().fPosition;
+    }
+
+    /**
+      * Returns a consistent copy of the current state
+      */
+    inline State getState() const
+    {
+        return fState.read();
+    }
+
+    /**
+      * Returns the state sampled by the last animated event
+      */
+    inline const State& getFrameState() const
+    {
+        return fFrame;
+    }
+
+    /**
+      * Returns the number of transitions that skipped a state (too fast or bouncing)
+      */
+    inline uint16_t getMissedCount() const
+    {
+        return getState().fMissed;
+    }
+
+    /**
+      * Returns the number of transitions that could not be decoded
+      */
+    inline uint16_t getInvalidCount() const
+    {
+        return getState().fInvalid;
     }
 
     /**
@@ -109,7 +176,8 @@ public:
       */
     bool isActive()
     {
-        return getValue() != 0 && getMillisBetweenRotations() < 250;
+        State state = getState();
+        return state.fPosition != 0 && state.fTime - state.fTimePrev < 250;
     }
 
     /**
@@ -118,22 +186,17 @@ public:
     Direction getDirection()
     {
         RotaryEncoder::Direction ret = Direction::kNoRotation;
+        long position = getValue();
 
-        if (fPositionExtPrev > fPositionExt)
+        if (fPositionExtPrev > position)
         {
             ret = Direction::kCounterClockwise;
-            fPositionExtPrev = fPositionExt;
         }
-        else if (fPositionExtPrev < fPositionExt)
+        else if (fPositionExtPrev < position)
         {
             ret = Direction::kClockwise;
-            fPositionExtPrev = fPositionExt;
-        }
-        else
-        {
-            ret = Direction::kNoRotation;
-            fPositionExtPrev = fPositionExt;
         }
+        fPositionExtPrev = position;
         return ret;
     }
 
@@ -142,23 +205,28 @@ public:
       */
     void setValue(long newValue)
     {
+        // The interrupt handler is the only other writer
+        if (fUseInterrupt == 1)
+            noInterrupts();
+        State& state = fState.beginWrite();
         switch (fMode)
         {
             case LatchMode::kFour3:
             case LatchMode::kFour0:
                 // only adjust the external part of the position.
                 fPosition = ((newValue << 2) | (fPosition & 0x03L));
-                fPositionExt = newValue;
-                fPositionExtPrev = newValue;
                 break;
 
             case LatchMode::kTwo03:
                 // only adjust the external part of the position.
                 fPosition = ((newValue << 1) | (fPosition & 0x01L));
-                fPositionExt = newValue;
-                fPositionExtPrev = newValue;
                 break;
         }
+        state.fPosition = newValue;
+        fState.endWrite();
+        if (fUseInterrupt == 1)
+            interrupts();
+        fPositionExtPrev = newValue;
     }
 
     /**
@@ -166,7 +234,8 @@ public:
       */
     uint32_t getMillisBetweenRotations() const
     {
-        return (fPositionExtTime - fPositionExtTimePrev);
+        State state = getState();
+        return (state.fTime - state.fTimePrev);
     }
 
     /**
@@ -175,82 +244,190 @@ public:
     uint32_t getRPM()
     {
         // calculate max of difference in time between last position changes or last change and now.
-        uint32_t timeBetweenLastPositions = fPositionExtTime - fPositionExtTimePrev;
-        uint32_t timeToLastPosition = millis() - fPositionExtTime;
+        State state = getState();
+        uint32_t timeBetweenLastPositions = state.fTime - state.fTimePrev;
+        uint32_t timeToLastPosition = millis() - state.fTime;
         uint32_t t = max(timeBetweenLastPositions, timeToLastPosition);
         return 60000.0 / ((float)(t * 20));
     }
 
+    /**
+      * Samples and decodes all interrupt driven encoders. Can be called from a shared
+      * port interrupt handler.
+      */
+    static void sampleAll()
+    {
+        PortCache cache;
+        for (RotaryEncoder* enc = head(); enc != nullptr; enc = enc->fNext)
+        {
+            if (enc->fUseInterrupt == 1)
+                enc->update(enc->readState(cache));
+        }
+    }
+
 protected:
     virtual void interrupt() override
+    {
+        sampleAll();
+    }
+
+    /**
+      * Decodes a new 2-bit input state (pin1 in bit 0, pin2 in bit 1)
+      */
+    void update(uint8_t thisState)
     {
         enum {
             kLatch0 = 0, // input state at position 0
-            kLatch3 = 3  // input state at position 3
+            kLatch3 = 3, // input state at position 3
+            kSkip = 2    // both inputs changed
         };
+        // Indexed by (previous state << 2) | new state
         static const int8_t KNOBDIR[] = {
-            0, -1, 1, 0,
-            1, 0, 0, -1,
-            -1, 0, 0, 1,
-            0, 1, -1, 0
+            0, -1, 1, kSkip,
+            1, 0, kSkip, -1,
+            -1, kSkip, 0, 1,
+            kSkip, 1, -1, 0
         };
-        int sig1 = digitalRead(fPin1);
-        int sig2 = digitalRead(fPin2);
-        int8_t thisState = sig1 | (sig2 << 1);
-        if (fOldState != thisState)
+        if (fOldState == thisState)
+            return;
+
+        int8_t step = KNOBDIR[thisState | (fOldState << 2)];
+        fOldState = thisState;
+
+        const State& current = fState.writerValue();
+        if (step == kSkip)
+        {
+            // A state was skipped. Assume the knob kept turning the same way.
+            if (fLastStep == 0)
+            {
+                State& state = fState.beginWrite();
+                state.fInvalid++;
+                fState.endWrite();
+                return;
+            }
+            step = fLastStep * 2;
+        }
+        else
         {
-            fPosition += KNOBDIR[thisState | (fOldState << 2)];
-            fOldState = thisState;
+            fLastStep = step;
+        }
+        fPosition += step;
+
+        long positionExt = current.fPosition;
+        bool latched = false;
+        switch (fMode)
+        {
+            case LatchMode::kFour3:
+                if (thisState == kLatch3)
+                {
+                    // The hardware has 4 steps with a latch on the input state 3
+                    positionExt = fPosition >> 2;
+                    latched = true;
+                }
+                break;
 
-            switch (fMode)
+            case LatchMode::kFour0:
+                if (thisState == kLatch0)
+                {
+                    // The hardware has 4 steps with a latch on the input state 0
+                    positionExt = fPosition >> 2;
+                    latched = true;
+                }
+                break;
+
+            case LatchMode::kTwo03:
+                if ((thisState == kLatch0) || (thisState == kLatch3))
+                {
+                    // The hardware has 2 steps with a latch on the input state 0 and 3
+                    positionExt = fPosition >> 1;
+                    latched = true;
+                }
+                break;
+        }
+        if (latched || abs(step) == 2)
+        {
+            State& state = fState.beginWrite();
+            if (abs(step) == 2)
+                state.fMissed++;
+            if (latched)
             {
-                case LatchMode::kFour3:
-                    if (thisState == kLatch3)
-                    {
-                        // The hardware has 4 steps with a latch on the input state 3
-                        fPositionExt = fPosition >> 2;
-                        fPositionExtTimePrev = fPositionExtTime;
-                        fPositionExtTime = millis();
-                    }
-                    break;
-
-                case LatchMode::kFour0:
-                    if (thisState == kLatch0)
-                    {
-                        // The hardware has 4 steps with a latch on the input state 0
-                        fPositionExt = fPosition >> 2;
-                        fPositionExtTimePrev = fPositionExtTime;
-                        fPositionExtTime = millis();
-                    }
-                    break;
-
-                case LatchMode::kTwo03:
-                    if ((thisState == kLatch0) || (thisState == kLatch3))
-                    {
-                        // The hardware has 2 steps with a latch on the input state 0 and 3
-                        fPositionExt = fPosition >> 1;
-                        fPositionExtTimePrev = fPositionExtTime;
-                        fPositionExtTime = millis();
-                    }
-                    break;
+                state.fPosition = positionExt;
+                state.fTimePrev = state.fTime;
+                state.fTime = millis();
             }
+            fState.endWrite();
         }
     }
 
+    /**
+      * Remembers the last port read so encoders sharing a port only read it once
+      */
+    struct PortCache
+    {
+    #ifdef __AVR__
+        volatile uint8_t* fInput = nullptr;
+        uint8_t fValue = 0;
+
+        inline uint8_t read(volatile uint8_t* input)
+        {
+            if (input != fInput)
+            {
+                fInput = input;
+                fValue = *input;
+            }
+            return fValue;
+        }
+    #endif
+    };
+
+    /**
+      * Reads the current 2-bit input state
+      */
+    inline uint8_t readState(PortCache& cache) const
+    {
+    #ifdef __AVR__
+        return ((cache.read(fInput1) & fMask1) ? 1 : 0) | ((cache.read(fInput2) & fMask2) ? 2 : 0);
+    #else
+        UNUSED_ARG(cache)
+        return digitalRead(fPin1) | (digitalRead(fPin2) << 1);
+    #endif
+    }
+
+    inline uint8_t readState() const
+    {
+        PortCache cache;
+        return readState(cache);
+    }
+
 private:
     byte fPin1;
     byte fPin2; // Arduino pins used for the encoder.
     LatchMode fMode; // Latch mode from initialization
     uint8_t fUseInterrupt;
+#ifdef __AVR__
+    volatile uint8_t* fInput1;
+    volatile uint8_t* fInput2;
+    uint8_t fMask1;
+    uint8_t fMask2;
+#endif
 
-    volatile int8_t fOldState;
+    // Owned by the interrupt handler
+    int8_t fOldState;
+    int8_t fLastStep = 0;
+    long fPosition = 0;                 // Internal position (4 times fPositionExt)
+    ISRSnapshot<State> fState;
 
+    // Owned by the main loop
     long fValue = 0;
-    volatile long fPosition = 0;        // Internal position (4 times fPositionExt)
-    volatile long fPositionExt = 0;     // External position
-    volatile long fPositionExtPrev = 0; // External position (used only for direction checking)
+    long fPositionExtPrev = 0;          // External position (used only for direction checking)
+    State fFrame = {};
+
+    RotaryEncoder* fNext;
 
-    uint32_t fPositionExtTime = 0;     // The time the last position change was detected.
-    uint32_t fPositionExtTimePrev = 0; // The time the previous position change was detected.
+    static RotaryEncoder*& head()
+    {
+        static RotaryEncoder* sHead;
+        return sHead;
+    }
 };
 #endif
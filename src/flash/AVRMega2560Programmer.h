@@ -15,6 +15,21 @@
 #define AVR_DEBUG_PRINTLN_HEX(s)
 #endif
 
+#ifndef MEGA_SERIAL_BAUD_RATE
+#define MEGA_SERIAL_BAUD_RATE 115200
+#endif
+
+// Allowance added to the computed time of each command for UART and task latency
+#ifndef MEGA_SERIAL_COMMAND_MARGIN
+#define MEGA_SERIAL_COMMAND_MARGIN 50
+#endif
+
+// Minimum time to wait for the sign-on reply. The Mega2560 fuses select a 65ms oscillator
+// start-up after reset before the boot loader can answer.
+#ifndef MEGA_SERIAL_SIGN_ON_TIMEOUT
+#define MEGA_SERIAL_SIGN_ON_TIMEOUT 200
+#endif
+
 /**
   * \ingroup Flash
   *
@@ -114,6 +129,8 @@ public:
         {
             mem->init();
         }
+        // The sketch may have written the EEPROM since the last session
+        fRegions.eeprom.forgetPages();
         for (;;)
         {
             // regrouping pause
@@ -152,6 +169,7 @@ public:
         AVR_DEBUG_PRINTLN();
         AVR_DEBUG_PRINTLN("Entered programming mode OK.");
         fProgMode = true;
+        resetStatistics();
         return true;    
     }
 
@@ -178,7 +196,7 @@ public:
     bool dumpMemory(MemType type)
     {
         Memory* mem = findRegion(type);
-        return (mem != NULL) ? dumpMemory(*mem) : false;
+        return (mem != NULL && mem->allocate()) ? dumpMemory(*mem) : false;
     }
 
     uint8_t* readMemory(MemType type, size_t* size)
@@ -186,7 +204,7 @@ public:
         if (size != NULL)
             *size = 0;
         Memory* mem = findRegion(type);
-        if (mem != NULL && readMemory(*mem))
+        if (mem != NULL && mem->allocate() && readMemory(*mem))
         {
             if (size != NULL)
                 *size = mem->size;
@@ -200,19 +218,90 @@ public:
         if (lineno != NULL)
             *lineno = 0;
         Memory* mem = findRegion(type);
-        return (mem != NULL) ? writeHexString(*mem, hexString, lineno) : false;
+        return (mem != NULL && mem->allocate()) ? writeHexString(*mem, hexString, lineno) : false;
+    }
+
+    /**
+      * Program an Intel HEX image read from a stream such as a file or an upload socket.
+      * Records are parsed as they arrive and each page is written as soon as the records
+      * move past it, so only a few page buffers are needed instead of an image of the
+      * whole region. Records must be in ascending address order.
+      */
+    bool writeHexStream(MemType type, Stream& in, bool verify = true)
+    {
+        Memory* mem = findRegion(type);
+        return (mem != NULL) ? writeHexStream(*mem, in, verify) : false;
     }
 
     bool writeMemory(MemType type, bool verify = true)
     {
         Memory* mem = findRegion(type);
-        return (mem != NULL) ? writeMemory(*mem, verify) : false;
+        return (mem != NULL && mem->allocate()) ? writeMemory(*mem, verify) : false;
     }
 
     bool hasMemoryChanged(MemType type)
     {
         Memory* mem = findRegion(type);
-        return (mem != NULL) ? hasMemoryChanged(*mem) : false;
+        return (mem != NULL && mem->buf != NULL) ? hasMemoryChanged(*mem) : false;
+    }
+
+    /**
+      * Enable delta programming. The CRC of every page written to or read from the target
+      * is cached, so writeHexString() no longer reads pages back before modifying them and
+      * writeMemory() only sends pages whose CRC differs from the cached value. Written pages
+      * are verified against their CRC. The flash cache is kept across startProgramming()
+      * calls. The EEPROM cache is not, as the running sketch may have changed the EEPROM.
+      */
+    void setDeltaMode(bool delta)
+    {
+        fDeltaMode = delta;
+    }
+
+    /**
+      * Set to true if the bootloader erases the page being written. The stock
+      * Arduino-stk500v2-bootloader erases pages in sequence so every page up to the last
+      * changed page has to be rewritten.
+      */
+    void setPagedErase(bool pagedErase)
+    {
+        fPagedErase = pagedErase;
+    }
+
+    /**
+      * Reset the transfer statistics. Called when entering programming mode.
+      */
+    void resetStatistics()
+    {
+        fBytesTransferred = 0;
+        fTransferStart = millis();
+    }
+
+    /**
+      * Number of bytes sent to and received from the bootloader since resetStatistics()
+      */
+    uint32_t getBytesTransferred() const
+    {
+        return fBytesTransferred;
+    }
+
+    /**
+      * Serial throughput since resetStatistics() in bytes per second
+      */
+    uint32_t getBytesPerSecond() const
+    {
+        uint32_t elapsed = millis() - fTransferStart;
+        return (elapsed != 0) ? uint32_t(uint64_t(fBytesTransferred) * 1000 / elapsed) : 0;
+    }
+
+    /**
+      * Forget the cached page CRCs. Call this if the target was programmed by other means.
+      */
+    void invalidatePageHashes()
+    {
+        for (Memory* mem = *Memory::head(); mem != NULL; mem = mem->next)
+        {
+            mem->forgetPages();
+        }
     }
 
 private:
@@ -579,6 +668,8 @@ private:
         uint8_t* buf = NULL;
         uint32_t* tags = NULL; 
         uint32_t* page_tags = NULL; 
+        uint32_t* page_hash = NULL;
+        uint32_t* page_known = NULL;
         Memory* next;
 
         Memory(MemType memtype) :
@@ -594,7 +685,40 @@ private:
 
         void init()
         {
+            // Page hashes describe the target and outlive dispose(). Without the cache
+            // every page is unknown and gets written.
+            if (page_size > 0 && page_hash == NULL)
+            {
+                unsigned tagsize = ((size/page_size)/32+1)*sizeof(uint32_t);
+                page_hash = (uint32_t*)cacheAlloc((size/page_size)*sizeof(uint32_t));
+                page_known = (uint32_t*)cacheAlloc(tagsize);
+                if (page_hash == NULL || page_known == NULL)
+                {
+                    free(page_hash);
+                    free(page_known);
+                    page_hash = NULL;
+                    page_known = NULL;
+                    return;
+                }
+                memset(page_known, 0, tagsize);
+            }
+        }
+
+        // The page cache is small enough for internal RAM on boards without PSRAM
+        static void* cacheAlloc(size_t size)
+        {
+            void* ptr = ps_malloc(size);
+            return (ptr != NULL) ? ptr : malloc(size);
+        }
+
+        // The image buffer is only allocated when the whole region is needed
+        bool allocate()
+        {
+            if (buf != NULL)
+                return true;
             buf = (uint8_t*)ps_malloc(size);
+            if (buf == NULL)
+                return false;
             memset(buf, 0xFF, size);
 
             unsigned tagsize = (size/32+1)*sizeof(uint32_t);
@@ -607,6 +731,7 @@ private:
                 page_tags = (uint32_t*)ps_malloc(tagsize);
                 memset(page_tags, 0, tagsize);
             }
+            return true;
         }
 
         void dispose()
@@ -626,6 +751,7 @@ private:
                 free(page_tags);
                 page_tags = NULL;
             }
+            loaded = false;
         }
 
         void tagAddress(unsigned addr, bool tag)
@@ -666,6 +792,81 @@ private:
             return false;
         }
 
+        static uint32_t crc32(const uint8_t* data, unsigned len)
+        {
+            uint32_t crc = ~0u;
+            while (len-- > 0)
+                crc = (crc >> 8) ^ _crc32_table[(crc ^ *data++) & 0xFF];
+            return ~crc;
+        }
+
+        uint32_t pageHash(unsigned addr)
+        {
+            return crc32(&buf[addr - addr % page_size], page_size);
+        }
+
+        bool isPageErased(unsigned addr)
+        {
+            const uint8_t* data = &buf[addr - addr % page_size];
+            for (unsigned i = 0; i < page_size; i++)
+            {
+                if (data[i] != 0xFF)
+                    return false;
+            }
+            return true;
+        }
+
+        bool isPageKnown(unsigned addr)
+        {
+            if (page_known != NULL && addr < size)
+            {
+                unsigned pageAddr = addr / page_size;
+                return ((page_known[pageAddr / 32] & (1 << (pageAddr % 32))) != 0);
+            }
+            return false;
+        }
+
+        uint32_t getPageHash(unsigned addr)
+        {
+            return (page_hash != NULL && addr < size) ? page_hash[addr / page_size] : 0;
+        }
+
+        void setPageHash(unsigned addr, uint32_t hash)
+        {
+            if (page_known != NULL && addr < size)
+            {
+                unsigned pageAddr = addr / page_size;
+                page_hash[pageAddr] = hash;
+                page_known[pageAddr / 32] |= (1 << (pageAddr % 32));
+            }
+        }
+
+        void forgetPage(unsigned addr)
+        {
+            if (page_known != NULL && addr < size)
+            {
+                unsigned pageAddr = addr / page_size;
+                page_known[pageAddr / 32] &= ~(1 << (pageAddr % 32));
+            }
+        }
+
+        void forgetPages()
+        {
+            if (page_known != NULL)
+                memset(page_known, 0, ((size/page_size)/32+1)*sizeof(uint32_t));
+        }
+
+        // Record the hash of every whole page in a block just read from the target
+        void rememberPages(unsigned addr, const uint8_t* data, unsigned len)
+        {
+            if (page_size == 0)
+                return;
+            unsigned end = addr + len;
+            unsigned start = (addr + page_size - 1) / page_size * page_size;
+            for (data += start - addr, addr = start; addr + page_size <= end; addr += page_size, data += page_size)
+                setPageHash(addr, crc32(data, page_size));
+        }
+
         uint8_t get(unsigned addr)
         {
             if (addr < size)
@@ -918,7 +1119,11 @@ private:
     uint32_t fEEPROMPageAddr;
     unsigned fEEPROMPageSize;
 
+    uint32_t fBytesTransferred = 0;
+    uint32_t fTransferStart = 0;
     bool fProgMode = false;
+    bool fDeltaMode = false;
+    bool fPagedErase = false;
     BootLoaderType fBootlLoader = kUnknown;
     ProgressProc fProgress = NULL;
 
@@ -971,15 +1176,70 @@ private:
             DEBUG_PRINTLN("failed to send command to serial port");
             return false;
         }
+        fBytesTransferred += len+6;
         return true;
     }
 
-    size_t serialRecv(uint8_t* buf, size_t len = 1)
+    /**
+      * Returns the time in milliseconds the command in buf needs: the command and its
+      * reply on the wire plus the time the target needs to execute it.
+      */
+    uint32_t commandTimeout(const unsigned char* buf, size_t len)
     {
-        return MEGA_SERIAL.readBytes(buf, len);
+        size_t replyLen = 2;
+        uint32_t execTime = 0;
+        switch (buf[0])
+        {
+            case CMD_SIGN_ON:
+                replyLen = 11;
+                break;
+            case CMD_ENTER_PROGMODE_ISP:
+                execTime = fStabDelay + fCmdExeDelay;
+                break;
+            case CMD_CHIP_ERASE_ISP:
+                execTime = fChipEraseDelay / 1000;
+                break;
+            case CMD_READ_FLASH_ISP:
+            case CMD_READ_EEPROM_ISP:
+                replyLen = (((unsigned)buf[1] << 8) | buf[2]) + 3;
+                break;
+            case CMD_PROGRAM_FLASH_ISP:
+                execTime = fRegions.flash.max_write_delay / 1000 + 1;
+                break;
+            case CMD_PROGRAM_EEPROM_ISP:
+                // written one byte at a time
+                execTime = ((((unsigned)buf[1] << 8) | buf[2]) * fRegions.eeprom.max_write_delay) / 1000 + 1;
+                break;
+            default:
+                replyLen = 4;
+                break;
+        }
+        uint32_t bits = uint32_t(len + 6 + replyLen + 6) * 10;
+        uint32_t timeoutMS = (bits * 1000 + MEGA_SERIAL_BAUD_RATE - 1) / MEGA_SERIAL_BAUD_RATE + execTime + MEGA_SERIAL_COMMAND_MARGIN;
+        if (buf[0] == CMD_SIGN_ON && timeoutMS < MEGA_SERIAL_SIGN_ON_TIMEOUT)
+            timeoutMS = MEGA_SERIAL_SIGN_ON_TIMEOUT;
+        return timeoutMS;
     }
 
-    int recv(unsigned char* msg, size_t maxsize)
+    bool serialRecv(uint8_t* c, uint32_t tstart, uint32_t timeoutMS)
+    {
+        while (MEGA_SERIAL.available() <= 0)
+        {
+            if (millis() - tstart > timeoutMS)
+                return false;
+            delay(1);
+        }
+        *c = MEGA_SERIAL.read();
+        return true;
+    }
+
+    void discardInput()
+    {
+        while (MEGA_SERIAL.available())
+            MEGA_SERIAL.read();
+    }
+
+    int recv(unsigned char* msg, size_t maxsize, uint32_t timeoutMS)
     {
         enum states { sINIT, sSTART, sSEQNUM, sSIZE1, sSIZE2, sTOKEN, sDATA, sCSUM, sDONE }  state = sSTART;
         unsigned int msglen = 0;
@@ -991,7 +1251,7 @@ private:
 
         while (state != sDONE && !timeout)
         {
-            if (serialRecv(&c, 1) == 0)
+            if (!serialRecv(&c, tstart, timeoutMS))
                 goto timedout;
             AVR_DEBUG_PRINT_HEX(c); AVR_DEBUG_PRINT(" ");
             checksum ^= c;
@@ -1078,7 +1338,7 @@ private:
                     return -5;
             }
 
-            if (millis() - tstart > MEGA_SERIAL_TIMEOUT)
+            if (millis() - tstart > timeoutMS)
             {           // wuff - signed/unsigned/overflow
             timedout:
                 AVR_DEBUG_PRINTLN("recv(): timeout");
@@ -1087,6 +1347,7 @@ private:
 
         }
         AVR_DEBUG_PRINTLN();
+        fBytesTransferred += msglen+6;
         return (int)(msglen+6);
     }
 
@@ -1103,10 +1364,11 @@ private:
 
         // send the sync command and see if we can get there
         buf[0] = CMD_SIGN_ON;
+        discardInput();
         send(buf, 1);
 
         // try to get the response back and see where we got
-        status = recv(resp, sizeof(resp));
+        status = recv(resp, sizeof(resp), commandTimeout(buf, 1));
 
         // if we got bytes returned, check to see what came back
         if (status > 0)
@@ -1187,43 +1449,21 @@ private:
         AVR_DEBUG_PRINT(", "); DEBUG_PRINTLN(len);
     #endif
 
+        uint32_t timeoutMS = commandTimeout(buf, len);
+
     retry:
         tries++;
 
         // send the command to the programmer
+        discardInput();
         send(buf,len);
         // attempt to read the status back
-        status = recv(buf,maxlen);
+        status = recv(buf,maxlen,timeoutMS);
 
         // if we got a successful readback, return
         if (status > 0)
         {
-            AVR_DEBUG_PRINT(" = "); AVR_DEBUG_PRINTLN(status);
-            if (status < 2)
-            {
-                AVR_DEBUG_PRINTLN("short reply");
-                return -1;
-            }
-            if (buf[1] >= STATUS_CMD_TOUT && buf[1] < 0xa0)
-            {
-                AVR_DEBUG_PRINTLN("command timed out");
-            }
-            else if (buf[1] == STATUS_CMD_OK)
-            {
-                return status;
-            }
-            else if (buf[1] == STATUS_CMD_FAILED)
-            {
-                AVR_DEBUG_PRINTLN("command failed");
-            }
-            else if (buf[1] == STATUS_CMD_UNKNOWN)
-            {
-                AVR_DEBUG_PRINTLN("unknown command");
-            }
-            else
-            {
-            }
-            return -1;
+            return replyStatus(buf, status);
         }
 
         // otherwise try to sync up again
@@ -1244,6 +1484,57 @@ private:
         return 0;
     }
 
+    int replyStatus(const unsigned char* buf, int status)
+    {
+        AVR_DEBUG_PRINT(" = "); AVR_DEBUG_PRINTLN(status);
+        if (status < 2)
+        {
+            AVR_DEBUG_PRINTLN("short reply");
+            return -1;
+        }
+        if (buf[1] >= STATUS_CMD_TOUT && buf[1] < 0xa0)
+        {
+            AVR_DEBUG_PRINTLN("command timed out");
+        }
+        else if (buf[1] == STATUS_CMD_OK)
+        {
+            return status;
+        }
+        else if (buf[1] == STATUS_CMD_FAILED)
+        {
+            AVR_DEBUG_PRINTLN("command failed");
+        }
+        else if (buf[1] == STATUS_CMD_UNKNOWN)
+        {
+            AVR_DEBUG_PRINTLN("unknown command");
+        }
+        return -1;
+    }
+
+    /**
+      * Wait for the reply to a program command already sent with send(). The reply is read
+      * into reply so the command in buf stays intact. If the reply is lost the target may
+      * already have written the block and advanced its address, so the block address is
+      * loaded again before the command is resent.
+      */
+    int writeReply(unsigned char* buf, size_t len, unsigned int blockAddr, unsigned char* reply, size_t maxlen)
+    {
+        uint32_t timeoutMS = commandTimeout(buf, len);
+        int status = recv(reply, maxlen, timeoutMS);
+        for (int tries = 0; status <= 0 && tries < RETRIES; tries++)
+        {
+            AVR_DEBUG_PRINTLN("reply lost, resending block");
+            // command() returns 0 if the address reply was lost as well
+            if (loadAddress(blockAddr) <= 0)
+                continue;
+            discardInput();
+            if (!send(buf, len))
+                return -1;
+            status = recv(reply, maxlen, timeoutMS);
+        }
+        return (status > 0) ? replyStatus(reply, status) : -1;
+    }
+
     int getparm(unsigned char parm, unsigned char * value)
     {
         unsigned char buf[32];
@@ -1391,11 +1682,10 @@ private:
                     return 0;
                 }
 
-                if (readPage(mem, pagesize, paddr, pagesize) < 0)
+                if (readPage(mem, pagesize, paddr, pagesize, cache_ptr) < 0)
                     return -1;
 
                 *paddr_ptr = paddr;
-                memcpy(cache_ptr, &mem.buf[paddr], pagesize);
                 *value = cache_ptr[addr & (pagesize - 1)];
                 return 0;
             }
@@ -1457,10 +1747,17 @@ private:
         return 0;
     }
 
-    int readPage(Memory& mem, unsigned page_size, unsigned addr, unsigned n_bytes)
+    int readPage(Memory& mem, unsigned page_size, unsigned addr, unsigned n_bytes, uint8_t* data = NULL)
     {
         if (mem.loaded)
+        {
+            if (data != NULL)
+                memcpy(data, &mem.buf[addr], n_bytes);
             return n_bytes;
+        }
+        // data receives the bytes starting at addr, default is the region image
+        uint8_t* dst = (data != NULL) ? data : &mem.buf[addr];
+        unsigned startaddr = addr;
         unsigned block_size, hiaddr, addrshift, use_ext_addr;
         unsigned maxaddr = addr + n_bytes;
         uint8_t commandbuf[4];
@@ -1526,7 +1823,8 @@ private:
             {
                 return -1;
             }
-            memcpy(&mem.buf[addr], &buf[2], block_size);
+            memcpy(&dst[addr - startaddr], &buf[2], block_size);
+            mem.rememberPages(addr, &dst[addr - startaddr], block_size);
         }
         return n_bytes;
     }
@@ -1557,17 +1855,18 @@ private:
         return (command(buf, 7, sizeof(buf)) >= 0) ? 0 : -1;
     }
 
-    int writePage(Memory& mem, unsigned page_size, uint32_t addr, unsigned n_bytes)
+    int writePage(Memory& mem, unsigned page_size, uint32_t addr, unsigned n_bytes, const uint8_t* data = NULL)
     {
-        unsigned block_size;
-        unsigned last_addr;
+        // data holds the bytes starting at addr, default is the region image
+        const uint8_t* src = (data != NULL) ? data : &mem.buf[addr];
+        uint32_t startaddr = addr;
         unsigned addrshift;
         unsigned use_ext_addr;
         uint32_t maxaddr = addr + n_bytes;
         uint8_t commandbuf[10];
-        uint8_t buf[266];
+        uint8_t buf[2][266];
+        uint8_t reply[8];
         uint8_t cmds[4];
-        int result;
         MemOp& rop = mem.invalid;
         MemOp& wop = mem.invalid;
 
@@ -1654,37 +1953,47 @@ private:
         commandbuf[8] = mem.readback_p1;
         commandbuf[9] = mem.readback_p2;
 
-        last_addr = ~0u;
-        for (; addr < maxaddr; addr += page_size)
-        {
-            if ((maxaddr - addr) < page_size)
-                block_size = maxaddr - addr;
-            else
-                block_size = page_size;
-
-            memcpy(buf,commandbuf,sizeof(commandbuf));
-
-            buf[1] = block_size >> 8;
-            buf[2] = block_size & 0xff;
+        if (n_bytes == 0)
+            return 0;
+        if (loadAddress(use_ext_addr | (addr >> addrshift)) < 0)
+            return -1;
 
-            if (last_addr == UINT_MAX || last_addr + block_size != addr)
+        // The target increments the address after each block. While one block is on
+        // the wire the next one is assembled in the other buffer.
+        unsigned cur = 0;
+        unsigned len = writePacket(buf[cur], commandbuf, &src[0], min(page_size, n_bytes));
+        while (addr < maxaddr)
+        {
+            uint32_t nextaddr = addr + len - 10;
+            unsigned nextlen = 0;
+            discardInput();
+            if (!send(buf[cur], len))
+                return -1;
+            if (nextaddr < maxaddr)
             {
-                if (loadAddress(use_ext_addr | (addr >> addrshift)) < 0)
-                    return -1;
+                nextlen = writePacket(buf[cur ^ 1], commandbuf, &src[nextaddr - startaddr],
+                    min(page_size, unsigned(maxaddr - nextaddr)));
             }
-            last_addr = addr;
-
-            memcpy(buf + 10, &mem.buf[addr], block_size);
-
-            result = command(buf, block_size + 10, sizeof(buf));
-            if (result < 0)
+            if (writeReply(buf[cur], len, use_ext_addr | (addr >> addrshift), reply, sizeof(reply)) < 0)
             {
                 return -1;
             }
+            addr = nextaddr;
+            len = nextlen;
+            cur ^= 1;
         }
         return n_bytes;
     }
 
+    static unsigned writePacket(uint8_t* buf, const uint8_t* commandbuf, const uint8_t* data, unsigned block_size)
+    {
+        memcpy(buf, commandbuf, 10);
+        buf[1] = block_size >> 8;
+        buf[2] = block_size & 0xff;
+        memcpy(buf + 10, data, block_size);
+        return block_size + 10;
+    }
+
     bool readMemory(Memory& mem)
     {
         if (mem.loaded)
@@ -1866,6 +2175,7 @@ private:
         if (!mem.page_size && !mem.loaded && !readMemory(mem))
             return false;
         unsigned lastPageRead = ~0u;
+        unsigned baseAddr = 0;
         while ((c = *ch++) != '\0')
         {
             line[linei] = '\0';
@@ -1880,9 +2190,11 @@ private:
                     if (status == 0)
                     {
                         // printf("address: %08x  ", addr);
+                        addr += baseAddr;
                         for (unsigned i = 0; i <= (n-1); i++)
                         {
-                            if (mem.page_size > 0)
+                            // In delta mode pages are compared by hash in writeMemory()
+                            if (mem.page_size > 0 && !fDeltaMode)
                             {
                                 unsigned pageNumber = addr / mem.page_size;
                                 if (!mem.loaded && lastPageRead != pageNumber)
@@ -1903,9 +2215,19 @@ private:
                         /* end of file */
                         return true;
                     }
-                    else if (status == 2)
+                    else if (status == 2 && n == 2)
+                    {
+                        /* extended segment address */
+                        baseAddr = ((unsigned(bytes[0]) << 8) | bytes[1]) << 4;
+                    }
+                    else if (status == 4 && n == 2)
                     {
-                        /* begin of file */
+                        /* extended linear address */
+                        baseAddr = ((unsigned(bytes[0]) << 8) | bytes[1]) << 16;
+                    }
+                    else if (status == 3 || status == 5)
+                    {
+                        /* start address */
                     }
                     else
                     {
@@ -1928,6 +2250,148 @@ private:
         return false;
     }
 
+    bool writeHexStream(Memory& mem, Stream& in, bool verify)
+    {
+        if (mem.page_size == 0 || !startProgramming())
+            return false;
+
+        // Pages assembled from the stream are only written to the target
+        mem.loaded = false;
+        bool sequential = (fBootlLoader == kAVRISP && !fPagedErase);
+        if (sequential)
+        {
+            // The bootloader erases pages in sequence so gaps in the image have to be
+            // written as erased pages. Make sure the erase address starts at zero.
+            // Boot loader will return failed so just ignore the error
+            (void) chipErase();
+        }
+        // page being assembled, erased page for gaps and readback for verify
+        uint8_t* page = (uint8_t*)malloc(mem.page_size * 3);
+        if (page == NULL)
+            return false;
+        uint8_t* erasedPage = page + mem.page_size;
+        uint8_t* verifyPage = erasedPage + mem.page_size;
+        memset(page, 0xFF, mem.page_size * 2);
+
+        char line[fBlockSize * 2];
+        uint8_t bytes[fBlockSize];
+        unsigned baseAddr = 0;
+        unsigned pageAddr = 0;
+        unsigned nextAddr = 0;
+        bool pageUsed = false;
+        bool success = false;
+        for (;;)
+        {
+            size_t len = in.readBytesUntil('\n', line, sizeof(line) - 1);
+            if (len == 0 && in.available() == 0)
+            {
+                // end of stream without end of file record
+                break;
+            }
+            if (len > 0 && line[len-1] == '\r')
+                len--;
+            line[len] = '\0';
+            if (len == 0)
+                continue;
+
+            int status;
+            unsigned n;
+            unsigned addr;
+            if (!parseHexLine(line, bytes, addr, n, status))
+                break;
+            if (status == 0)
+            {
+                unsigned i;
+                for (i = 0; i < n; i++)
+                {
+                    unsigned byteAddr = baseAddr + addr + i;
+                    unsigned byteAddrPage = byteAddr - byteAddr % mem.page_size;
+                    if (byteAddr >= mem.size || byteAddrPage < pageAddr)
+                    {
+                        // out of range or not in ascending order
+                        break;
+                    }
+                    if (byteAddrPage != pageAddr)
+                    {
+                        if (pageUsed && !streamPage(mem, pageAddr, page, erasedPage, verifyPage, verify, nextAddr))
+                            break;
+                        memset(page, 0xFF, mem.page_size);
+                        pageAddr = byteAddrPage;
+                        pageUsed = false;
+                    }
+                    page[byteAddr - pageAddr] = bytes[i];
+                    pageUsed = true;
+                }
+                if (i != n)
+                    break;
+            }
+            else if (status == 1)
+            {
+                /* end of file */
+                success = (!pageUsed || streamPage(mem, pageAddr, page, erasedPage, verifyPage, verify, nextAddr));
+                break;
+            }
+            else if (status == 2 && n == 2)
+            {
+                /* extended segment address */
+                baseAddr = ((unsigned(bytes[0]) << 8) | bytes[1]) << 4;
+            }
+            else if (status == 4 && n == 2)
+            {
+                /* extended linear address */
+                baseAddr = ((unsigned(bytes[0]) << 8) | bytes[1]) << 16;
+            }
+            else if (status != 3 && status != 5)
+            {
+                break;
+            }
+        }
+        free(page);
+        return success;
+    }
+
+    // Write the page at addr, preceded by erased pages for any gap if the bootloader
+    // erases pages in sequence
+    bool streamPage(Memory& mem, unsigned addr, const uint8_t* page, const uint8_t* erasedPage,
+                        uint8_t* verifyPage, bool verify, unsigned &nextAddr)
+    {
+        if (fBootlLoader == kAVRISP && !fPagedErase)
+        {
+            for (; nextAddr < addr; nextAddr += mem.page_size)
+            {
+                if (!programPage(mem, nextAddr, erasedPage, verifyPage, verify, false))
+                    return false;
+            }
+            nextAddr = addr + mem.page_size;
+            return programPage(mem, addr, page, verifyPage, verify, false);
+        }
+        return programPage(mem, addr, page, verifyPage, verify, fDeltaMode);
+    }
+
+    bool programPage(Memory& mem, unsigned addr, const uint8_t* data, uint8_t* verifyPage, bool verify, bool skipUnchanged)
+    {
+        uint32_t hash = Memory::crc32(data, mem.page_size);
+        if (!skipUnchanged || !mem.isPageKnown(addr) || mem.getPageHash(addr) != hash)
+        {
+            mem.forgetPage(addr);
+            if (writePage(mem, 0, addr, mem.page_size, data) < 0)
+                return false;
+            if (verify)
+            {
+                if (readPage(mem, mem.page_size, addr, mem.page_size, verifyPage) < 0)
+                    return false;
+                if (Memory::crc32(verifyPage, mem.page_size) != hash)
+                {
+                    // verify failed
+                    return false;
+                }
+            }
+            mem.setPageHash(addr, hash);
+        }
+        progressCallback((double)addr / (double)mem.size);
+        return true;
+    }
+
     bool hasMemoryChanged(Memory& mem)
     {
         if (mem.page_size != 0)
@@ -1954,7 +2418,18 @@ private:
         if (mem.page_size == 0)
             return false;
 
-        if (fBootlLoader == kAVRISP)
+        if (fDeltaMode)
+        {
+            // Only pages that differ from the last known target contents are written.
+            // Pages never seen on the target are written if the image has data for them.
+            for (unsigned addr = 0; addr < mem.size; addr += mem.page_size)
+            {
+                bool changed = (mem.isPageKnown(addr)) ?
+                    (mem.pageHash(addr) != mem.getPageHash(addr)) : !mem.isPageErased(addr);
+                mem.tagPage(addr, changed);
+            }
+        }
+        if (fBootlLoader == kAVRISP && !fPagedErase)
         {
             // We would like to update only tagged pages, but the default
             // Arduino-stk500v2-bootloader has a bug that maintains a separate
@@ -1979,30 +2454,44 @@ private:
             // Boot loader will return failed so just ignore the error
             (void) chipErase();
         }
-        uint8_t* verifyBuffer = (verify) ? (uint8_t*)alloca(mem.page_size) : NULL;
-        for (unsigned addr = 0; addr < mem.size; addr += mem.page_size)
+        for (unsigned addr = 0; addr < mem.size; )
         {
-            if (mem.isPageTagged(addr))
+            if (!mem.isPageTagged(addr))
             {
-                if (writePage(mem, 0, addr, mem.page_size) < 0)
+                addr += mem.page_size;
+                continue;
+            }
+            // Send runs of changed pages smaller than a block (EEPROM) as a single packet
+            unsigned len = mem.page_size;
+            while (len + mem.page_size <= fBlockSize && addr + len < mem.size && mem.isPageTagged(addr + len))
+                len += mem.page_size;
+
+            uint32_t hash = Memory::crc32(&mem.buf[addr], len);
+            for (unsigned offs = 0; offs < len; offs += mem.page_size)
+                mem.forgetPage(addr + offs);
+            if (writePage(mem, 0, addr, len) < 0)
+            {
+                return false;
+            }
+            if (verify)
+            {
+                if (readPage(mem, mem.page_size, addr, len) < 0)
                 {
                     return false;
                 }
-                if (verify)
+                if (Memory::crc32(&mem.buf[addr], len) != hash)
                 {
-                    memcpy(verifyBuffer, &mem.buf[addr], mem.page_size);
-                    if (readPage(mem, mem.page_size, addr, mem.page_size) < 0)
-                    {
-                        return false;
-                    }
-                    if (memcmp(verifyBuffer, &mem.buf[addr], mem.page_size) != 0)
-                    {
-                        // verify failed
-                        return false;
-                    }
-                    progressCallback((double)addr / (double)mem.size);
+                    // verify failed
+                    return false;
                 }
+                progressCallback((double)addr / (double)mem.size);
+            }
+            for (unsigned offs = 0; offs < len; offs += mem.page_size)
+            {
+                mem.setPageHash(addr + offs, mem.pageHash(addr + offs));
+                mem.tagPage(addr + offs, false);
             }
+            addr += len;
         }
         return true;
     }
@@ -6,6 +6,10 @@
 #include "core/CommandEvent.h"
 #include <Wire.h>
 
+#ifndef I2C_RECEIVER_QUEUE_DEPTH
+#define I2C_RECEIVER_QUEUE_DEPTH 4
+#endif
+
 /**
   * \ingroup i2c
   *
@@ -29,8 +33,12 @@
   * I2CReceiverBase<42> i2cReceiver(0x19);
   * \endcode
   *
+  * Received commands are queued in a ring of queueDepth command slots (default
+  * I2C_RECEIVER_QUEUE_DEPTH) that is filled by the Wire receive handler and drained by
+  * animate(), so a burst of commands arriving within one loop() is not lost. Commands
+  * arriving while the queue is full are dropped and counted by getOverflowCount().
   */
-template<int bufferSize = 32>
+template<int bufferSize = 32, int queueDepth = I2C_RECEIVER_QUEUE_DEPTH>
 class I2CReceiverBase : public AnimatedEvent
 {
 public:
@@ -75,51 +83,104 @@ public:
     }
 
     /**
-      * Dispatch any received i2c event to CommandEvent
+      * Dispatch all queued i2c commands to CommandEvent
       */
     virtual void animate() override
     {
-        if (fCmdReady && *fCmdString != 0)
+        while (fTail != fHead)
         {
-            if (fCmdString[1] == 0 && fCmdString[0] >= 0 && fCmdString[0] <= 9)
-            {
-                fCmdString[0] += '0';
-            }
-            if (fCallback != nullptr)
-            {
-                fCallback(fCmdString);
-            }
-            else
+            char* cmd = fSlots[fTail % queueDepth];
+            if (*cmd != 0)
             {
-                CommandEvent::process(fCmdString);
+                if (cmd[1] == 0 && cmd[0] >= 0 && cmd[0] <= 9)
+                {
+                    cmd[0] += '0';
+                }
+                if (fCallback != nullptr)
+                {
+                    fCallback(cmd);
+                }
+                else
+                {
+                    CommandEvent::process(cmd);
+                }
             }
+            // Release the slot only after the command has been processed
+            asm volatile("" ::: "memory");
+            fTail = fTail + 1;
         }
-        fCmdReady = false;
+    }
+
+    /**
+      * \returns number of commands dropped because the queue was full
+      */
+    inline uint16_t getOverflowCount() const
+    {
+        return fOverflowCount;
+    }
+
+    /**
+      * \returns number of commands truncated to fit bufferSize
+      */
+    inline uint16_t getTruncatedCount() const
+    {
+        return fTruncatedCount;
+    }
+
+    void resetCounters()
+    {
+        fOverflowCount = 0;
+        fTruncatedCount = 0;
     }
 
 private:
-    char fCmdString[bufferSize];
-    volatile bool fCmdReady = false;
+    static_assert(queueDepth > 0 && queueDepth <= 128 && (queueDepth & (queueDepth - 1)) == 0,
+        "queueDepth must be a power of two no larger than 128");
+
+    // Single producer (receive handler) writes fHead, single consumer (animate) writes fTail.
+    // Both are free running so the number of queued commands is fHead - fTail.
+    char fSlots[queueDepth][bufferSize];
+    volatile uint8_t fHead = 0;
+    volatile uint8_t fTail = 0;
+    volatile uint16_t fOverflowCount = 0;
+    volatile uint16_t fTruncatedCount = 0;
     void (*fCallback)(char*) = nullptr;
 
     void handleEvent(int howMany)
     {
         UNUSED_ARG(howMany)
-        /* ignore any new i2c event until previous one has been processed */
-        if (fCmdReady)
+        uint8_t head = fHead;
+        if (uint8_t(head - fTail) >= queueDepth)
+        {
+            /* queue is full drop the command */
+            while (Wire.available())
+                Wire.read();
+            fOverflowCount = fOverflowCount + 1;
             return;
+        }
+        char* cmd = fSlots[head % queueDepth];
+        bool truncated = false;
+        *cmd = 0;
         for (byte i = 0; Wire.available();)
         {
             char ch = (char)Wire.read();
             // Dont add leading whitespace
-            if (i < sizeof(fCmdString) - 1 && (i != 0 || !isspace(ch)))
+            if (i < bufferSize - 1 && (i != 0 || !isspace(ch)))
+            {
+                cmd[i++] = (ch != '\r') ? ch : '\n';
+                cmd[i] = 0;
+            }
+            else if (i != 0)
             {
-                fCmdString[i++] = (ch != '\r') ? ch : '\n';
-                fCmdString[i] = 0;
+                truncated = true;
             }
         }
-        // DEBUG_PRINTLN(fCmdString);
-        fCmdReady = true;
+        if (truncated)
+            fTruncatedCount = fTruncatedCount + 1;
+        // DEBUG_PRINTLN(cmd);
+        // Publish the slot only after it has been filled
+        asm volatile("" ::: "memory");
+        fHead = head + 1;
     }
 
     static void i2cEvent(int howMany)
@@ -127,9 +188,9 @@ private:
         (*myself())->handleEvent(howMany);
     }
 
-    static I2CReceiverBase<bufferSize>** myself()
+    static I2CReceiverBase<bufferSize, queueDepth>** myself()
     {
-        static I2CReceiverBase<bufferSize>* self;
+        static I2CReceiverBase<bufferSize, queueDepth>* self;
         return &self;
     }
 
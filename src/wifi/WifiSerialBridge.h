@@ -7,28 +7,50 @@
 #include <WiFi.h>
 #include <WiFiClient.h>
 #include <WiFiAP.h>
+#include "wifi/WifiAccess.h"
+
+#ifndef WIFI_SERIAL_BRIDGE_BUFFER_SIZE
+#define WIFI_SERIAL_BRIDGE_BUFFER_SIZE 2048     /* must be a power of two */
+#endif
+
+#ifndef WIFI_SERIAL_BRIDGE_COALESCE_SIZE
+#define WIFI_SERIAL_BRIDGE_COALESCE_SIZE 256    /* bytes */
+#endif
+
+#ifndef WIFI_SERIAL_BRIDGE_LATENCY
+#define WIFI_SERIAL_BRIDGE_LATENCY 2000         /* microseconds */
+#endif
 
 /**
   * \ingroup wifi
   *
   * \class WifiSerialBridgeBase
   *
-  * \brief Base template of automatic forwarder from i2c to CommandEvent
+  * \brief Bidirectional bridge between a HardwareSerial port and TCP clients
+  *
+  * Data received from any client is written to the serial port and data received from
+  * the serial port is sent to all connected clients. Each direction has a ring buffer of
+  * WIFI_SERIAL_BRIDGE_BUFFER_SIZE bytes and data is moved using bulk reads and writes.
+  *
+  * Serial data is sent to a client once WIFI_SERIAL_BRIDGE_COALESCE_SIZE bytes are
+  * pending for it or its oldest pending byte has waited WIFI_SERIAL_BRIDGE_LATENCY
+  * microseconds.
+  * Nothing is dropped: if a client is slow the serial port is not read until it catches
+  * up, and if the serial port is slow the clients are not read.
   *
-  * Create an instance of this template to automatically forward i2c string commands to CommandEvent.
-  * A convenience type of I2CReceiver is provided that uses the default buffer size of 32 bytes. Only
-  * a single instance of I2CReceiver should be created per sketch.
+  * The serial port is only read while at least one client is connected. On ESP32 call
+  * start() to run the bridge in its own task, otherwise it runs from animate().
   *
   * \code
   * #include "wifi/WifiSerialBridge.h"
   *
-  * WifiSerialBridge wifiSerialBridge(2000);
+  * WifiSerialBridge wifiSerialBridge(Serial2, wifiAccess, 2000);
   * \endcode
   *
   * To support more than one client (for example) use:
   *
   * \code
-  * WifiSerialBridgeBase<2> wifiSerialBridge(2000);
+  * WifiSerialBridgeBase<2> wifiSerialBridge(Serial2, wifiAccess, 2000);
   * \endcode
   *
   */
@@ -51,6 +73,26 @@ public:
         wifiAccess.addNotify(this);
     }
 
+#ifdef ESP32
+    /**
+      * Run the bridge in its own task instead of animate()
+      */
+    void start(unsigned priority = 1, int core = 0)
+    {
+        if (fTask == nullptr)
+        {
+            xTaskCreatePinnedToCore(
+                  bridgeTask,
+                  "bridge",
+                  4000,
+                  this,
+                  priority,
+                  &fTask,
+                  core);
+        }
+    }
+#endif
+
     void setEnabled(bool enabled)
     {
         fEnabled = enabled;
@@ -61,6 +103,61 @@ public:
         return fEnabled;
     }
 
+    /**
+      * Echo data received from a client back to it (default true)
+      */
+    void setEcho(bool echo)
+    {
+        fEcho = echo;
+    }
+
+    /** Total number of bytes written to the serial port */
+    inline uint32_t getBytesToSerial() const
+    {
+        return fBytesToSerial;
+    }
+
+    /** Total number of bytes read from the serial port */
+    inline uint32_t getBytesFromSerial() const
+    {
+        return fBytesFromSerial;
+    }
+
+    /** Number of times reading the serial port was deferred because a client was behind */
+    inline uint32_t getSerialStalls() const
+    {
+        return fSerialStalls;
+    }
+
+    /** Number of times reading the clients was deferred because the serial port was behind */
+    inline uint32_t getClientStalls() const
+    {
+        return fClientStalls;
+    }
+
+    /** Maximum time in microseconds serial data waited before being sent to the clients */
+    inline uint32_t getLatencyMax() const
+    {
+        return fLatencyMax;
+    }
+
+    /** Average time in microseconds serial data waited before being sent to the clients */
+    inline uint32_t getLatencyAverage() const
+    {
+        return (fLatencyCount != 0) ? fLatencySum / fLatencyCount : 0;
+    }
+
+    void resetStatistics()
+    {
+        fBytesToSerial = 0;
+        fBytesFromSerial = 0;
+        fSerialStalls = 0;
+        fClientStalls = 0;
+        fLatencyMax = 0;
+        fLatencySum = 0;
+        fLatencyCount = 0;
+    }
+
     virtual void wifiConnected(WifiAccess& access) override
     {
         DEBUG_PRINTLN("WifiSerialBridgeBase.wifiConnected");
@@ -84,13 +181,101 @@ public:
     }
 
     /**
-      * Dispatch any received i2c event to CommandEvent
+      * Forward data between the clients and the serial port unless running in a task
       */
     virtual void animate() override
     {
-        unsigned i;
-        if (!enabled())
+    #ifdef ESP32
+        if (fTask != nullptr)
             return;
+    #endif
+        process();
+    }
+
+    /**
+      * Accept new clients and forward data in both directions
+      */
+    void process()
+    {
+        if (!enabled() || !fStarted)
+            return;
+        acceptClients();
+
+        uint32_t minTail = fFromSerialHead;
+        bool connected = false;
+        for (unsigned i = 0; i < maxClients; i++)
+        {
+            if (fClients[i] && fClients[i].connected())
+            {
+                receiveClient(fClients[i]);
+                if (!connected || int32_t(fClientTail[i] - minTail) < 0)
+                    minTail = fClientTail[i];
+                connected = true;
+            }
+            else if (fClients[i])
+            {
+                fClients[i].stop();
+            }
+        }
+        writeSerial();
+        if (connected)
+        {
+            readSerial(minTail);
+            sendClients();
+        }
+    }
+
+private:
+    static_assert((WIFI_SERIAL_BRIDGE_BUFFER_SIZE & (WIFI_SERIAL_BRIDGE_BUFFER_SIZE - 1)) == 0,
+        "WIFI_SERIAL_BRIDGE_BUFFER_SIZE must be a power of two");
+
+    enum
+    {
+        kBufferMask = WIFI_SERIAL_BRIDGE_BUFFER_SIZE - 1
+    };
+
+    HardwareSerial& fSerial;
+    bool fStarted = false;
+    bool fEnabled = true;
+    bool fEcho = true;
+#ifdef ESP32
+    TaskHandle_t fTask = nullptr;
+#endif
+
+    // Client to serial ring buffer
+    uint8_t fToSerial[WIFI_SERIAL_BRIDGE_BUFFER_SIZE];
+    uint32_t fToSerialHead = 0;
+    uint32_t fToSerialTail = 0;
+
+    // Serial to client ring buffer with one read position per client
+    uint8_t fFromSerial[WIFI_SERIAL_BRIDGE_BUFFER_SIZE];
+    uint32_t fFromSerialHead = 0;
+    uint32_t fClientTail[maxClients] = {};
+    uint32_t fOldestPending[maxClients] = {};
+
+    uint32_t fBytesToSerial = 0;
+    uint32_t fBytesFromSerial = 0;
+    uint32_t fSerialStalls = 0;
+    uint32_t fClientStalls = 0;
+    uint32_t fLatencyMax = 0;
+    uint32_t fLatencySum = 0;
+    uint32_t fLatencyCount = 0;
+
+#ifdef ESP32
+    static void bridgeTask(void* arg)
+    {
+        WifiSerialBridgeBase<maxClients>* self = (WifiSerialBridgeBase<maxClients>*)arg;
+        for (;;)
+        {
+            self->process();
+            vTaskDelay(1);
+        }
+    }
+#endif
+
+    void acceptClients()
+    {
+        unsigned i;
         //check if there are any new clients
         if (hasClient())
         {
@@ -104,6 +289,9 @@ public:
                     fClients[i] = available();
                     if (!fClients[i])
                         DEBUG_PRINTLN("available broken");
+                    fClients[i].setNoDelay(true);
+                    // New clients only receive data from now on
+                    fClientTail[i] = fFromSerialHead;
                     DEBUG_PRINT("New client: ");
                     DEBUG_PRINT(i); DEBUG_PRINT(' ');
                     DEBUG_PRINTLN(fClients[i].remoteIP());
@@ -116,36 +304,105 @@ public:
                 available().stop();
             }
         }
-        //check clients for data
-        for (i = 0; i < maxClients; i++)
+    }
+
+    void receiveClient(WiFiClient& client)
+    {
+        int avail;
+        while ((avail = client.available()) > 0)
         {
-            if (fClients[i] && fClients[i].connected())
+            uint32_t space = WIFI_SERIAL_BRIDGE_BUFFER_SIZE - (fToSerialHead - fToSerialTail);
+            if (space == 0)
             {
-                if (fClients[i].available())
-                {
-                    //get data from the telnet client and push it to the UART
-                    while (fClients[i].available())
-                    {
-                        char ch = fClients[i].read();
-                        fClients[i].write(ch);
-                        fSerial.write(ch);
-                    }
-                }
+                // Leave the data in the socket until the serial port catches up
+                fClientStalls++;
+                break;
             }
-            else
+            uint32_t index = fToSerialHead & kBufferMask;
+            size_t len = min(min(size_t(space), size_t(WIFI_SERIAL_BRIDGE_BUFFER_SIZE - index)), size_t(avail));
+            int n = client.read(&fToSerial[index], len);
+            if (n <= 0)
+                break;
+            if (fEcho)
+                client.write(&fToSerial[index], n);
+            fToSerialHead += n;
+        }
+    }
+
+    void writeSerial()
+    {
+        while (fToSerialTail != fToSerialHead)
+        {
+            uint32_t index = fToSerialTail & kBufferMask;
+            size_t len = min(size_t(fToSerialHead - fToSerialTail), size_t(WIFI_SERIAL_BRIDGE_BUFFER_SIZE - index));
+            int room = fSerial.availableForWrite();
+            if (room <= 0)
+                break;
+            size_t n = fSerial.write(&fToSerial[index], min(len, size_t(room)));
+            fToSerialTail += n;
+            fBytesToSerial += n;
+            if (n < len)
+                break;
+        }
+    }
+
+    void readSerial(uint32_t minTail)
+    {
+        int avail;
+        while ((avail = fSerial.available()) > 0)
+        {
+            uint32_t space = WIFI_SERIAL_BRIDGE_BUFFER_SIZE - (fFromSerialHead - minTail);
+            if (space == 0)
             {
-                if (fClients[i])
-                {
-                    fClients[i].stop();
-                }
+                // Leave the data in the UART until the slowest client catches up
+                fSerialStalls++;
+                break;
             }
+            uint32_t index = fFromSerialHead & kBufferMask;
+            size_t len = min(min(size_t(space), size_t(WIFI_SERIAL_BRIDGE_BUFFER_SIZE - index)), size_t(avail));
+            size_t n = fSerial.read(&fFromSerial[index], len);
+            if (n == 0)
+                break;
+            // Clients that had nothing pending start waiting now
+            uint32_t now = micros();
+            for (unsigned i = 0; i < maxClients; i++)
+            {
+                if (fClientTail[i] == fFromSerialHead)
+                    fOldestPending[i] = now;
+            }
+            fFromSerialHead += n;
+            fBytesFromSerial += n;
         }
     }
 
-private:
-    HardwareSerial& fSerial;
-    bool fStarted = false;
-    bool fEnabled = true;
+    void sendClients()
+    {
+        uint32_t now = micros();
+        for (unsigned i = 0; i < maxClients; i++)
+        {
+            if (!fClients[i] || !fClients[i].connected())
+                continue;
+            uint32_t waited = now - fOldestPending[i];
+            uint32_t pending = fFromSerialHead - fClientTail[i];
+            if (pending == 0 || (pending < WIFI_SERIAL_BRIDGE_COALESCE_SIZE && waited < WIFI_SERIAL_BRIDGE_LATENCY))
+                continue;
+            while (pending != 0)
+            {
+                uint32_t index = fClientTail[i] & kBufferMask;
+                size_t len = min(size_t(pending), size_t(WIFI_SERIAL_BRIDGE_BUFFER_SIZE - index));
+                size_t n = fClients[i].write(&fFromSerial[index], len);
+                fClientTail[i] += n;
+                pending -= n;
+                if (n < len)
+                    break;
+            }
+            // Bytes the client did not accept keep their timestamp and are sent on the next pass
+            if (waited > fLatencyMax)
+                fLatencyMax = waited;
+            fLatencySum += waited;
+            fLatencyCount++;
+        }
+    }
 };
 
 /**
@@ -160,7 +417,7 @@ private:
   * \code
   * #include "wifi/WifiSerialBridge.h"
   *
-  * WifiSerialBridge wifiSerialBridge(2000);
+  * WifiSerialBridge wifiSerialBridge(Serial2, wifiAccess, 2000);
   * \endcode
   *
   */
@@ -0,0 +1,507 @@
+#ifndef WifiUploadStream_h
+#define WifiUploadStream_h
+
+#include "ReelTwo.h"
+#include <WiFiClient.h>
+#include <FS.h>
+#ifdef ESP32
+#include <Update.h>
+#endif
+
+#ifndef WIFI_WEB_UPLOAD_BLOCK_SIZE
+#define WIFI_WEB_UPLOAD_BLOCK_SIZE 4096
+#endif
+
+#ifndef WIFI_WEB_UPLOAD_READ_SIZE
+#define WIFI_WEB_UPLOAD_READ_SIZE 1436
+#endif
+
+#ifndef WIFI_WEB_UPLOAD_TASK_STACK
+#define WIFI_WEB_UPLOAD_TASK_STACK 4096
+#endif
+
+/**
+  * \ingroup wifi
+  *
+  * \class WUploadSink
+  *
+  * \brief Destination for data received by WUploadStream.
+  *
+  * On ESP32 write() is called from the upload writer task.
+  */
+class WUploadSink
+{
+public:
+    /** Prepare to receive at most size bytes */
+    virtual bool begin(size_t size) = 0;
+
+    virtual bool write(const uint8_t* data, size_t len) = 0;
+
+    /** Finish the upload. If commit is false the upload failed and should be discarded */
+    virtual bool end(bool commit) = 0;
+};
+
+#ifdef ESP32
+/**
+  * \ingroup wifi
+  *
+  * \class WOTAUploadSink
+  *
+  * \brief Writes the uploaded firmware image to the next OTA partition.
+  */
+class WOTAUploadSink : public WUploadSink
+{
+public:
+    virtual bool begin(size_t size) override
+    {
+        // Multipart uploads are smaller than the content length
+        return Update.begin(UPDATE_SIZE_UNKNOWN);
+    }
+
+    virtual bool write(const uint8_t* data, size_t len) override
+    {
+        return Update.write((uint8_t*)data, len) == len;
+    }
+
+    virtual bool end(bool commit) override
+    {
+        if (!commit)
+        {
+            Update.abort();
+            return false;
+        }
+        return Update.end(true);
+    }
+};
+#endif
+
+/**
+  * \ingroup wifi
+  *
+  * \class WFileUploadSink
+  *
+  * \brief Writes the uploaded data to a temporary file that replaces path once the upload is verified.
+  */
+class WFileUploadSink : public WUploadSink
+{
+public:
+    WFileUploadSink(fs::FS& fs, String path) :
+        fFS(fs),
+        fPath(path),
+        fTempPath(path + ".tmp")
+    {
+    }
+
+    virtual bool begin(size_t size) override
+    {
+        fFile = fFS.open(fTempPath, FILE_WRITE);
+        return bool(fFile);
+    }
+
+    virtual bool write(const uint8_t* data, size_t len) override
+    {
+        return fFile.write(data, len) == len;
+    }
+
+    virtual bool end(bool commit) override
+    {
+        fFile.close();
+        if (commit)
+        {
+            fFS.remove(fPath);
+            if (fFS.rename(fTempPath, fPath))
+                return true;
+        }
+        fFS.remove(fTempPath);
+        return false;
+    }
+
+private:
+    fs::FS& fFS;
+    String fPath;
+    String fTempPath;
+    fs::File fFile;
+};
+
+/**
+  * \ingroup wifi
+  *
+  * \class WUploadStream
+  *
+  * \brief Receives an upload body in blocks and writes it to a WUploadSink.
+  *
+  * Socket data is read in blocks into one of two WIFI_WEB_UPLOAD_BLOCK_SIZE buffers.
+  * On ESP32 full buffers are handed to a writer task so the flash write of one block
+  * overlaps receiving the next. If both buffers are busy no more data is read from the
+  * socket and TCP flow control slows down the sender.
+  *
+  * If the request is multipart/form-data only the contents of the first part are
+  * written. A CRC32 of the written data is kept and compared against the expected
+  * value (if any) before the sink is asked to commit.
+  */
+class WUploadStream
+{
+public:
+    WUploadStream(WUploadSink& sink) :
+        fSink(sink)
+    {
+    }
+
+    ~WUploadStream()
+    {
+        stopWriter();
+        for (unsigned i = 0; i < 2; i++)
+        {
+            if (fBuffer[i] != nullptr)
+                free(fBuffer[i]);
+        }
+    }
+
+    /**
+      * Start receiving contentLength bytes. If boundary is not null the body is multipart.
+      * If expectedCRC is not null it is the hexadecimal CRC32 of the file contents.
+      */
+    bool begin(size_t contentLength, const char* boundary, size_t boundaryLen, const char* expectedCRC)
+    {
+        fContentLength = contentLength;
+        fStartTime = millis();
+        if (expectedCRC != nullptr)
+        {
+            fExpectedCRC = strtoul(expectedCRC, nullptr, 16);
+            fHasExpectedCRC = true;
+        }
+        if (boundary != nullptr && boundaryLen <= sizeof(fDelimiter) - 5)
+        {
+            memcpy(fDelimiter, "\r\n--", 4);
+            memcpy(fDelimiter + 4, boundary, boundaryLen);
+            fDelimiterLen = 4 + boundaryLen;
+            fDelimiter[fDelimiterLen] = '\0';
+            fPart = kPartHeaders;
+        }
+        for (unsigned i = 0; i < 2; i++)
+        {
+            fBuffer[i] = (uint8_t*)malloc(WIFI_WEB_UPLOAD_BLOCK_SIZE);
+            if (fBuffer[i] == nullptr)
+                return fail();
+        }
+        if (!fSink.begin(contentLength))
+            return fail();
+        fSinkOpen = true;
+    #ifdef ESP32
+        fFree = xQueueCreate(2, sizeof(uint8_t));
+        fFull = xQueueCreate(2, sizeof(Block));
+        fDone = xSemaphoreCreateBinary();
+        if (fFree == nullptr || fFull == nullptr || fDone == nullptr)
+            return fail();
+        for (uint8_t i = 0; i < 2; i++)
+            xQueueSend(fFree, &i, 0);
+        if (xTaskCreate(writerTask, "upload", WIFI_WEB_UPLOAD_TASK_STACK, this, 1, &fTask) != pdPASS)
+        {
+            fTask = nullptr;
+            return fail();
+        }
+    #endif
+        return true;
+    }
+
+    /**
+      * Read all available data from the client. Returns false if the upload failed.
+      */
+    bool receive(Client& client)
+    {
+        while (!fError && fReceived < fContentLength)
+        {
+            if (fFill < 0 && !acquire())
+                break;
+            size_t space = WIFI_WEB_UPLOAD_BLOCK_SIZE - fFillLen;
+            if (space <= fDelimiterLen)
+            {
+                submit();
+                continue;
+            }
+            int avail = client.available();
+            if (avail <= 0)
+                break;
+            size_t len = min(size_t(avail), fContentLength - fReceived);
+            uint8_t* fill = fBuffer[fFill];
+            if (fDelimiterLen == 0)
+            {
+                // Raw body is read straight into the block buffer
+                int n = client.read(fill + fFillLen, min(len, space));
+                if (n <= 0)
+                    break;
+                fFillLen += n;
+                fReceived += n;
+            }
+            else
+            {
+                // Filtering may release up to fDelimiterLen held back bytes
+                uint8_t raw[128];
+                len = min(len, min(space - fDelimiterLen, sizeof(raw)));
+                int n = client.read(raw, len);
+                if (n <= 0)
+                    break;
+                fReceived += n;
+                for (int i = 0; i < n; i++)
+                    filter(raw[i]);
+            }
+            if (fFillLen == WIFI_WEB_UPLOAD_BLOCK_SIZE)
+                submit();
+        }
+        fEndTime = millis();
+        return !fError;
+    }
+
+    inline bool isComplete() const
+    {
+        return fReceived >= fContentLength;
+    }
+
+    /**
+      * Write any remaining data, wait for the writer to finish and verify the CRC. The
+      * sink commits the upload only if everything succeeded. Returns true on success.
+      */
+    bool end()
+    {
+        if (fFill >= 0 && fFillLen != 0)
+            submit();
+        stopWriter();
+        if (fDelimiterLen != 0 && fPart != kPartTrailer)
+            fError = true;
+        if (!isComplete())
+            fError = true;
+        if (fHasExpectedCRC && ~fCRC != fExpectedCRC)
+        {
+            DEBUG_PRINTLN("UPLOAD CRC MISMATCH");
+            fCRCMismatch = true;
+            fError = true;
+        }
+        if (fSinkOpen)
+        {
+            fSinkOpen = false;
+            if (!fSink.end(!fError))
+                fError = true;
+        }
+        fSucceeded = !fError;
+        return fSucceeded;
+    }
+
+    /**
+      * Discard the upload
+      */
+    void abort()
+    {
+        stopWriter();
+        fError = true;
+        if (fSinkOpen)
+        {
+            fSinkOpen = false;
+            fSink.end(false);
+        }
+    }
+
+    inline bool succeeded() const
+    {
+        return fSucceeded;
+    }
+
+    inline bool crcMismatch() const
+    {
+        return fCRCMismatch;
+    }
+
+    /** CRC32 of the data written so far */
+    inline uint32_t getCRC() const
+    {
+        return ~fCRC;
+    }
+
+    inline size_t getContentLength() const
+    {
+        return fContentLength;
+    }
+
+    inline size_t getReceived() const
+    {
+        return fReceived;
+    }
+
+    /** Number of bytes written to the sink */
+    inline size_t getWritten() const
+    {
+        return fWritten;
+    }
+
+    uint32_t getBytesPerSecond() const
+    {
+        uint32_t elapsed = fEndTime - fStartTime;
+        return (elapsed != 0) ? uint64_t(fReceived) * 1000 / elapsed : 0;
+    }
+
+private:
+    enum Part
+    {
+        kPartRaw,
+        kPartHeaders,
+        kPartData,
+        kPartTrailer
+    };
+
+    struct Block
+    {
+        uint8_t index;
+        uint16_t len;
+    };
+
+    WUploadSink& fSink;
+    uint8_t* fBuffer[2] = { nullptr, nullptr };
+    int8_t fFill = -1;
+    size_t fFillLen = 0;
+    size_t fContentLength = 0;
+    size_t fReceived = 0;
+    volatile size_t fWritten = 0;
+    volatile uint32_t fCRC = ~0u;
+    uint32_t fExpectedCRC = 0;
+    bool fHasExpectedCRC = false;
+    volatile bool fError = false;
+    bool fCRCMismatch = false;
+    bool fSucceeded = false;
+    bool fSinkOpen = false;
+    uint32_t fStartTime = 0;
+    uint32_t fEndTime = 0;
+
+    // Multipart state
+    uint8_t fPart = kPartRaw;
+    char fDelimiter[4 + 70 + 1];
+    size_t fDelimiterLen = 0;
+    size_t fMatch = 0;
+    uint32_t fLast4 = 0;
+
+#ifdef ESP32
+    QueueHandle_t fFree = nullptr;
+    QueueHandle_t fFull = nullptr;
+    SemaphoreHandle_t fDone = nullptr;
+    TaskHandle_t fTask = nullptr;
+
+    static void writerTask(void* arg)
+    {
+        WUploadStream* self = (WUploadStream*)arg;
+        Block block;
+        while (xQueueReceive(self->fFull, &block, portMAX_DELAY) == pdTRUE && block.len != 0)
+        {
+            self->write(block.index, block.len);
+            xQueueSend(self->fFree, &block.index, 0);
+        }
+        xSemaphoreGive(self->fDone);
+        vTaskDelete(nullptr);
+    }
+#endif
+
+    bool fail()
+    {
+        fError = true;
+        abort();
+        return false;
+    }
+
+    void write(uint8_t index, size_t len)
+    {
+        const uint8_t* data = fBuffer[index];
+        uint32_t crc = fCRC;
+        for (size_t i = 0; i < len; i++)
+            crc = (crc >> 8) ^ _crc32_table[(crc ^ data[i]) & 0xFF];
+        fCRC = crc;
+        if (!fError && !fSink.write(data, len))
+            fError = true;
+        fWritten += len;
+    }
+
+    bool acquire()
+    {
+    #ifdef ESP32
+        uint8_t index;
+        if (xQueueReceive(fFree, &index, 0) != pdTRUE)
+            return false;
+        fFill = index;
+    #else
+        fFill = 0;
+    #endif
+        fFillLen = 0;
+        return true;
+    }
+
+    void submit()
+    {
+    #ifdef ESP32
+        Block block = { uint8_t(fFill), uint16_t(fFillLen) };
+        if (block.len != 0)
+            xQueueSend(fFull, &block, portMAX_DELAY);
+        else
+            xQueueSend(fFree, &block.index, 0);
+    #else
+        write(fFill, fFillLen);
+    #endif
+        fFill = -1;
+        fFillLen = 0;
+    }
+
+    void stopWriter()
+    {
+    #ifdef ESP32
+        if (fTask != nullptr)
+        {
+            Block block = { 0, 0 };
+            xQueueSend(fFull, &block, portMAX_DELAY);
+            xSemaphoreTake(fDone, portMAX_DELAY);
+            fTask = nullptr;
+        }
+        if (fFree != nullptr)
+            vQueueDelete(fFree);
+        if (fFull != nullptr)
+            vQueueDelete(fFull);
+        if (fDone != nullptr)
+            vSemaphoreDelete(fDone);
+        fFree = fFull = nullptr;
+        fDone = nullptr;
+    #endif
+    }
+
+    inline void put(uint8_t ch)
+    {
+        fBuffer[fFill][fFillLen++] = ch;
+    }
+
+    void filter(uint8_t ch)
+    {
+        switch (fPart)
+        {
+            case kPartHeaders:
+                // Skip the opening boundary and part headers up to the first blank line
+                fLast4 = (fLast4 << 8) | ch;
+                if (fLast4 == 0x0D0A0D0A)
+                    fPart = kPartData;
+                break;
+            case kPartData:
+                if (ch == uint8_t(fDelimiter[fMatch]))
+                {
+                    if (++fMatch == fDelimiterLen)
+                        fPart = kPartTrailer;
+                    break;
+                }
+                // The delimiter only contains '\r' at the start so a partial match
+                // can never overlap with a new one
+                for (size_t i = 0; i < fMatch; i++)
+                    put(fDelimiter[i]);
+                fMatch = 0;
+                if (ch == uint8_t(fDelimiter[0]))
+                    fMatch = 1;
+                else
+                    put(ch);
+                break;
+            default:
+                break;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,328 @@
+#ifndef WifiWebRequest_h
+#define WifiWebRequest_h
+
+#include "ReelTwo.h"
+
+#ifndef WIFI_WEB_REQUEST_SIZE
+#define WIFI_WEB_REQUEST_SIZE 1024
+#endif
+
+/**
+  * \ingroup wifi
+  *
+  * \class WRequest
+  *
+  * \brief Incremental HTTP/1.1 request parser with a fixed size buffer.
+  *
+  * Characters are fed one at a time using parse(). The request line and header lines
+  * are stored null terminated in an internal buffer of WIFI_WEB_REQUEST_SIZE bytes so
+  * no memory is allocated while parsing. Content-Length, Connection and the multipart
+  * boundary of Content-Type are decoded as the headers arrive. Once parse() returns
+  * kComplete the request stays valid until reset() is called, any bytes that follow
+  * (the request body or the next pipelined request) are left to the caller.
+  */
+class WRequest
+{
+public:
+    enum Method
+    {
+        kUnknown,
+        kGET,
+        kHEAD,
+        kPOST,
+        kPUT,
+        kDELETE
+    };
+
+    enum Result
+    {
+        kIncomplete,
+        kComplete,
+        kError
+    };
+
+    void reset()
+    {
+        fState = kRequestLine;
+        fLength = 0;
+        fLineStart = 0;
+        fMethod = kUnknown;
+        fPath = fQuery = fVersion = 0;
+        fHTTP11 = false;
+        fKeepAlive = false;
+        fContentLength = 0;
+        fBoundary = fBoundaryLength = 0;
+        fError = 0;
+        fBuffer[0] = '\0';
+    }
+
+    /**
+      * Feed one received character. Returns kComplete once the blank line ending the
+      * headers has been received and kError if the request is malformed or too large,
+      * in which case errorCode() is the HTTP status to reply with.
+      */
+    Result parse(char ch)
+    {
+        if (fState == kDone)
+            return kComplete;
+        if (fState == kInvalid)
+            return kError;
+        if (ch == '\r')
+            return kIncomplete;
+        if (ch == '\n')
+        {
+            if (fState == kRequestLine)
+            {
+                // Ignore blank lines before the request line
+                if (fLength == 0)
+                    return kIncomplete;
+                if (!terminateLine() || !parseRequestLine())
+                    return fail(400);
+                fState = kHeaders;
+            }
+            else if (fLength == fLineStart)
+            {
+                fState = kDone;
+                return kComplete;
+            }
+            else
+            {
+                if (!terminateLine())
+                    return fail(431);
+                parseHeaderLine(&fBuffer[fLineStart]);
+            }
+            fLineStart = fLength;
+            return kIncomplete;
+        }
+        if (fLength >= sizeof(fBuffer) - 1)
+            return fail((fState == kRequestLine) ? 414 : 431);
+        fBuffer[fLength++] = ch;
+        return kIncomplete;
+    }
+
+    /** True if no part of a request has been received since reset() */
+    inline bool isIdle() const
+    {
+        return fState == kRequestLine && fLength == 0;
+    }
+
+    inline bool isComplete() const
+    {
+        return fState == kDone;
+    }
+
+    inline int errorCode() const
+    {
+        return fError;
+    }
+
+    inline Method method() const
+    {
+        return Method(fMethod);
+    }
+
+    /** Request path without the query string */
+    inline const char* path() const
+    {
+        return &fBuffer[fPath];
+    }
+
+    /** Query string following '?' or an empty string */
+    inline const char* query() const
+    {
+        return (fQuery != 0) ? &fBuffer[fQuery] : "";
+    }
+
+    inline bool hasQuery() const
+    {
+        return fQuery != 0;
+    }
+
+    inline bool isHTTP11() const
+    {
+        return fHTTP11;
+    }
+
+    /** True if the client asked for (or defaulted to) a persistent connection */
+    inline bool keepAlive() const
+    {
+        return fKeepAlive;
+    }
+
+    inline uint32_t contentLength() const
+    {
+        return fContentLength;
+    }
+
+    /** Multipart boundary from the Content-Type header or nullptr */
+    inline const char* boundary(size_t &len) const
+    {
+        len = fBoundaryLength;
+        return (fBoundary != 0) ? &fBuffer[fBoundary] : nullptr;
+    }
+
+    /**
+      * Returns the value of the named header (case insensitive) or nullptr if not present
+      */
+    const char* header(const char* name) const
+    {
+        size_t nameLen = strlen(name);
+        for (unsigned pos = fVersion + strlen(&fBuffer[fVersion]) + 1; pos < fLineStart;
+                pos += strlen(&fBuffer[pos]) + 1)
+        {
+            const char* line = &fBuffer[pos];
+            if (strncasecmp(line, name, nameLen) == 0 && line[nameLen] == ':')
+                return skipSpace(line + nameLen + 1);
+        }
+        return nullptr;
+    }
+
+    /** True if the named header exists and contains token (case insensitive) */
+    bool headerContains(const char* name, const char* token) const
+    {
+        const char* value = header(name);
+        return (value != nullptr && containsToken(value, token));
+    }
+
+    /** True if the named header exists and exactly matches value */
+    bool headerEquals(const char* name, const char* value) const
+    {
+        const char* hdr = header(name);
+        return (hdr != nullptr && strcmp(hdr, value) == 0);
+    }
+
+private:
+    enum State
+    {
+        kRequestLine,
+        kHeaders,
+        kDone,
+        kInvalid
+    };
+
+    uint8_t fState = kRequestLine;
+    uint8_t fMethod = kUnknown;
+    bool fHTTP11 = false;
+    bool fKeepAlive = false;
+    uint16_t fLength = 0;
+    uint16_t fLineStart = 0;
+    uint16_t fPath = 0;
+    uint16_t fQuery = 0;
+    uint16_t fVersion = 0;
+    uint16_t fBoundary = 0;
+    uint16_t fBoundaryLength = 0;
+    uint16_t fError = 0;
+    uint32_t fContentLength = 0;
+    char fBuffer[WIFI_WEB_REQUEST_SIZE];
+
+    static_assert(WIFI_WEB_REQUEST_SIZE <= 65535, "WIFI_WEB_REQUEST_SIZE must fit in 16 bits");
+
+    inline Result fail(int code)
+    {
+        fState = kInvalid;
+        fError = code;
+        return kError;
+    }
+
+    inline bool terminateLine()
+    {
+        if (fLength >= sizeof(fBuffer) - 1)
+            return false;
+        fBuffer[fLength++] = '\0';
+        return true;
+    }
+
+    static const char* skipSpace(const char* str)
+    {
+        while (*str == ' ' || *str == '\t')
+            str++;
+        return str;
+    }
+
+    static bool containsToken(const char* str, const char* token)
+    {
+        size_t len = strlen(token);
+        for (; *str != '\0'; str++)
+        {
+            if (strncasecmp(str, token, len) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    bool parseRequestLine()
+    {
+        char* method = fBuffer;
+        char* target = strchr(method, ' ');
+        if (target == nullptr)
+            return false;
+        *target++ = '\0';
+        char* version = strchr(target, ' ');
+        if (version == nullptr || *target != '/')
+            return false;
+        *version++ = '\0';
+        if (strncmp(version, "HTTP/1.", 7) != 0)
+            return false;
+
+        if (strcmp(method, "GET") == 0)
+            fMethod = kGET;
+        else if (strcmp(method, "HEAD") == 0)
+            fMethod = kHEAD;
+        else if (strcmp(method, "POST") == 0)
+            fMethod = kPOST;
+        else if (strcmp(method, "PUT") == 0)
+            fMethod = kPUT;
+        else if (strcmp(method, "DELETE") == 0)
+            fMethod = kDELETE;
+
+        char* query = strchr(target, '?');
+        if (query != nullptr)
+        {
+            *query++ = '\0';
+            fQuery = query - fBuffer;
+        }
+        fPath = target - fBuffer;
+        fVersion = version - fBuffer;
+        fHTTP11 = (version[7] != '0');
+        fKeepAlive = fHTTP11;
+        return true;
+    }
+
+    void parseHeaderLine(const char* line)
+    {
+        const char* value = strchr(line, ':');
+        if (value == nullptr)
+            return;
+        size_t nameLen = value - line;
+        value = skipSpace(value + 1);
+        if (nameLen == 14 && strncasecmp(line, "Content-Length", nameLen) == 0)
+        {
+            fContentLength = strtoul(value, nullptr, 10);
+        }
+        else if (nameLen == 10 && strncasecmp(line, "Connection", nameLen) == 0)
+        {
+            if (containsToken(value, "close"))
+                fKeepAlive = false;
+            else if (containsToken(value, "keep-alive"))
+                fKeepAlive = true;
+        }
+        else if (nameLen == 12 && strncasecmp(line, "Content-Type", nameLen) == 0)
+        {
+            const char* boundary = strstr(value, "boundary=");
+            if (boundary != nullptr)
+            {
+                boundary += 9;
+                size_t len = strcspn(boundary, "; ");
+                if (*boundary == '"')
+                {
+                    boundary++;
+                    len = strcspn(boundary, "\"");
+                }
+                fBoundary = boundary - fBuffer;
+                fBoundaryLength = len;
+            }
+        }
+    }
+};
+
+#endif
@@ -3,6 +3,9 @@
 
 #include "ReelTwo.h"
 #include "wifi/WifiAccess.h"
+#include "wifi/WifiWebRequest.h"
+#include "wifi/WifiWebSocket.h"
+#include "wifi/WifiUploadStream.h"
 #include <WiFiClient.h>
 #include <FS.h>
 
@@ -16,6 +19,26 @@ public:
     virtual bool getQuoteValue() { return false; }
     virtual String get() = 0;
     virtual void set(String val) = 0;
+
+    /**
+      * Write the value to buf truncated to size-1 characters. Returns the length.
+      */
+    virtual size_t format(char* buf, size_t size)
+    {
+        return formatString(buf, size, get().c_str());
+    }
+
+    static size_t formatString(char* buf, size_t size, const char* str)
+    {
+        int len = snprintf(buf, size, "%s", str);
+        return (len > 0) ? min(size_t(len), size - 1) : 0;
+    }
+
+    static size_t formatInt(char* buf, size_t size, int val)
+    {
+        int len = snprintf(buf, size, "%d", val);
+        return (len > 0) ? min(size_t(len), size - 1) : 0;
+    }
 };
 
 class WAction
@@ -50,9 +73,14 @@ public:
         return (fGetValue != NULL) ? (fGetValue() ? "true" : "false") : "";
     }
 
+    virtual size_t format(char* buf, size_t size) override
+    {
+        return formatString(buf, size, (fGetValue != NULL) ? (fGetValue() ? "true" : "false") : "");
+    }
+
     virtual void set(String val) override
     {
-        if (fGetValue != nullptr)
+        if (fSetValue != nullptr)
             fSetValue(val.equalsIgnoreCase("true"));
     }
 
@@ -77,6 +105,13 @@ public:
         return "";
     }
 
+    virtual size_t format(char* buf, size_t size) override
+    {
+        if (fGetValue != nullptr)
+            return formatInt(buf, size, fGetValue());
+        return formatString(buf, size, "");
+    }
+
     virtual void set(String val) override
     {
         if (fSetValue != nullptr)
@@ -136,6 +171,75 @@ public:
     virtual void emitScript(Print& out) const {}
 };
 
+#if defined(ESP32) && __has_include(<esp_memory_utils.h>)
+#include <esp_memory_utils.h>
+#define WIFI_WEB_PTR_IN_FLASH(ptr) esp_ptr_in_drom(ptr)
+#elif defined(ESP32) && __has_include(<soc/soc_memory_layout.h>)
+#include <soc/soc_memory_layout.h>
+#define WIFI_WEB_PTR_IN_FLASH(ptr) esp_ptr_in_drom(ptr)
+#else
+#define WIFI_WEB_PTR_IN_FLASH(ptr) false
+#endif
+
+/**
+  * \ingroup wifi
+  *
+  * \class WText
+  *
+  * \brief Text argument of a WElement.
+  *
+  * String literals that live in flash are referenced in place and cost no heap. Any other
+  * text (String objects, stack buffers) is copied so it is always safe to pass.
+  */
+class WText
+{
+public:
+    WText() {}
+
+    WText(const char* str)
+    {
+        if (str == nullptr || WIFI_WEB_PTR_IN_FLASH(str))
+            fPtr = str;
+        else
+            fStr = str;
+    }
+
+    WText(const String& str) :
+        fStr(str)
+    {
+    }
+
+    inline const char* c_str() const
+    {
+        return (fPtr != nullptr) ? fPtr : fStr.c_str();
+    }
+
+private:
+    const char* fPtr = nullptr;
+    String fStr;
+};
+
+// Placeholders used in WElement markup templates
+#define W_ID    "\x01"
+#define W_TITLE "\x02"
+#define W_TEXT  "\x03"
+#define W_ARG0  "\x04"
+#define W_ARG1  "\x05"
+#define W_ARG2  "\x06"
+
+/**
+  * \ingroup wifi
+  *
+  * \class WElement
+  *
+  * \brief Base class of all web page controls.
+  *
+  * The markup of the standard controls is kept as constant templates in flash. Templates
+  * contain the placeholders W_ID, W_TITLE, W_TEXT and W_ARG0-2 that are bound to the element
+  * arguments while rendering, so the literal runs are written out directly. The value
+  * getter and setter are stored inline so no WValue needs to be allocated. Markup added
+  * with appendCSS()/appendBody()/appendScript() is emitted after the templates.
+  */
 class WElement
 {
 public:
@@ -149,8 +253,44 @@ public:
     {
     }
 
+    WElement(void (*pressed)()) :
+        fValueType(kActionValue),
+        fSetter(pressed)
+    {
+    }
+
+    WElement(bool (*getValue)(), void (*setValue)(bool)) :
+        fValueType(kBooleanValue),
+        fGetter(reinterpret_cast<Proc>(getValue)),
+        fSetter(reinterpret_cast<Proc>(setValue))
+    {
+    }
+
+    WElement(int (*getValue)(), void (*setValue)(int)) :
+        fValueType(kIntegerValue),
+        fGetter(reinterpret_cast<Proc>(getValue)),
+        fSetter(reinterpret_cast<Proc>(setValue))
+    {
+    }
+
+    WElement(String (*getValue)(), void (*setValue)(String)) :
+        fValueType(kStringValue),
+        fGetter(reinterpret_cast<Proc>(getValue)),
+        fSetter(reinterpret_cast<Proc>(setValue))
+    {
+    }
+
     inline bool needsReload() const { return fReload; }
-    inline String getID() const { return fID; }
+    inline bool hasValue() const { return fValue != nullptr || fValueType >= kBooleanValue; }
+    /** True if the markup of this element never changes after construction */
+    inline bool isStatic() const { return fDynamic == nullptr && fEnabled == nullptr; }
+    inline String getID() const { return fID.c_str(); }
+    inline const char* getIDString() const { return fID.c_str(); }
+    inline bool hasID(const char* id, size_t len) const
+    {
+        const char* elementID = fID.c_str();
+        return strncmp(elementID, id, len) == 0 && elementID[len] == '\0';
+    }
     inline void appendCSS(String str)    { fCSS = fCSS + str; }
     inline void appendBody(String str)   { fBody = fBody + str; }
     inline void appendScript(String str) { fScript = fScript + str; }
@@ -199,9 +339,14 @@ public:
         if (fEnabled != nullptr && !fEnabled())
             return;
         if (fDynamic)
+        {
             fDynamic->emitCSS(out);
+        }
         else
+        {
+            emitTemplate(out, fCSSTemplate);
             out.println(fCSS);
+        }
     }
 
     inline void emitBody(Print& out) const
@@ -209,21 +354,28 @@ public:
         if (fEnabled != nullptr && !fEnabled())
             return;
         if (fDynamic)
+        {
             fDynamic->emitBody(out);
+        }
         else
+        {
+            emitTemplate(out, fBodyTemplate);
             out.println(fBody);
+        }
     }
 
     inline void emitValue(Print& out) const
     {
         if (fEnabled != nullptr && !fEnabled())
             return;
-        if (fValue != nullptr)
+        if (hasValue())
         {
-            if (fValue->getQuoteValue())
-                out.println("var "+String(fID)+"_val_ = '"+fValue->get()+"';\n");
-            else
-                out.println("var "+String(fID)+"_val_ = "+fValue->get()+";\n");
+            bool quote = (fValueType == kStringValue || (fValue != nullptr && fValue->getQuoteValue()));
+            out.print("var ");
+            out.print(fID.c_str());
+            out.print(quote ? "_val_ = '" : "_val_ = ");
+            out.print(readValue());
+            out.println(quote ? "';\n" : ";\n");
         }
     }
 
@@ -232,44 +384,192 @@ public:
         if (fEnabled != nullptr && !fEnabled())
             return;
         if (fDynamic)
+        {
             fDynamic->emitScript(out);
+        }
         else
+        {
+            emitTemplate(out, fScriptTemplate);
             out.println(fScript);
+        }
     }
 
     String getValue() const
     {
         if (fEnabled != nullptr && !fEnabled())
             return "";
-        return (fValue != nullptr) ? fValue->get() : "";
+        return readValue();
+    }
+
+    /**
+      * Write the current value to buf truncated to size-1 characters. Returns the length.
+      * Boolean and integer values are formatted without allocating.
+      */
+    size_t formatValue(char* buf, size_t size) const
+    {
+        if (fEnabled != nullptr && !fEnabled())
+            return WValue::formatString(buf, size, "");
+        switch (fValueType)
+        {
+            case kBooleanValue:
+                if (fGetter != nullptr)
+                    return WValue::formatString(buf, size, reinterpret_cast<bool (*)()>(fGetter)() ? "true" : "false");
+                return WValue::formatString(buf, size, "");
+            case kIntegerValue:
+                if (fGetter != nullptr)
+                    return WValue::formatInt(buf, size, reinterpret_cast<int (*)()>(fGetter)());
+                return WValue::formatString(buf, size, "");
+            case kStringValue:
+                return WValue::formatString(buf, size, readValue().c_str());
+        }
+        return (fValue != nullptr) ? fValue->format(buf, size) : WValue::formatString(buf, size, "");
+    }
+
+    /**
+      * Returns true and the current value in buf if the value has changed since it was
+      * last pushed to the live clients.
+      */
+    bool pollValue(char* buf, size_t size) const
+    {
+        if (!hasValue())
+            return false;
+        formatValue(buf, size);
+        uint32_t hash = 2166136261u;
+        for (const char* ch = buf; *ch != '\0'; ch++)
+            hash = (hash ^ uint8_t(*ch)) * 16777619u;
+        if (hash == fLiveHash)
+            return false;
+        fLiveHash = hash;
+        return true;
     }
 
     void setValue(String val) const
     {
         if (fEnabled != nullptr && !fEnabled())
             return;
-        if (fValue != nullptr)
+        if (fSetter != nullptr)
+        {
+            switch (fValueType)
+            {
+                case kActionValue:
+                    fSetter();
+                    break;
+                case kBooleanValue:
+                    reinterpret_cast<void (*)(bool)>(fSetter)(val.equalsIgnoreCase("true"));
+                    break;
+                case kIntegerValue:
+                    reinterpret_cast<void (*)(int)>(fSetter)(val.toInt());
+                    break;
+                case kStringValue:
+                    reinterpret_cast<void (*)(String)>(fSetter)(val);
+                    break;
+            }
+        }
+        else if (fValue != nullptr)
             fValue->set(val);
         else if (fAction != nullptr)
             fAction->perform();
     }
 
 protected:
-    String fID = "";
+    typedef void (*Proc)();
+
+    enum ValueType
+    {
+        kNoValue,
+        kActionValue,
+        kBooleanValue,
+        kIntegerValue,
+        kStringValue
+    };
+
+    WText fID;
+    WText fTitle;
+    WText fText;
+    int fArg[3] = {};
+    const char* fCSSTemplate = nullptr;
+    const char* fBodyTemplate = nullptr;
+    const char* fScriptTemplate = nullptr;
     String fCSS = "";
     String fBody = "";
     String fScript = "";
     WValue* fValue = nullptr;
     WAction* fAction = nullptr;
+    uint8_t fValueType = kNoValue;
+    Proc fGetter = nullptr;
+    Proc fSetter = nullptr;
     bool fReload = false;
     const WDynamic* fDynamic = nullptr;
     bool (*fEnabled)() = nullptr;
+    mutable uint32_t fLiveHash = 0;
 
     bool& verticalAlignment()
     {
         static bool sAlign = true;
         return sAlign;
     }
+
+    inline void useTemplates(const char* css, const char* body, const char* script = nullptr)
+    {
+        fCSSTemplate = css;
+        fBodyTemplate = body;
+        fScriptTemplate = script;
+    }
+
+private:
+    String readValue() const
+    {
+        switch (fValueType)
+        {
+            case kBooleanValue:
+                if (fGetter != nullptr)
+                    return reinterpret_cast<bool (*)()>(fGetter)() ? "true" : "false";
+                return "";
+            case kIntegerValue:
+                if (fGetter != nullptr)
+                    return String(reinterpret_cast<int (*)()>(fGetter)());
+                return "";
+            case kStringValue:
+                if (fGetter != nullptr)
+                    return reinterpret_cast<String (*)()>(fGetter)();
+                return "";
+        }
+        return (fValue != nullptr) ? fValue->get() : "";
+    }
+
+    /** Writes the literal runs of the template and the bound arguments in between */
+    void emitTemplate(Print& out, const char* tmpl) const
+    {
+        if (tmpl == nullptr)
+            return;
+        const char* run = tmpl;
+        for (const char* ch = tmpl;; ch++)
+        {
+            uint8_t code = uint8_t(*ch);
+            if (code > 6)
+                continue;
+            if (ch != run)
+                out.write((const uint8_t*)run, ch - run);
+            switch (code)
+            {
+                case 0:
+                    return;
+                case 1:
+                    out.print(fID.c_str());
+                    break;
+                case 2:
+                    out.print(fTitle.c_str());
+                    break;
+                case 3:
+                    out.print(fText.c_str());
+                    break;
+                default:
+                    out.print(fArg[code - 4]);
+                    break;
+            }
+            run = ch + 1;
+        }
+    }
 };
 
 class WDynamicElement : public WElement
@@ -281,7 +581,7 @@ public:
         fDynamic = &dynamicRef;
     }
 
-    WDynamicElement(String id, const WDynamic& dynamicRef, WValue* value = nullptr) :
+    WDynamicElement(const WText& id, const WDynamic& dynamicRef, WValue* value = nullptr) :
         WElement(value)
     {
         fID = id;
@@ -292,8 +592,8 @@ public:
 class WDynamicElementInt : public WElement
 {
 public:
-    WDynamicElementInt(String id, const WDynamic& dynamicRef, int (*getValue)(), void (*setValue)(int)) :
-        WElement(new WInteger(getValue, setValue))
+    WDynamicElementInt(const WText& id, const WDynamic& dynamicRef, int (*getValue)(), void (*setValue)(int)) :
+        WElement(getValue, setValue)
     {
         fID = id;
         fDynamic = &dynamicRef;
@@ -322,129 +622,153 @@ public:
 class WStyle : public WElement
 {
 public:
-    WStyle(String style)
+    WStyle(const WText& style)
     {
-        appendCSS(style);
+        fText = style;
+        useTemplates(W_TEXT, nullptr);
     }
 };
 
 class WSlider : public WElement
 {
 public:
-    WSlider(String title, String id, int min, int max, int (*getValue)(), void (*setValue)(int)) :
-        WElement(new WInteger(getValue, setValue))
+    WSlider(const WText& title, const WText& id, int min, int max, int (*getValue)(), void (*setValue)(int)) :
+        WElement(getValue, setValue)
     {
         fID = id;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        if (verticalAlignment())
-            appendBodyf("<p>%s: <span id='%s_val'></span></p>\n", title.c_str(), id.c_str());
-        else
-            appendBodyf("<span id='%s_val'></span>\n", id.c_str());
-        appendBodyf("<input type='range' min='%d' max='%d' class='%s_css' id='%s_slider' onchange='updateValue_%s(this.value)'/>\n", min, max, id.c_str(), id.c_str(), id.c_str());
-
-        appendScriptf("var %s = document.getElementById('%s_slider');\n", id.c_str(), id.c_str());
-        appendScriptf("%s.value = %s_val_;\n", id.c_str(), id.c_str());
-        appendScriptf("var %s_priv = document.getElementById('%s_val'); %s_priv.innerHTML = %s.value;\n", id.c_str(), id.c_str(), id.c_str(), id.c_str());
-        appendScriptf("%s.oninput = function() { %s.value = this.value; %s_priv.innerHTML = this.value; }\n", id.c_str(), id.c_str(), id.c_str());
-        appendScriptf("function updateValue_%s(pos) {fetchNoload('%s', pos); {Connection: close};}\n", id.c_str(), id.c_str());
+        fTitle = title;
+        fArg[0] = min;
+        fArg[1] = max;
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            (verticalAlignment()) ?
+                "<p>" W_TITLE ": <span id='" W_ID "_val'></span></p>\n"
+                "<input type='range' min='" W_ARG0 "' max='" W_ARG1 "' class='" W_ID "_css' id='" W_ID "_slider' onchange='updateValue_" W_ID "(this.value)'/>\n" :
+                "<span id='" W_ID "_val'></span>\n"
+                "<input type='range' min='" W_ARG0 "' max='" W_ARG1 "' class='" W_ID "_css' id='" W_ID "_slider' onchange='updateValue_" W_ID "(this.value)'/>\n",
+            "var " W_ID " = document.getElementById('" W_ID "_slider');\n"
+            W_ID ".value = " W_ID "_val_;\n"
+            "var " W_ID "_priv = document.getElementById('" W_ID "_val'); " W_ID "_priv.innerHTML = " W_ID ".value;\n"
+            W_ID ".oninput = function() { " W_ID ".value = this.value; " W_ID "_priv.innerHTML = this.value; }\n"
+            "function updateValue_" W_ID "(pos) {fetchNoload('" W_ID "', pos); {Connection: close};}\n");
     }
 };
 
 class WCheckbox : public WElement
 {
 public:
-    WCheckbox(String title, String id, bool (*getValue)(), void (*setValue)(bool), bool (*enabled)() = nullptr) :
-        WElement(new WBoolean(getValue, setValue))
+    WCheckbox(const WText& title, const WText& id, bool (*getValue)(), void (*setValue)(bool), bool (*enabled)() = nullptr) :
+        WElement(getValue, setValue)
     {
         fID = id;
+        fTitle = title;
         fEnabled = enabled;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        if (verticalAlignment())
-            appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        else
-            appendBodyf("<span id='%s_val'></span>\n", id.c_str());
-        appendBodyf("<input type='checkbox' id='%s_cbox' onchange='updateValue_%s(this.checked)'/>\n", id.c_str(), id.c_str());
-        appendBodyf("<label class='%s_css' for='%s_cbox'>%s</label>\n", id.c_str(), id.c_str(), title.c_str());
-        appendScriptf("var %s = document.getElementById('%s_cbox');\n", id.c_str(), id.c_str());
-        appendScriptf("%s.checked = %s_val_;\n", id.c_str(), id.c_str());
-        appendScriptf("function updateValue_%s(pos) {fetchNoload('%s', pos); {Connection: close};}\n", id.c_str(), id.c_str());
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            (verticalAlignment()) ?
+                "<p><span id='" W_ID "_val'></span></p>\n"
+                "<input type='checkbox' id='" W_ID "_cbox' onchange='updateValue_" W_ID "(this.checked)'/>\n"
+                "<label class='" W_ID "_css' for='" W_ID "_cbox'>" W_TITLE "</label>\n" :
+                "<span id='" W_ID "_val'></span>\n"
+                "<input type='checkbox' id='" W_ID "_cbox' onchange='updateValue_" W_ID "(this.checked)'/>\n"
+                "<label class='" W_ID "_css' for='" W_ID "_cbox'>" W_TITLE "</label>\n",
+            "var " W_ID " = document.getElementById('" W_ID "_cbox');\n"
+            W_ID ".checked = " W_ID "_val_;\n"
+            "function updateValue_" W_ID "(pos) {fetchNoload('" W_ID "', pos); {Connection: close};}\n");
     }
 };
 
 class WCheckboxReload : public WElement
 {
 public:
-    WCheckboxReload(String title, String id, bool (*getValue)(), void (*setValue)(bool), bool (*enabled)() = nullptr) :
-        WElement(new WBoolean(getValue, setValue))
+    WCheckboxReload(const WText& title, const WText& id, bool (*getValue)(), void (*setValue)(bool), bool (*enabled)() = nullptr) :
+        WElement(getValue, setValue)
     {
         fID = id;
+        fTitle = title;
         fEnabled = enabled;
         fReload = true;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        if (verticalAlignment())
-            appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        else
-            appendBodyf("<span id='%s_val'></span>\n", id.c_str());
-        appendBodyf("<input type='checkbox' id='%s_cbox' onchange='updateValue_%s(this.checked)'/>\n", id.c_str(), id.c_str());
-        appendBodyf("<label class='%s_css' for='%s_cbox'>%s</label>\n", id.c_str(), id.c_str(), title.c_str());
-        appendScriptf("var %s = document.getElementById('%s_cbox');\n", id.c_str(), id.c_str());
-        appendScriptf("%s.checked = %s_val_;\n", id.c_str(), id.c_str());
-        appendScriptf("function updateValue_%s(pos) {fetchLoad('%s', pos); {Connection: close};}\n", id.c_str(), id.c_str());
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            (verticalAlignment()) ?
+                "<p><span id='" W_ID "_val'></span></p>\n"
+                "<input type='checkbox' id='" W_ID "_cbox' onchange='updateValue_" W_ID "(this.checked)'/>\n"
+                "<label class='" W_ID "_css' for='" W_ID "_cbox'>" W_TITLE "</label>\n" :
+                "<span id='" W_ID "_val'></span>\n"
+                "<input type='checkbox' id='" W_ID "_cbox' onchange='updateValue_" W_ID "(this.checked)'/>\n"
+                "<label class='" W_ID "_css' for='" W_ID "_cbox'>" W_TITLE "</label>\n",
+            "var " W_ID " = document.getElementById('" W_ID "_cbox');\n"
+            W_ID ".checked = " W_ID "_val_;\n"
+            "function updateValue_" W_ID "(pos) {fetchLoad('" W_ID "', pos); {Connection: close};}\n");
     }
 };
 
 class WButton : public WElement
 {
 public:
-    WButton(String title, String id, void (*pressed)()) :
-        WElement(new WAction(pressed))
+    WButton(const WText& title, const WText& id, void (*pressed)()) :
+        WElement(pressed)
     {
         fID = id;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        if (verticalAlignment())
-            appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<input type='button' id='%s_btn' value='%s' onclick='pressed_%s()'/>\n", id.c_str(), title.c_str(), id.c_str());
-        appendScriptf("function pressed_%s() {fetchNoload('%s', true); {Connection: close};}\n", id.c_str(), id.c_str());
+        fTitle = title;
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            (verticalAlignment()) ?
+                "<p><span id='" W_ID "_val'></span></p>\n"
+                "<input type='button' id='" W_ID "_btn' value='" W_TITLE "' onclick='pressed_" W_ID "()'/>\n" :
+                "<input type='button' id='" W_ID "_btn' value='" W_TITLE "' onclick='pressed_" W_ID "()'/>\n",
+            "function pressed_" W_ID "() {fetchNoload('" W_ID "', true); {Connection: close};}\n");
     }
 
-    WButton(String title, String id, String href)
+    WButton(const WText& title, const WText& id, const WText& href)
     {
         fID = id;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        if (verticalAlignment())
-            appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<input type='button' id='%s_btn' value='%s' onclick='window.location.href=\"%s\"'/>\n", id.c_str(), title.c_str(), href.c_str());
+        fTitle = title;
+        fText = href;
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            (verticalAlignment()) ?
+                "<p><span id='" W_ID "_val'></span></p>\n"
+                "<input type='button' id='" W_ID "_btn' value='" W_TITLE "' onclick='window.location.href=\"" W_TEXT "\"'/>\n" :
+                "<input type='button' id='" W_ID "_btn' value='" W_TITLE "' onclick='window.location.href=\"" W_TEXT "\"'/>\n");
     }
 
-    WButton(String title, String id, String href, void (*pressed)()) :
-        WElement(new WAction(pressed))
+    WButton(const WText& title, const WText& id, const WText& href, void (*pressed)()) :
+        WElement(pressed)
     {
         fID = id;
+        fTitle = title;
+        fText = href;
         fReload = true;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        if (verticalAlignment())
-            appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<input type='button' id='%s_btn' value='%s' onclick='pressed_%s()'/>\n", id.c_str(), title.c_str(), id.c_str());
-        appendScriptf("function pressed_%s() {window.location.href='\"%s?%s=true&\"'; {Connection: close};}\n", id.c_str(), href.c_str(), id.c_str());
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            (verticalAlignment()) ?
+                "<p><span id='" W_ID "_val'></span></p>\n"
+                "<input type='button' id='" W_ID "_btn' value='" W_TITLE "' onclick='pressed_" W_ID "()'/>\n" :
+                "<input type='button' id='" W_ID "_btn' value='" W_TITLE "' onclick='pressed_" W_ID "()'/>\n",
+            "function pressed_" W_ID "() {window.location.href='\"" W_TEXT "?" W_ID "=true&\"'; {Connection: close};}\n");
     }
 
-    WButton(String title, String id, bool reload, void (*pressed)()) :
-        WElement(new WAction(pressed))
+    WButton(const WText& title, const WText& id, bool reload, void (*pressed)()) :
+        WElement(pressed)
     {
         fID = id;
+        fTitle = title;
         fReload = true;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        if (verticalAlignment())
-            appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<input type='button' id='%s_btn' value='%s' onclick='pressed_%s()'/>\n", id.c_str(), title.c_str(), id.c_str());
-        appendScriptf("function pressed_%s() {fetchLoad('%s', true);  {Connection: close};}\n", id.c_str(), id.c_str());
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            (verticalAlignment()) ?
+                "<p><span id='" W_ID "_val'></span></p>\n"
+                "<input type='button' id='" W_ID "_btn' value='" W_TITLE "' onclick='pressed_" W_ID "()'/>\n" :
+                "<input type='button' id='" W_ID "_btn' value='" W_TITLE "' onclick='pressed_" W_ID "()'/>\n",
+            "function pressed_" W_ID "() {fetchLoad('" W_ID "', true);  {Connection: close};}\n");
     }
 };
 
 class WButtonReload : public WButton
 {
 public:
-    WButtonReload(String title, String id, void (*pressed)()) :
+    WButtonReload(const WText& title, const WText& id, void (*pressed)()) :
         WButton(title, id, true, pressed)
     {
     }
@@ -453,100 +777,112 @@ public:
 class WLabel : public WElement
 {
 public:
-    WLabel(String text, String id, bool (*enabled)() = nullptr)
+    WLabel(const WText& text, const WText& id, bool (*enabled)() = nullptr)
     {
         fID = id;
+        fTitle = text;
         fEnabled = enabled;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<label class='%s_css'>%s</label>\n", id.c_str(), text.c_str());
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            "<p><span id='" W_ID "_val'></span></p>\n"
+            "<label class='" W_ID "_css'>" W_TITLE "</label>\n");
     }
 };
 
 class WTextField : public WElement
 {
 public:
-    WTextField(String title, String id, String (*getValue)(), void (*setValue)(String), bool (*enabled)() = nullptr) :
-        WElement(new WString(getValue, setValue))
+    WTextField(const WText& title, const WText& id, String (*getValue)(), void (*setValue)(String), bool (*enabled)() = nullptr) :
+        WElement(getValue, setValue)
     {
         fID = id;
+        fTitle = title;
         fEnabled = enabled;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<label class='%s_css' for='%s_fld'>%s</label>\n", id.c_str(), id.c_str(), title.c_str());
-        appendBodyf("<input type='text' id='%s_fld' onchange='updateValue_%s(this.value)'/>\n", id.c_str(), id.c_str());
-        appendScriptf("var %s = document.getElementById('%s_fld');\n", id.c_str(), id.c_str());
-        appendScriptf("%s.value = %s_val_;\n", id.c_str(), id.c_str());
-        appendScriptf("function updateValue_%s(pos) {fetchNoload('%s', pos); {Connection: close};}\n", id.c_str(), id.c_str());
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            "<p><span id='" W_ID "_val'></span></p>\n"
+            "<label class='" W_ID "_css' for='" W_ID "_fld'>" W_TITLE "</label>\n"
+            "<input type='text' id='" W_ID "_fld' onchange='updateValue_" W_ID "(this.value)'/>\n",
+            "var " W_ID " = document.getElementById('" W_ID "_fld');\n"
+            W_ID ".value = " W_ID "_val_;\n"
+            "function updateValue_" W_ID "(pos) {fetchNoload('" W_ID "', pos); {Connection: close};}\n");
     }
 };
 
 class WTextFieldReadonly : public WElement
 {
 public:
-    WTextFieldReadonly(String title, String id, String (*getValue)(), bool (*enabled)() = nullptr) :
-        WElement(new WString(getValue))
+    WTextFieldReadonly(const WText& title, const WText& id, String (*getValue)(), bool (*enabled)() = nullptr) :
+        WElement(getValue, nullptr)
     {
         fID = id;
+        fTitle = title;
         fEnabled = enabled;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<label class='%s_css' for='%s_fld'>%s</label>\n", id.c_str(), id.c_str(), title.c_str());
-        appendBodyf("<input type='text' id='%s_fld' readonly='readonly'/>\n", id.c_str(), id.c_str());
-        appendScriptf("var %s = document.getElementById('%s_fld');\n", id.c_str(), id.c_str());
-        appendScriptf("%s.value = %s_val_;\n", id.c_str(), id.c_str());
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            "<p><span id='" W_ID "_val'></span></p>\n"
+            "<label class='" W_ID "_css' for='" W_ID "_fld'>" W_TITLE "</label>\n"
+            "<input type='text' id='" W_ID "_fld' readonly='readonly'/>\n",
+            "var " W_ID " = document.getElementById('" W_ID "_fld');\n"
+            W_ID ".value = " W_ID "_val_;\n");
     }
 };
 
 class WTextFieldInteger : public WElement
 {
 public:
-    WTextFieldInteger(String title, String id, String (*getValue)(), void (*setValue)(String), bool (*enabled)() = nullptr) :
-        WElement(new WString(getValue, setValue))
+    WTextFieldInteger(const WText& title, const WText& id, String (*getValue)(), void (*setValue)(String), bool (*enabled)() = nullptr) :
+        WElement(getValue, setValue)
     {
         fID = id;
+        fTitle = title;
         fEnabled = enabled;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<label class='%s_css' for='%s_fld'>%s</label>\n", id.c_str(), id.c_str(), title.c_str());
-        appendBodyf("<input type='text' id='%s_fld' onchange='updateValue_%s(this.value)'/>\n", id.c_str(), id.c_str());
-        appendScriptf("var %s = document.getElementById('%s_fld');\n", id.c_str(), id.c_str());
-        appendScriptf("setInputFilter(%s, function(value) {", id.c_str());
-        appendScriptf("  return /^[0-9]*$/.test(value);");
-        appendScriptf("});");
-        appendScriptf("%s.value = %s_val_;\n", id.c_str(), id.c_str());
-        appendScriptf("function updateValue_%s(pos) {fetchNoload('%s', pos); {Connection: close};}\n", id.c_str(), id.c_str());
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            "<p><span id='" W_ID "_val'></span></p>\n"
+            "<label class='" W_ID "_css' for='" W_ID "_fld'>" W_TITLE "</label>\n"
+            "<input type='text' id='" W_ID "_fld' onchange='updateValue_" W_ID "(this.value)'/>\n",
+            "var " W_ID " = document.getElementById('" W_ID "_fld');\n"
+            "setInputFilter(" W_ID ", function(value) {"
+            "  return /^[0-9]*$/.test(value);"
+            "});"
+            W_ID ".value = " W_ID "_val_;\n"
+            "function updateValue_" W_ID "(pos) {fetchNoload('" W_ID "', pos); {Connection: close};}\n");
     }
 };
 
 class WTextFieldIntegerRange : public WElement
 {
 public:
-    WTextFieldIntegerRange(String title, String id, int minValue, int maxValue, String (*getValue)(), void (*setValue)(String), bool (*enabled)() = nullptr) :
-        WElement(new WString(getValue, setValue))
+    WTextFieldIntegerRange(const WText& title, const WText& id, int minValue, int maxValue, String (*getValue)(), void (*setValue)(String), bool (*enabled)() = nullptr) :
+        WElement(getValue, setValue)
     {
         fID = id;
+        fTitle = title;
         fEnabled = enabled;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<label class='%s_css' for='%s_fld'>%s</label>\n", id.c_str(), id.c_str(), title.c_str());
-        appendBodyf("<input type='text' id='%s_fld' onkeypress='limitKeypress(event,this.value,%d)' onchange='updateValue_%s(this.value)'/>\n",
-            id.c_str(), int(log(maxValue) * M_LOG10E + 1), id.c_str());
-        appendScriptf("var %s = document.getElementById('%s_fld');\n", id.c_str(), id.c_str());
-        appendScriptf("setInputFilter(%s, function(value) {", id.c_str());
-        appendScriptf("  return /^[0-9]*$/.test(value);");
-        appendScriptf("});");
-        appendScriptf("%s.value = %s_val_;\n", id.c_str(), id.c_str());
-        appendScriptf("function updateValue_%s(pos) {if(pos<%d) {", id.c_str(), minValue);
-        appendScriptf(" alert('Minimum allowed value is: '+%d);", minValue);
-        appendScriptf(" %s.value = %d", id.c_str(), minValue);
-        appendScriptf("} else if (pos > %d) {", maxValue);
-        appendScriptf(" alert('Maximum allowed value is: '+%d);", maxValue);
-        appendScriptf(" %s.value = %d", id.c_str(), maxValue);
-        appendScriptf("} else {");
-        appendScriptf(" fetchNoload('%s', pos);\n", id.c_str());
-        appendScriptf("}");
-        appendScriptf("{Connection: close};}\n");
+        fArg[0] = minValue;
+        fArg[1] = maxValue;
+        fArg[2] = int(log(maxValue) * M_LOG10E + 1);
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            "<p><span id='" W_ID "_val'></span></p>\n"
+            "<label class='" W_ID "_css' for='" W_ID "_fld'>" W_TITLE "</label>\n"
+            "<input type='text' id='" W_ID "_fld' onkeypress='limitKeypress(event,this.value," W_ARG2 ")' onchange='updateValue_" W_ID "(this.value)'/>\n",
+            "var " W_ID " = document.getElementById('" W_ID "_fld');\n"
+            "setInputFilter(" W_ID ", function(value) {"
+            "  return /^[0-9]*$/.test(value);"
+            "});"
+            W_ID ".value = " W_ID "_val_;\n"
+            "function updateValue_" W_ID "(pos) {if(pos<" W_ARG0 ") {"
+            " alert('Minimum allowed value is: '+" W_ARG0 ");"
+            " " W_ID ".value = " W_ARG0
+            "} else if (pos > " W_ARG1 ") {"
+            " alert('Maximum allowed value is: '+" W_ARG1 ");"
+            " " W_ID ".value = " W_ARG1
+            "} else {"
+            " fetchNoload('" W_ID "', pos);\n"
+            "}"
+            "{Connection: close};}\n");
     }
 };
         // appendScript("  return /^\\d*\\.?\\d*$/.test(value);");
@@ -554,145 +890,180 @@ public:
 class WSelect : public WElement
 {
 public:
-    WSelect(String title, String id, String options[], unsigned numOptions, int (*getValue)(), void (*setValue)(int), bool (*enabled)() = nullptr) :
-        WElement(new WInteger(getValue, setValue))
+    WSelect(const WText& title, const WText& id, String options[], unsigned numOptions, int (*getValue)(), void (*setValue)(int), bool (*enabled)() = nullptr) :
+        WElement(getValue, setValue)
     {
         fID = id;
+        fTitle = title;
         fEnabled = enabled;
-        appendCSSf(".%s_css { width: 300px; }\n", id.c_str());
-        appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<label class='%s_css' for='%s_fld'>%s</label>\n", id.c_str(), id.c_str(), title.c_str());
-        appendBodyf("<select id='%s_fld' onchange='updateValue_%s(this.value)'>\n", id.c_str(), id.c_str());
+        useTemplates(
+            "." W_ID "_css { width: 300px; }\n",
+            "<p><span id='" W_ID "_val'></span></p>\n"
+            "<label class='" W_ID "_css' for='" W_ID "_fld'>" W_TITLE "</label>\n"
+            "<select id='" W_ID "_fld' onchange='updateValue_" W_ID "(this.value)'>\n",
+            "var " W_ID " = document.getElementById('" W_ID "_fld');\n"
+            W_ID ".value = " W_ID "_val_;\n"
+            "function updateValue_" W_ID "(pos) {fetchNoload('" W_ID "', pos); {Connection: close};}\n");
         for (unsigned i = 0; i < numOptions; i++)
         {
             appendBodyf("<option value='%d'>%s</option>\n", i, options[i].c_str());
         }
-        appendBodyf("</select>\n");
-        appendScriptf("var %s = document.getElementById('%s_fld');\n", id.c_str(), id.c_str());
-        appendScriptf("%s.value = %s_val_;\n", id.c_str(), id.c_str());
-        appendScriptf("function updateValue_%s(pos) {fetchNoload('%s', pos); {Connection: close};}\n", id.c_str(), id.c_str());
+        appendBody("</select>\n");
     }
 
-    WSelect(String title, String id, String options[], String values[], unsigned numOptions, int (*getValue)(), void (*setValue)(int), bool (*enabled)() = nullptr) :
-        WElement(new WInteger(getValue, setValue))
+    WSelect(const WText& title, const WText& id, String options[], String values[], unsigned numOptions, int (*getValue)(), void (*setValue)(int), bool (*enabled)() = nullptr) :
+        WElement(getValue, setValue)
     {
         fID = id;
+        fTitle = title;
         fEnabled = enabled;
-        appendCSSf(".%s_css { width: 300px; }\n", id.c_str());
-        appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<label class='%s_css' for='%s_fld'>%s</label>\n", id.c_str(), id.c_str(), title.c_str());
-        appendBodyf("<select id='%s_fld' onchange='updateValue_%s(this.value)'>\n", id.c_str(), id.c_str());
+        useTemplates(
+            "." W_ID "_css { width: 300px; }\n",
+            "<p><span id='" W_ID "_val'></span></p>\n"
+            "<label class='" W_ID "_css' for='" W_ID "_fld'>" W_TITLE "</label>\n"
+            "<select id='" W_ID "_fld' onchange='updateValue_" W_ID "(this.value)'>\n"
+            "</select>\n",
+            "var " W_ID " = document.getElementById('" W_ID "_fld');\n"
+            W_ID ".value = " W_ID "_val_;\n"
+            "function updateValue_" W_ID "(pos) {fetchNoload('" W_ID "', pos); {Connection: close};}\n");
         for (unsigned i = 0; i < numOptions; i++)
         {
             // appendBodyf("<option value='%s'>%s</option>\n", values[i].c_str(), options[i].c_str());
         }
-        appendBodyf("</select>\n");
-        appendScriptf("var %s = document.getElementById('%s_fld');\n", id.c_str(), id.c_str());
-        appendScriptf("%s.value = %s_val_;\n", id.c_str(), id.c_str());
-        appendScriptf("function updateValue_%s(pos) {fetchNoload('%s', pos); {Connection: close};}\n", id.c_str(), id.c_str());
     }
 };
 
 class WPassword : public WElement
 {
 public:
-    WPassword(String title, String id, String (*getValue)(), void (*setValue)(String)) :
-        WElement(new WString(getValue, setValue))
+    WPassword(const WText& title, const WText& id, String (*getValue)(), void (*setValue)(String)) :
+        WElement(getValue, setValue)
     {
         fID = id;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        if (verticalAlignment())
-            appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<label class='%s_css' for='%s_fld'>%s</label>\n", id.c_str(), id.c_str(), title.c_str());
-        appendBodyf("<input type='password' id='%s_fld' onchange='updateValue_%s(this.value)'/>\n", id.c_str(), id.c_str());
-        appendScriptf("var %s = document.getElementById('%s_fld');\n", id.c_str(), id.c_str());
-        appendScriptf("%s.value = %s_val_;\n", id.c_str(), id.c_str());
-        appendScriptf("function updateValue_%s(pos) {fetchNoload('%s', pos); {Connection: close};}\n", id.c_str(), id.c_str());
+        fTitle = title;
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            (verticalAlignment()) ?
+                "<p><span id='" W_ID "_val'></span></p>\n"
+                "<label class='" W_ID "_css' for='" W_ID "_fld'>" W_TITLE "</label>\n"
+                "<input type='password' id='" W_ID "_fld' onchange='updateValue_" W_ID "(this.value)'/>\n" :
+                "<label class='" W_ID "_css' for='" W_ID "_fld'>" W_TITLE "</label>\n"
+                "<input type='password' id='" W_ID "_fld' onchange='updateValue_" W_ID "(this.value)'/>\n",
+            "var " W_ID " = document.getElementById('" W_ID "_fld');\n"
+            W_ID ".value = " W_ID "_val_;\n"
+            "function updateValue_" W_ID "(pos) {fetchNoload('" W_ID "', pos); {Connection: close};}\n");
     }
 };
 
 class WFileInput : public WElement
 {
 public:
-    WFileInput(String title, String id, String (*getValue)(), void (*setValue)(String)) :
-        WElement(new WString(getValue, setValue))
+    WFileInput(const WText& title, const WText& id, String (*getValue)(), void (*setValue)(String)) :
+        WElement(getValue, setValue)
     {
         fID = id;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        if (verticalAlignment())
-            appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<label class='%s_css' for='%s_file'>%s</label>\n", id.c_str(), id.c_str(), title.c_str());
-        appendBodyf("<input type='file' id='%s_file' onchange='updateValue_%s(this)'/>\n", id.c_str(), id.c_str());
-        appendScriptf("var %s = document.getElementById('%s_file');\n", id.c_str(), id.c_str());
-        appendScriptf("function updateValue_%s(pos) {);}\n", id.c_str());
+        fTitle = title;
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            (verticalAlignment()) ?
+                "<p><span id='" W_ID "_val'></span></p>\n"
+                "<label class='" W_ID "_css' for='" W_ID "_file'>" W_TITLE "</label>\n"
+                "<input type='file' id='" W_ID "_file' onchange='updateValue_" W_ID "(this)'/>\n" :
+                "<label class='" W_ID "_css' for='" W_ID "_file'>" W_TITLE "</label>\n"
+                "<input type='file' id='" W_ID "_file' onchange='updateValue_" W_ID "(this)'/>\n",
+            "var " W_ID " = document.getElementById('" W_ID "_file');\n"
+            "function updateValue_" W_ID "(pos) {);}\n");
     }
 };
 
 class WFirmwareFile : public WElement
 {
 public:
-    WFirmwareFile(String title, String id)
+    WFirmwareFile(const WText& title, const WText& id)
     {
         fID = id;
-        appendCSSf(".%s_css { width: 300px; }", id.c_str());
-        if (verticalAlignment())
-            appendBodyf("<p><span id='%s_val'></span></p>\n", id.c_str());
-        appendBodyf("<label class='%s_css' for='%s_file'>%s</label>\n", id.c_str(), id.c_str(), title.c_str());
-        appendBodyf("<input type='file' id='%s_file' accept='.bin' onchange='updateValue_%s(this)'/>\n", id.c_str(), id.c_str());
-        appendScriptf("var %s = document.getElementById('%s_file');\n", id.c_str(), id.c_str());
-        appendScriptf("function updateValue_%s(pos) { document.getElementById('%s_upload').disabled = false; }\n", id.c_str(), id.c_str());
+        fTitle = title;
+        useTemplates(
+            "." W_ID "_css { width: 300px; }",
+            (verticalAlignment()) ?
+                "<p><span id='" W_ID "_val'></span></p>\n"
+                "<label class='" W_ID "_css' for='" W_ID "_file'>" W_TITLE "</label>\n"
+                "<input type='file' id='" W_ID "_file' accept='.bin' onchange='updateValue_" W_ID "(this)'/>\n" :
+                "<label class='" W_ID "_css' for='" W_ID "_file'>" W_TITLE "</label>\n"
+                "<input type='file' id='" W_ID "_file' accept='.bin' onchange='updateValue_" W_ID "(this)'/>\n",
+            "var " W_ID " = document.getElementById('" W_ID "_file');\n"
+            "function updateValue_" W_ID "(pos) { document.getElementById('" W_ID "_upload').disabled = false; }\n");
     }
 };
 
 class WFirmwareUpload : public WElement
 {
 public:
-    WFirmwareUpload(String title, String id)
+    WFirmwareUpload(const WText& title, const WText& id)
     {
         fID = id;
-        appendCSS("."+String(id)+"_css { width: 300px; }");
-        appendCSS("#"+String(id)+"_prg,#"+String(id)+"_prgbar{background-color:#f1f1f1;border-radius:10px}");
-        appendCSS("#"+String(id)+"_bar{background-color:#3498db;width:0%;height:10px}");
-        if (verticalAlignment())
-            appendBody("<p><span id='"+String(id)+"_val'></span></p>\n");
-        appendBody("<input type='button' id='"+String(id)+"_upload' value='"+title+"' onclick='upload_"+String(id)+"()'/>\n");
-        appendBody("<br><br>\n");
-        appendBody("<div id='"+String(id)+"_prg'></div>\n");
-        appendBody("<br><div id='"+String(id)+"_prgbar'><div id='"+String(id)+"_bar'></div></div><br></form>\n");
-        appendScript("var "+String(id)+"_upload = document.getElementById('"+String(id)+"_upload');\n");
-        appendScript("var "+String(id)+"_prg = document.getElementById('"+String(id)+"_prg');\n");
-        appendScript("var "+String(id)+"_prgbar = document.getElementById('"+String(id)+"_prgbar');\n");
-        appendScript("var "+String(id)+"_bar = document.getElementById('"+String(id)+"_bar');\n");
-        appendScript(String(id)+"_upload.disabled = true;\n");
-        appendScript("function upload_"+String(id)+"() {\n");
-        appendScript("const xhr = new XMLHttpRequest();\n");
-        appendScript("xhr.upload.onprogress = (evt) => {\n");
-        appendScript("    if (evt.lengthComputable) {\n");
-        appendScript("        var per = evt.loaded / evt.total;\n");
-        appendScript("        "+String(id)+"_prg.innerHTML = 'progress: ' + Math.round(per*100) + '%';\n");
-        appendScript("        "+String(id)+"_bar.style.width = Math.round(per*100) + '%';\n");
-        appendScript("    }\n");
-        appendScript("};\n");
-        appendScript("xhr.upload.onerror = () => {\n");
-        appendScript("   "+String(id)+"_prg.innerHTML = 'Upload failed!';\n");
-        appendScript("   "+String(id)+"_bar.style.width = '0%';\n");
-        appendScript("};\n");
-        appendScript("xhr.upload.abort = () => {\n");
-        appendScript("   "+String(id)+"_prg.innerHTML = 'Upload cancelled';\n");
-        appendScript("   "+String(id)+"_bar.style.width = '0%';\n");
-        appendScript("};\n");
-        appendScript("xhr.upload.onload = () => {\n");
-        appendScript("   "+String(id)+"_prg.innerHTML = 'Upload complete. Please wait .';\n");
-        appendScript("   "+String(id)+"_bar.style.width = '0%';\n");
-        appendScript("   xhr.counter = 0;\n");
-        appendScript("   setInterval(function() {\n");
-        appendScript("     if (xhr.counter++ >= 8) window.location.href='/';\n");
-        appendScript("    "+String(id)+"_prg.innerHTML = "+String(id)+"_prg.innerHTML + '.';\n");
-        appendScript("   }, 2000);\n");
-        appendScript("};\n");
-        appendScript("xhr.open('POST', 'upload/firmware', true);\n");
-        appendScript("xhr.send("+String(id)+".files[0]);\n");
-        appendScript("}\n");
+        fTitle = title;
+        useTemplates(
+            "." W_ID "_css { width: 300px; }"
+            "#" W_ID "_prg,#" W_ID "_prgbar{background-color:#f1f1f1;border-radius:10px}"
+            "#" W_ID "_bar{background-color:#3498db;width:0%;height:10px}",
+            (verticalAlignment()) ?
+                "<p><span id='" W_ID "_val'></span></p>\n"
+                "<input type='button' id='" W_ID "_upload' value='" W_TITLE "' onclick='upload_" W_ID "()'/>\n"
+                "<br><br>\n"
+                "<div id='" W_ID "_prg'></div>\n"
+                "<br><div id='" W_ID "_prgbar'><div id='" W_ID "_bar'></div></div><br></form>\n" :
+                "<input type='button' id='" W_ID "_upload' value='" W_TITLE "' onclick='upload_" W_ID "()'/>\n"
+                "<br><br>\n"
+                "<div id='" W_ID "_prg'></div>\n"
+                "<br><div id='" W_ID "_prgbar'><div id='" W_ID "_bar'></div></div><br></form>\n",
+            "var " W_ID "_upload = document.getElementById('" W_ID "_upload');\n"
+            "var " W_ID "_prg = document.getElementById('" W_ID "_prg');\n"
+            "var " W_ID "_prgbar = document.getElementById('" W_ID "_prgbar');\n"
+            "var " W_ID "_bar = document.getElementById('" W_ID "_bar');\n"
+            W_ID "_upload.disabled = true;\n"
+            "function crc32_" W_ID "(data) {\n"
+            "  var crc = -1;\n"
+            "  for (var i = 0; i < data.length; i++) {\n"
+            "    crc ^= data[i];\n"
+            "    for (var k = 0; k < 8; k++) crc = (crc >>> 1) ^ (0xEDB88320 & -(crc & 1));\n"
+            "  }\n"
+            "  return ((crc ^ -1) >>> 0).toString(16);\n"
+            "}\n"
+            "function upload_" W_ID "() {\n"
+            "const reader = new FileReader();\n"
+            "reader.onload = () => {\n"
+            "const xhr = new XMLHttpRequest();\n"
+            "xhr.upload.onprogress = (evt) => {\n"
+            "    if (evt.lengthComputable) {\n"
+            "        var per = evt.loaded / evt.total;\n"
+            "        " W_ID "_prg.innerHTML = 'progress: ' + Math.round(per*100) + '%';\n"
+            "        " W_ID "_bar.style.width = Math.round(per*100) + '%';\n"
+            "    }\n"
+            "};\n"
+            "xhr.upload.onerror = () => {\n"
+            "   " W_ID "_prg.innerHTML = 'Upload failed!';\n"
+            "   " W_ID "_bar.style.width = '0%';\n"
+            "};\n"
+            "xhr.upload.abort = () => {\n"
+            "   " W_ID "_prg.innerHTML = 'Upload cancelled';\n"
+            "   " W_ID "_bar.style.width = '0%';\n"
+            "};\n"
+            "xhr.upload.onload = () => {\n"
+            "   " W_ID "_prg.innerHTML = 'Upload complete. Please wait .';\n"
+            "   " W_ID "_bar.style.width = '0%';\n"
+            "   xhr.counter = 0;\n"
+            "   setInterval(function() {\n"
+            "     if (xhr.counter++ >= 8) window.location.href='/';\n"
+            "    " W_ID "_prg.innerHTML = " W_ID "_prg.innerHTML + '.';\n"
+            "   }, 2000);\n"
+            "};\n"
+            "xhr.open('POST', 'upload/firmware', true);\n"
+            "xhr.setRequestHeader('X-Upload-CRC32', crc32_" W_ID "(new Uint8Array(reader.result)));\n"
+            "xhr.send(" W_ID ".files[0]);\n"
+            "};\n"
+            "reader.readAsArrayBuffer(" W_ID ".files[0]);\n"
+            "}\n");
     }
 };
 
@@ -705,13 +1076,15 @@ struct WMenuData
 class WVerticalMenu : public WElement
 {
 public:
-    WVerticalMenu(String id, const WMenuData* menuData, unsigned menuCount, unsigned active = 0)
-    {
-        appendCSSf(".%s_vertical_menu { width: 300px; margin-left: auto; margin-right: auto; }\n", id.c_str());
-        appendCSSf(".%s_vertical_menu a { background-color: #eee; color: black; display: block; padding: 12px; text-decoration: none; }\n", id.c_str());
-        appendCSSf(".%s_vertical_menu a:hover { background-color: #ccc; }\n", id.c_str());
-        appendCSSf(".%s_vertical_menu a:active { background-color: #4CAF50; color: white; }\n", id.c_str());
-        appendBodyf("<div class='%s_vertical_menu'>\n", id.c_str());
+    WVerticalMenu(const WText& id, const WMenuData* menuData, unsigned menuCount, unsigned active = 0)
+    {
+        fText = id;
+        useTemplates(
+            "." W_TEXT "_vertical_menu { width: 300px; margin-left: auto; margin-right: auto; }\n"
+            "." W_TEXT "_vertical_menu a { background-color: #eee; color: black; display: block; padding: 12px; text-decoration: none; }\n"
+            "." W_TEXT "_vertical_menu a:hover { background-color: #ccc; }\n"
+            "." W_TEXT "_vertical_menu a:active { background-color: #4CAF50; color: white; }\n",
+            "<div class='" W_TEXT "_vertical_menu'>\n");
         for (unsigned i = 0; i < menuCount; i++)
         {
             if (i == active)
@@ -719,16 +1092,17 @@ public:
             else
                 appendBodyf("<a href='%s'>%s</a>\n", menuData[i].href, menuData[i].title);
         }
-        appendBodyf("</div>\n");
+        appendBody("</div>\n");
     }
 };
 
 class W1 : public WElement
 {
 public:
-    W1(String title)
+    W1(const WText& title)
     {
-        appendBody("<h1>"+String(title)+"</h1>");
+        fTitle = title;
+        useTemplates(nullptr, "<h1>" W_TITLE "</h1>");
     }
 };
 
@@ -737,56 +1111,59 @@ class WHR : public WElement
 public:
     WHR()
     {
-        appendBody("<hr>");
+        useTemplates(nullptr, "<hr>");
     }
 };
 
 class WHRef : public WElement
 {
 public:
-    WHRef(String link, String text)
+    WHRef(const WText& link, const WText& text)
     {
-        appendBodyf("<a href=\"%s\">%s</a>", link.c_str(), text.c_str());
+        fText = link;
+        fTitle = text;
+        useTemplates(nullptr, "<a href=\"" W_TEXT "\">" W_TITLE "</a>");
     }
 };
 
 class WImage : public WElement
 {
 public:
-    WImage(String alt, String data)
+    WImage(const WText& alt, const WText& data)
     {
-        appendBody("<p><img src='data:image/png;base64, ");
-        appendBody(data);
-        appendBody("' alt='"+String(alt)+"'></p>");
+        fTitle = alt;
+        fText = data;
+        useTemplates(nullptr, "<p><img src='data:image/png;base64, " W_TEXT "' alt='" W_TITLE "'></p>");
     }
 };
 
 class WSVG : public WElement
 {
 public:
-    WSVG(String data)
+    WSVG(const WText& data)
     {
-        appendBody("<p>");
-        appendBody(data);
-        appendBody("</p>");
+        fText = data;
+        useTemplates(nullptr, "<p>" W_TEXT "</p>");
     }
 };
 
 class WHTML : public WElement
 {
 public:
-    WHTML(String data)
+    WHTML(const WText& data)
     {
-        appendBody(data);
+        fText = data;
+        useTemplates(nullptr, W_TEXT);
     }
 };
 
 class WJavaScript : public WElement
 {
 public:
-    WJavaScript(String data)
+    WJavaScript(const WText& data)
     {
-        appendScript(data);
+        fText = data;
+        useTemplates(nullptr, nullptr, W_TEXT);
     }
 };
 
@@ -795,7 +1172,7 @@ class WTableRow : public WElement
 public:
     WTableRow()
     {
-        appendBody("<tr>");
+        useTemplates(nullptr, "<tr>");
     }
 };
 
@@ -804,15 +1181,14 @@ class WTableCol : public WElement
 public:
     WTableCol()
     {
-        appendBody("<td>");
+        useTemplates(nullptr, "<td>");
         verticalAlignment() = false;
     }
 
-    WTableCol(String styleClass)
+    WTableCol(const WText& styleClass)
     {
-        appendBody("<td class=\"");
-        appendBody(styleClass);
-        appendBody("\">");
+        fText = styleClass;
+        useTemplates(nullptr, "<td class=\"" W_TEXT "\">");
         verticalAlignment() = false;
     }
 };
@@ -822,7 +1198,7 @@ class WTableColEnd : public WElement
 public:
     WTableColEnd()
     {
-        appendBody("</td>");
+        useTemplates(nullptr, "</td>");
         verticalAlignment() = true;
     }
 };
@@ -832,33 +1208,178 @@ class WTableRowEnd : public WElement
 public:
     WTableRowEnd()
     {
-        appendBody("</tr>");
+        useTemplates(nullptr, "</tr>");
     }
 };
 
 class WTableLabel : public WElement
 {
 public:
-    WTableLabel(String text, String id, bool (*enabled)() = nullptr)
+    WTableLabel(const WText& text, const WText& id, bool (*enabled)() = nullptr)
     {
         fID = id;
+        fTitle = text;
         fEnabled = enabled;
-        appendBodyf("<label class='%s_css'>%s</label>\n", id.c_str(), text.c_str());
+        useTemplates(nullptr, "<label class='" W_ID "_css'>" W_TITLE "</label>\n");
     }
 };
 
 class WTableTextField : public WElement
 {
 public:
-    WTableTextField(String id, String (*getValue)(), void (*setValue)(String), bool (*enabled)() = nullptr) :
-        WElement(new WString(getValue, setValue))
+    WTableTextField(const WText& id, String (*getValue)(), void (*setValue)(String), bool (*enabled)() = nullptr) :
+        WElement(getValue, setValue)
     {
         fID = id;
         fEnabled = enabled;
-        appendBodyf("<input type='text' id='%s_fld' onchange='updateValue_%s(this.value)'/>\n", id.c_str(), id.c_str());
-        appendScriptf("var %s = document.getElementById('%s_fld');\n", id.c_str(), id.c_str());
-        appendScriptf("%s.value = %s_val_;\n", id.c_str(), id.c_str());
-        appendScriptf("function updateValue_%s(pos) {fetchNoload('%s', pos); {Connection: close};}\n", id.c_str(), id.c_str());
+        useTemplates(
+            nullptr,
+            "<input type='text' id='" W_ID "_fld' onchange='updateValue_" W_ID "(this.value)'/>\n",
+            "var " W_ID " = document.getElementById('" W_ID "_fld');\n"
+            W_ID ".value = " W_ID "_val_;\n"
+            "function updateValue_" W_ID "(pos) {fetchNoload('" W_ID "', pos); {Connection: close};}\n");
+    }
+};
+
+
+// Define USE_WIFI_WEB_GZIP to keep a gzip compressed copy of cached pages. The compressor
+// state is large so this is only practical on boards with PSRAM.
+#if defined(USE_WIFI_WEB_GZIP) && __has_include(<rom/miniz.h>)
+#include <rom/miniz.h>
+#define WIFI_WEB_HAVE_GZIP
+#endif
+
+/// \private
+class WCountingPrint : public Print
+{
+public:
+    virtual size_t write(uint8_t ch) override
+    {
+        fCount++;
+        return 1;
+    }
+
+    virtual size_t write(const uint8_t *buffer, size_t size) override
+    {
+        fCount += size;
+        return size;
+    }
+
+    inline size_t count() const
+    {
+        return fCount;
+    }
+
+private:
+    size_t fCount = 0;
+};
+
+/// \private
+class WBufferPrint : public Print
+{
+public:
+    WBufferPrint(uint8_t* buffer, size_t size) :
+        fPtr(buffer),
+        fEnd(buffer + size)
+    {
+    }
+
+    virtual size_t write(uint8_t ch) override
+    {
+        return write(&ch, 1);
+    }
+
+    virtual size_t write(const uint8_t *buffer, size_t size) override
+    {
+        size = min(size, size_t(fEnd - fPtr));
+        memcpy(fPtr, buffer, size);
+        fPtr += size;
+        return size;
+    }
+
+private:
+    uint8_t* fPtr;
+    uint8_t* fEnd;
+};
+
+/// \private
+struct WCachedBody
+{
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    uint8_t* gzip = nullptr;
+    size_t gzipSize = 0;
+    char etag[11] = {};
+
+    static uint8_t* alloc(size_t size)
+    {
+        // Prefer PSRAM if available
+        uint8_t* ptr = (uint8_t*)ps_malloc(size);
+        return (ptr != nullptr) ? ptr : (uint8_t*)malloc(size);
+    }
+
+    static uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = ~0u)
+    {
+        while (len-- > 0)
+            crc = (crc >> 8) ^ _crc32_table[(crc ^ *data++) & 0xFF];
+        return crc;
+    }
+
+#ifdef WIFI_WEB_HAVE_GZIP
+    struct GzipWriter
+    {
+        uint8_t* ptr;
+        size_t size;
+        size_t capacity;
+    };
+
+    static mz_bool gzipPut(const void* buf, int len, void* user)
+    {
+        GzipWriter* writer = (GzipWriter*)user;
+        if (writer->size + len > writer->capacity)
+            return MZ_FALSE;
+        memcpy(writer->ptr + writer->size, buf, len);
+        writer->size += len;
+        return MZ_TRUE;
+    }
+
+    void compress()
+    {
+        static const uint8_t sHeader[] = { 0x1f, 0x8b, 0x08, 0x00, 0, 0, 0, 0, 0x00, 0xff };
+        tdefl_compressor* comp = (tdefl_compressor*)alloc(sizeof(tdefl_compressor));
+        GzipWriter writer;
+        writer.capacity = size;
+        writer.ptr = (comp != nullptr) ? alloc(writer.capacity) : nullptr;
+        if (writer.ptr != nullptr)
+        {
+            memcpy(writer.ptr, sHeader, sizeof(sHeader));
+            writer.size = sizeof(sHeader);
+            tdefl_init(comp, gzipPut, &writer, TDEFL_DEFAULT_MAX_PROBES);
+            // Only keep the compressed body if it is actually smaller
+            if (tdefl_compress_buffer(comp, data, size, TDEFL_FINISH) == TDEFL_STATUS_DONE &&
+                writer.size + 8 < writer.capacity)
+            {
+                uint32_t trailer[2] = { ~crc32(data, size), uint32_t(size) };
+                memcpy(writer.ptr + writer.size, trailer, sizeof(trailer));
+                gzip = writer.ptr;
+                gzipSize = writer.size + sizeof(trailer);
+            }
+            else
+            {
+                free(writer.ptr);
+            }
+        }
+        if (comp != nullptr)
+            free(comp);
+    }
+#endif
+
+    void finish()
+    {
+        snprintf(etag, sizeof(etag), "\"%08x\"", unsigned(~crc32(data, size)));
+    #ifdef WIFI_WEB_HAVE_GZIP
+        compress();
+    #endif
     }
 };
 
@@ -927,41 +1448,65 @@ public:
 
     inline bool isGet() const
     {
-        return (fCompleteProc == nullptr && fUploaderProc == nullptr);
+        return (fCompleteProc == nullptr && fUploaderProc == nullptr && fSink == nullptr);
+    }
+
+    inline WUploadSink* getSink() const
+    {
+        return fSink;
+    }
+
+    inline unsigned getElementCount() const
+    {
+        return (fContents != nullptr) ? fNumElements : 0;
     }
 
-    void handleGetRequest(Print& out, String &header) const
+    inline const WElement& getElement(unsigned i) const
+    {
+        return fContents[i];
+    }
+
+    /**
+      * Write the response to a GET request. Returns true if the connection can be kept open
+      * for further requests.
+      */
+    bool handleGetRequest(Print& out, const WRequest& request) const
     {
         bool needsReload = true;
-        String prefix = "GET "+fURL+"?";
-        if (header.startsWith(prefix) || fAPIProc != nullptr)
+        if (request.hasQuery() || fAPIProc != nullptr)
         {
             if (!isGet())
-                return;
+                return false;
 
             if (fAPIProc)
             {
-                int end = header.indexOf(' ', prefix.length());
-                fAPIProc(out, header.substring(prefix.length(), end));
-                return;
+                fAPIProc(out, request.query());
+                return false;
             }
-            int skiplen = 2;
-            int pos1 = header.indexOf("&?");
-            if (pos1 == -1)
+            if (strcmp(request.query(), "_values_") == 0 && isCacheable())
             {
-                skiplen = 1;
-                pos1 = header.indexOf('?');
+                emitStatus(out, request, "200 OK");
+                out.println("Content-type:application/javascript");
+                out.println("Cache-Control: no-store");
+                out.println("Connection: close");
+                out.println();
+                for (unsigned i = 0; i < fNumElements; i++)
+                    fContents[i].emitValue(out);
+                emitLiveScript(out);
+                return false;
             }
-            int pos2 = header.indexOf('=',pos1);
-            int pos3 = header.indexOf('&',pos2);
-            if (pos1 != -1 && pos2 != -1 && pos3 != -1)
+            const char* query = request.query();
+            const char* var = strstr(query, "&?");
+            var = (var != nullptr) ? var + 2 : query;
+            const char* eq = strchr(var, '=');
+            const char* amp = (eq != nullptr) ? strchr(eq, '&') : nullptr;
+            if (amp != nullptr)
             {
-                String var = header.substring(pos1+skiplen, pos2);
-                String val = header.substring(pos2+1, pos3);
-                DEBUG_PRINT("SET "); DEBUG_PRINT(var); DEBUG_PRINT(" = "); DEBUG_PRINTLN(val);
+                String val = String(eq + 1).substring(0, amp - eq - 1);
+                DEBUG_PRINT("SET "); DEBUG_PRINT(String(var).substring(0, eq - var)); DEBUG_PRINT(" = "); DEBUG_PRINTLN(val);
                 for (unsigned i = 0; i < fNumElements; i++)
                 {
-                    if (var == fContents[i].getID())
+                    if (fContents[i].hasID(var, eq - var))
                     {
                         fContents[i].setValue(val);
                         needsReload = fContents[i].needsReload();
@@ -970,142 +1515,76 @@ public:
                 }
             }
         }
-        if (needsReload)
+        if (!needsReload)
+        {
+            emitStatus(out, request, "200 OK");
+            out.println("Content-type:text/html");
+            out.println("Content-Length:0");
+            bool keepAlive = emitConnection(out, request, true);
+            out.println();
+            return keepAlive;
+        }
+        if (fFS != nullptr)
         {
-            if (fFS != nullptr)
+            bool compressed = false;
+            fs::File file = openFileOrCompressed(fTitleOrPath, compressed);
+            if (!file)
             {
-                bool compressed = false;
-                fs::File file = openFileOrCompressed(fTitleOrPath, compressed);
-                if (file)
+                DEBUG_PRINTLN("FILE NOT FOUND: "+String(fTitleOrPath));
+                emitStatus(out, request, "404 Not Found");
+                out.println("Content-type:text/html");
+                out.println("Connection: close");
+                out.println();
+                return false;
+            }
+            ::printf("FILE: %s (compressed=%d)\n", fTitleOrPath.c_str(), compressed);
+            if (compressed && !request.headerContains("Accept-Encoding", "gzip"))
+            {
+                ::printf("Client needs to support compression\n");
+                if (fLanguageOrMimeType == "text/html")
                 {
-                    ::printf("FILE: %s (compressed=%d)\n", fTitleOrPath.c_str(), compressed);
-                    if (compressed && header.indexOf("Accept-Encoding: gzip") == -1)
-                    {
-                        ::printf("Client needs to support compression\n");
-                        if (fLanguageOrMimeType == "text/html")
-                        {
-                            out.println("HTTP/1.0 200 OK");
-                            out.print("Content-type:"); out.println(fLanguageOrMimeType);
-                            out.println("Connection: close");
-                            out.println();
-                            out.println("Compression required");
-                        }
-                        else
-                        {
-                            out.println("HTTP/1.0 404 Not Found");
-                            out.print("Content-type:"); out.println(fLanguageOrMimeType);
-                            out.println("Content-type:text/html");
-                            out.println("Connection: close");
-                            out.println();
-                        }
-                    }
-                    else
-                    {
-                        size_t fileSize = file.size();
-                        out.println("HTTP/1.0 200 OK");
-                        out.print("Content-type:"); out.println(fLanguageOrMimeType);
-                        out.print("Content-Length:"); out.println(fileSize);
-                        out.println("Cache-Control: private, max-age=2592000");
-                        if (compressed)
-                            out.println("Content-Encoding: gzip");
-                        out.println("Connection: close");
-                        out.println();
-                        char* buffer = (char*)malloc(1024);
-                        while (file.available())
-                        {
-                            size_t bytesRead = file.readBytes(buffer, 1024);
-                            out.write(buffer, bytesRead);
-                        }
-                        free(buffer);
-                    }
+                    emitStatus(out, request, "200 OK");
+                    out.print("Content-type:"); out.println(fLanguageOrMimeType);
+                    out.println("Connection: close");
+                    out.println();
+                    out.println("Compression required");
                 }
                 else
                 {
-                    DEBUG_PRINTLN("FILE NOT FOUND: "+String(fTitleOrPath));
-                    out.println("HTTP/1.0 404 Not Found");
-                    out.print("Content-type:"); out.println(fLanguageOrMimeType);
+                    emitStatus(out, request, "404 Not Found");
                     out.println("Content-type:text/html");
                     out.println("Connection: close");
                     out.println();
                 }
+                return false;
             }
-            else
+            size_t fileSize = file.size();
+            emitStatus(out, request, "200 OK");
+            out.print("Content-type:"); out.println(fLanguageOrMimeType);
+            out.print("Content-Length:"); out.println(fileSize);
+            out.println("Cache-Control: private, max-age=2592000");
+            if (compressed)
+                out.println("Content-Encoding: gzip");
+            bool keepAlive = emitConnection(out, request, true);
+            out.println();
+            char* buffer = (char*)malloc(1024);
+            while (file.available())
             {
-                out.println("HTTP/1.0 200 OK");
-                out.println("Content-type:text/html");
-                out.println("Connection: close");
-                out.println();
-                out.print(R"RAW(<!DOCTYPE html><html lang=")RAW");
-                out.print(fLanguageOrMimeType);
-                out.print(
-                    R"RAW("><head><meta charset="UTF-8"><meta name="viewport", content="width=device-width, initial-scale=1">
-                        <link rel="icon" href="data:,"><title>)RAW");
-                out.print(fTitleOrPath);
-                out.print(
-                    R"RAW(</title>
-                        <style>body { text-align: center; font-family: "Trebuchet MS", Arial; margin-left:auto; margin-right:auto;}
-                    )RAW");
-                for (unsigned i = 0; i < fNumElements; i++)
-                    fContents[i].emitCSS(out);
-                out.print(
-                    R"RAW(
-                        </style>
-                        </head><body>
-                    )RAW");
-                for (unsigned i = 0; i < fNumElements; i++)
-                    fContents[i].emitBody(out);
-                out.print(
-                    R"RAW(
-                        <script>
-                        function fetchNoload(key,val) {
-                            var baseurl = window.location.protocol+'//'+window.location.host+location.pathname;
-                            fetch(baseurl+'?'+key+'='+val+'&');
-                        }
-                        function fetchLoad(key,val) {
-                            var baseurl = window.location.protocol+'//'+window.location.host+location.pathname;
-                            window.location.href=baseurl+'?'+key+'='+val+'&';
-                        }
-                        function limitKeypress(event, value, maxLength) {
-                          if (value != undefined && value.toString().length >= maxLength) {
-                            event.preventDefault();
-                          }
-                        }
-                        function setInputFilter(textbox, inputFilter) {
-                          ["input", "keydown", "keyup", "mousedown", "mouseup", "select", "contextmenu", "drop"].forEach(function(event) {
-                            textbox.addEventListener(event, function() {
-                              if (inputFilter(this.value)) {
-                                this.oldValue = this.value;
-                                this.oldSelectionStart = this.selectionStart;
-                                this.oldSelectionEnd = this.selectionEnd;
-                              } else if (this.hasOwnProperty("oldValue")) {
-                                this.value = this.oldValue;
-                                this.setSelectionRange(this.oldSelectionStart, this.oldSelectionEnd);
-                              } else {
-                                this.value = "";
-                              }
-                            });
-                          });
-                        }
-                    )RAW");
-                for (unsigned i = 0; i < fNumElements; i++)
-                    fContents[i].emitValue(out);
-                for (unsigned i = 0; i < fNumElements; i++)
-                    fContents[i].emitScript(out);
-                out.print(
-                    R"RAW(
-                        {Connection: close};
-                        </script>
-                        </body></html>
-                    )RAW");
+                size_t bytesRead = file.readBytes(buffer, 1024);
+                out.write(buffer, bytesRead);
             }
+            free(buffer);
+            return keepAlive;
         }
-        else
-        {
-            out.println("HTTP/1.0 200 OK");
-            out.println("Content-type:text/html");
-            out.println("Connection: close");
-            out.println();
-        }
+        if (isCacheable())
+            return handleCachedRequest(out, request);
+
+        emitStatus(out, request, "200 OK");
+        out.println("Content-type:text/html");
+        out.println("Connection: close");
+        out.println();
+        emitPage(out, true);
+        return false;
     }
 
     inline void callComplete(Client& client) const
@@ -1120,7 +1599,246 @@ public:
             fUploaderProc(uploader);
     }
 
+    void callStreamComplete(Client& client, const WUploadStream& upload) const
+    {
+        if (fStreamCompleteProc != nullptr)
+        {
+            fStreamCompleteProc(client, upload);
+            return;
+        }
+        client.println(upload.succeeded() ? "HTTP/1.0 200 OK" : "HTTP/1.0 422 Unprocessable Entity");
+        client.println("Content-type:text/plain");
+        client.println("Connection: close");
+        client.println();
+        client.println(upload.succeeded() ? "OK" : (upload.crcMismatch() ? "CRC mismatch" : "Upload failed"));
+    }
+
+    inline void callStreamProgress(const WUploadStream& upload) const
+    {
+        if (fStreamProgressProc != nullptr)
+            fStreamProgressProc(upload);
+    }
+
+    /**
+      * Set by WifiWebServer::setLiveValues(). Pages only open a WebSocket to the server
+      * while live values are enabled.
+      */
+    static bool& liveValues()
+    {
+        static bool sLiveValues;
+        return sLiveValues;
+    }
+
+    /**
+      * Returns true if the page markup never changes. The markup of such pages is rendered
+      * once and served with an ETag while the element values are served live.
+      */
+    bool isCacheable() const
+    {
+        if (fFS != nullptr || fAPIProc != nullptr || !isGet() || fContents == nullptr)
+            return false;
+        for (unsigned i = 0; i < fNumElements; i++)
+        {
+            if (!fContents[i].isStatic())
+                return false;
+        }
+        return true;
+    }
+
+    /**
+      * Render and cache the static page body. Called automatically on the first request,
+      * call from setup() to avoid the delay on first page load.
+      */
+    bool prerender() const
+    {
+        if (fCache.data != nullptr)
+            return true;
+        if (!isCacheable())
+            return false;
+        WCountingPrint counter;
+        emitPage(counter, false);
+        uint8_t* data = WCachedBody::alloc(counter.count());
+        if (data == nullptr)
+            return false;
+        WBufferPrint buffer(data, counter.count());
+        emitPage(buffer, false);
+        fCache.data = data;
+        fCache.size = counter.count();
+        fCache.finish();
+        return true;
+    }
+
 protected:
+    void emitPage(Print& out, bool inlineValues) const
+    {
+        out.print(R"RAW(<!DOCTYPE html><html lang=")RAW");
+        out.print(fLanguageOrMimeType);
+        out.print(
+            R"RAW("><head><meta charset="UTF-8"><meta name="viewport", content="width=device-width, initial-scale=1">
+                <link rel="icon" href="data:,"><title>)RAW");
+        out.print(fTitleOrPath);
+        out.print(
+            R"RAW(</title>
+                <style>body { text-align: center; font-family: "Trebuchet MS", Arial; margin-left:auto; margin-right:auto;}
+            )RAW");
+        for (unsigned i = 0; i < fNumElements; i++)
+            fContents[i].emitCSS(out);
+        out.print(
+            R"RAW(
+                </style>
+                </head><body>
+            )RAW");
+        for (unsigned i = 0; i < fNumElements; i++)
+            fContents[i].emitBody(out);
+        out.print(
+            R"RAW(
+                <script>
+                var liveSocket = null;
+                function fetchNoload(key,val) {
+                    if (liveSocket != null && liveSocket.readyState == 1) {
+                        liveSocket.send(key+'='+val);
+                        return;
+                    }
+                    var baseurl = window.location.protocol+'//'+window.location.host+location.pathname;
+                    fetch(baseurl+'?'+key+'='+val+'&');
+                }
+                function fetchLoad(key,val) {
+                    var baseurl = window.location.protocol+'//'+window.location.host+location.pathname;
+                    window.location.href=baseurl+'?'+key+'='+val+'&';
+                }
+                function limitKeypress(event, value, maxLength) {
+                  if (value != undefined && value.toString().length >= maxLength) {
+                    event.preventDefault();
+                  }
+                }
+                function setInputFilter(textbox, inputFilter) {
+                  ["input", "keydown", "keyup", "mousedown", "mouseup", "select", "contextmenu", "drop"].forEach(function(event) {
+                    textbox.addEventListener(event, function() {
+                      if (inputFilter(this.value)) {
+                        this.oldValue = this.value;
+                        this.oldSelectionStart = this.selectionStart;
+                        this.oldSelectionEnd = this.selectionEnd;
+                      } else if (this.hasOwnProperty("oldValue")) {
+                        this.value = this.oldValue;
+                        this.setSelectionRange(this.oldSelectionStart, this.oldSelectionEnd);
+                      } else {
+                        this.value = "";
+                      }
+                    });
+                  });
+                }
+            )RAW");
+        if (inlineValues)
+        {
+            for (unsigned i = 0; i < fNumElements; i++)
+                fContents[i].emitValue(out);
+            emitLiveScript(out);
+        }
+        else
+        {
+            // Values are served live by a separate script so the rest of the page can be cached
+            out.print("</script><script src='");
+            out.print(fURL);
+            out.print("?_values_'></script><script>");
+        }
+        for (unsigned i = 0; i < fNumElements; i++)
+            fContents[i].emitScript(out);
+        out.print(
+            R"RAW(
+                {Connection: close};
+                </script>
+                </body></html>
+            )RAW");
+    }
+
+    bool handleCachedRequest(Print& out, const WRequest& request) const
+    {
+        if (!prerender())
+        {
+            emitStatus(out, request, "200 OK");
+            out.println("Content-type:text/html");
+            out.println("Connection: close");
+            out.println();
+            emitPage(out, true);
+            return false;
+        }
+        bool keepAlive;
+        if (request.headerEquals("If-None-Match", fCache.etag))
+        {
+            emitStatus(out, request, "304 Not Modified");
+            out.print("ETag: "); out.println(fCache.etag);
+            keepAlive = emitConnection(out, request, true);
+            out.println();
+            return keepAlive;
+        }
+        bool gzip = (fCache.gzip != nullptr && request.headerContains("Accept-Encoding", "gzip"));
+        emitStatus(out, request, "200 OK");
+        out.println("Content-type:text/html");
+        out.print("Content-Length:"); out.println(gzip ? fCache.gzipSize : fCache.size);
+        out.println("Cache-Control: no-cache");
+        out.print("ETag: "); out.println(fCache.etag);
+        if (fCache.gzip != nullptr)
+            out.println("Vary: Accept-Encoding");
+        if (gzip)
+            out.println("Content-Encoding: gzip");
+        keepAlive = emitConnection(out, request, true);
+        out.println();
+        if (gzip)
+            out.write(fCache.gzip, fCache.gzipSize);
+        else
+            out.write(fCache.data, fCache.size);
+        return keepAlive;
+    }
+
+    /** The WebSocket script is only served while live values are enabled */
+    static void emitLiveScript(Print& out)
+    {
+        if (!liveValues())
+            return;
+        out.print(
+            R"RAW(
+                function liveConnect() {
+                    if (!window.WebSocket) return;
+                    var ws = new WebSocket('ws://'+window.location.host+location.pathname+'?_ws_');
+                    ws.onopen = function() { liveSocket = ws; };
+                    ws.onclose = function() {
+                        if (liveSocket == ws) { liveSocket = null; setTimeout(liveConnect, 2000); }
+                    };
+                    ws.onmessage = function(event) {
+                        event.data.split('\n').forEach(function(line) {
+                            var sep = line.indexOf('=');
+                            if (sep <= 0) return;
+                            var id = line.substring(0, sep), val = line.substring(sep+1);
+                            window[id+'_val_'] = val;
+                            var elm = window[id];
+                            if (elm == undefined || elm == document.activeElement) return;
+                            if (elm.type == 'checkbox') elm.checked = (val == 'true');
+                            else if ('value' in elm) elm.value = val;
+                            var priv = window[id+'_priv'];
+                            if (priv != undefined) priv.innerHTML = val;
+                        });
+                    };
+                }
+                window.addEventListener('load', liveConnect);
+            )RAW");
+    }
+
+    static void emitStatus(Print& out, const WRequest& request, const char* status)
+    {
+        out.print(request.isHTTP11() ? "HTTP/1.1 " : "HTTP/1.0 ");
+        out.println(status);
+    }
+
+    /**
+      * Write the Connection header. Returns true if the connection will be kept open.
+      */
+    static bool emitConnection(Print& out, const WRequest& request, bool canKeepAlive)
+    {
+        bool keepAlive = (canKeepAlive && request.keepAlive());
+        out.println(keepAlive ? "Connection: keep-alive" : "Connection: close");
+        return keepAlive;
+    }
+
     inline fs::File openFileOrCompressed(String fileName, bool &compressed) const
     {
         // SPIFFS open always returns true
@@ -1137,13 +1855,17 @@ protected:
     String fURL;
     String fTitleOrPath;
     String fLanguageOrMimeType;
-    fs::FS* fFS;
+    fs::FS* fFS = nullptr;
     uint8_t fFlags = 0;
     unsigned fNumElements;
     const WElement* fContents;
     void (*fCompleteProc)(Client& client) = nullptr;
     void (*fUploaderProc)(WUploader &uploader) = nullptr;
     void (*fAPIProc)(Print& out, String queryString) = nullptr;
+    WUploadSink* fSink = nullptr;
+    void (*fStreamCompleteProc)(Client& client, const WUploadStream& upload) = nullptr;
+    void (*fStreamProgressProc)(const WUploadStream& upload) = nullptr;
+    mutable WCachedBody fCache;
 };
 
 class WAPI : public WPage
@@ -1167,6 +1889,56 @@ public:
     }
 };
 
+/**
+  * \ingroup wifi
+  *
+  * \class WStreamUpload
+  *
+  * \brief Upload page that streams the request body to a WUploadSink
+  *
+  * The body is written by WUploadStream using double buffering. If the client sends
+  * an X-Upload-CRC32 header the upload is only committed if the CRC matches. If no
+  * complete callback is given a plain text status is returned to the client.
+  *
+  * \code
+  * WOTAUploadSink otaSink;
+  * WPage pages[] = {
+  *    WStreamUpload("/upload/firmware", otaSink, [](Client& client, const WUploadStream& upload) {
+  *        client.println("HTTP/1.0 200 OK");
+  *        ...
+  *        if (upload.succeeded())
+  *            reboot();
+  *    })
+  * };
+  * \endcode
+  */
+class WStreamUpload : public WPage
+{
+public:
+    WStreamUpload(String url, WUploadSink& sink,
+            void (*completeProc)(Client& client, const WUploadStream& upload) = nullptr,
+            void (*progressProc)(const WUploadStream& upload) = nullptr) :
+        WPage(url, nullptr, 0)
+    {
+        fSink = &sink;
+        fStreamCompleteProc = completeProc;
+        fStreamProgressProc = progressProc;
+    }
+};
+
+#ifndef WIFI_WEB_SOCKET_INTERVAL
+#define WIFI_WEB_SOCKET_INTERVAL 50
+#endif
+
+// Size of the buffer live values are formatted into. Longer values are truncated.
+#ifndef WIFI_WEB_SOCKET_BUFFER_SIZE
+#define WIFI_WEB_SOCKET_BUFFER_SIZE 256
+#endif
+
+#ifndef WIFI_WEB_KEEP_ALIVE_TIMEOUT
+#define WIFI_WEB_KEEP_ALIVE_TIMEOUT 5000
+#endif
+
 /**
   * \ingroup wifi
   *
@@ -1189,6 +1961,11 @@ public:
   * WifiWebServer<1,SizeOfArray(pages)> myWeb(pages, WIFI_AP_NAME, WIFI_AP_PASSPHRASE, WIFI_ACCESS_POINT);
   * \endcode
   *
+  * If live values are enabled using setLiveValues() pages open a WebSocket to the server.
+  * Changed element values are pushed to the browser every WIFI_WEB_SOCKET_INTERVAL ms
+  * and control updates are sent back over the same connection as "id=value" text frames.
+  * Each open page holds one of the maxClients connections. Only the elements of pages
+  * with an open WebSocket are polled.
   */
 template<unsigned maxClients = 10, unsigned numPages = 0>
 class WifiWebServer : public WiFiServer, public WifiAccess::Notify
@@ -1204,8 +1981,6 @@ public:
       */
     WifiWebServer(const WPage pages[], WifiAccess &wifiAccess, uint16_t port = 80) :
         WiFiServer(port),
-        fHeader(""),
-        fRequest(""),
         fPages(pages)
     {
         wifiAccess.addNotify(this);
@@ -1226,6 +2001,15 @@ public:
         return fEnabled;
     }
 
+    /**
+      * Accept WebSocket connections from pages and push changed values to them
+      */
+    void setLiveValues(bool enable)
+    {
+        fLiveValues = enable;
+        WPage::liveValues() = enable;
+    }
+
     virtual void wifiConnected(WifiAccess& access) override
     {
         DEBUG_PRINTLN("WifiWebServer.wifiConnected");
@@ -1249,40 +2033,37 @@ public:
     }
 
     /**
-      * Dispatch any received i2c event to CommandEvent
+      * Accept new clients and process requests from connected clients
       */
     void handle()
     {
         if (!fEnabled || !fStarted)
             return;
+        uint32_t now = millis();
         //check if there are any new clients
         if (hasClient())
         {
-            unsigned i;
-            for (i = 0; i < maxClients; i++)
+            int i = findFreeClient();
+            if (i != -1)
             {
-                //find free/disconnected spot
-                if (!fClients[i] || !fClients[i].connected())
-                {
-                    if (fActivityCallback != nullptr)
-                        fActivityCallback();
-                    if (fClients[i])
-                        fClients[i].stop();
-                    fClients[i] = available();
-                    fClients[i].setNoDelay(true);
-                    if (!fClients[i])
-                        DEBUG_PRINTLN("available broken");
-                    DEBUG_PRINT("New client: ");
-                    DEBUG_PRINT(i); DEBUG_PRINT(' ');
-                    DEBUG_PRINTLN(fClients[i].remoteIP());
-                    fRequest.reserve(4096);
-                    fHeader.reserve(4096);
-                    if (fConnectedCallback)
-                        fConnectedCallback();
-                    break;
-                }
+                if (fActivityCallback != nullptr)
+                    fActivityCallback();
+                if (fClients[i])
+                    fClients[i].stop();
+                fClients[i] = available();
+                fClients[i].setNoDelay(true);
+                fRequest[i].reset();
+                fWebSocket[i] = false;
+                fLastActivity[i] = now;
+                if (!fClients[i])
+                    DEBUG_PRINTLN("available broken");
+                DEBUG_PRINT("New client: ");
+                DEBUG_PRINT(i); DEBUG_PRINT(' ');
+                DEBUG_PRINTLN(fClients[i].remoteIP());
+                if (fConnectedCallback)
+                    fConnectedCallback();
             }
-            if (i >= maxClients)
+            else
             {
                 //no free/disconnected spot so reject
                 Serial.println("NO CLIENTS AVAILABLE");
@@ -1292,222 +2073,450 @@ public:
         //check clients for data
         for (unsigned i = 0; i < maxClients; i++)
         {
-            if (fClients[i] && fClients[i].connected())
+            WiFiClient& client = fClients[i];
+            if (!client || !client.connected())
             {
-                //get data from the telnet client and push it to the UART
-                if (fUploader != nullptr)
-                {
-                    if (fUploader->receivedSize + fUploader->currentSize == fUploader->fileSize)
-                    {
-                        if (fUploader->currentSize)
-                        {
-                            fUploader->status = UPLOAD_FILE_WRITE;
-                            fUploaderPage->callUploader(*fUploader);
-                            fUploader->receivedSize += fUploader->currentSize;
-                            fUploader->currentSize = 0;
-                        }
-                        fUploader->status = UPLOAD_FILE_END;
-                        fUploaderPage->callUploader(*fUploader);
-                        fUploaderPage->callComplete(fClients[i]);
-                        delete fUploader;
-                        fUploaderPage = nullptr;
-                        fUploader = nullptr;
-
-                        // The HTTP response ends with another blank line
-                        // Break out of the while loop
-                        fHeader = "";
-                        fClients[i].stop();
-                    }
-                }
-                if (fClients[i].available() && fActivityCallback != nullptr)
+                if (client)
+                    client.stop();
+                if (fUploaderClient == int(i))
+                    abortUpload();
+                fWebSocket[i] = false;
+                continue;
+            }
+            if (fWebSocket[i])
+            {
+                handleWebSocket(i);
+                continue;
+            }
+            if (fStream != nullptr && fUploaderClient == int(i))
+            {
+                handleStream(i);
+                continue;
+            }
+            if (client.available())
+            {
+                if (fActivityCallback != nullptr)
                     fActivityCallback();
-                while (fClients[i].available())
+                fLastActivity[i] = now;
+            }
+            else if (fRequest[i].isIdle() && fUploaderClient != int(i) &&
+                     uint32_t(now - fLastActivity[i]) >= WIFI_WEB_KEEP_ALIVE_TIMEOUT)
+            {
+                // Close idle persistent connections
+                client.stop();
+                continue;
+            }
+            while (client.available())
+            {
+                if (fUploader != nullptr && fUploaderClient == int(i))
                 {
-                    char c = fClients[i].read();
-                    // Serial.write(c);
-                    if (fUploader != nullptr)
-                    {
-                        if (fUploader->currentSize == HTTP_UPLOAD_BUFLEN)
-                        {
-                            fUploader->status = UPLOAD_FILE_WRITE;
-                            fUploaderPage->callUploader(*fUploader);
-                            fUploader->receivedSize += fUploader->currentSize;
-                            fUploader->currentSize = 0;
-                        }
-                        fUploader->buf[fUploader->currentSize++] = c;
-                        fUploader->buf[fUploader->currentSize] = 0;
-                        continue;
-                    }
-                    fHeader.concat(c);
-                    if (c == '\n')
+                    if (fUploader->currentSize == HTTP_UPLOAD_BUFLEN)
                     {
-                        // if the byte is a newline character
-                        // if the current line is blank, you got two newline characters in a row.
-                        // that's the end of the client HTTP request, so send a response:
-                        if (fRequest.length() == 0)
-                        {
-                            if (fHeader.startsWith("POST /"))
-                            {
-                                fUploaderPage = getPost();
-                                if (fUploaderPage == nullptr)
-                                {
-                                    fClients[i].println("HTTP/1.0 404 Not Found");
-                                    fClients[i].println("Content-type:text/html");
-                                    fClients[i].println("Connection: close");
-                                    fClients[i].println();
-                                    break;
-                                }
-                                else
-                                {
-                                    int offs = fHeader.indexOf("\nContent-Length: ");
-                                    unsigned contentLength = 0;
-                                    if (offs > 0)
-                                    {
-                                        int pos1 = fHeader.indexOf('\n', offs+1);
-                                        int pos2 = fHeader.lastIndexOf(' ', pos1);
-                                        if (pos1 != 0 && pos2 != 0)
-                                        {
-                                            contentLength = fHeader.substring(pos1+1, pos2).toInt();
-                                        }
-                                    }
-                                    fUploader = new WUploader;
-                                    fUploader->status = UPLOAD_FILE_START;
-                                    fUploader->filename = "filename.txt";
-                                    fUploader->name = "name.txt";
-                                    fUploader->type = "type.txt";
-                                    fUploader->fileSize = contentLength;
-                                    fUploader->receivedSize = 0;
-                                    fUploader->currentSize = 0;
-
-                                    String prefix = "POST "+fUploaderPage->getURL()+"?";
-                                    if (fHeader.startsWith(prefix))
-                                    {
-                                        int end = fHeader.indexOf(' ', prefix.length());
-                                        fUploader->queryString = fHeader.substring(prefix.length(), end);
-                                    }
-                                    else
-                                    {
-                                        fUploader->queryString = "";
-                                    }
-                                    fUploaderPage->callUploader(*fUploader);
-                                }
-                            }
-                            else if (fHeader.startsWith("GET /robots.txt"))
-                            {
-                                Stream& out = fClients[i];
-                                //PSRamBufferedPrintStream out(fClients[i]);
-                                // HTTP headers always start with a response code (e.g. HTTP/1.1 200 OK)
-                                // and a content-type so the client knows what's coming, then a blank line:
-                                out.println("HTTP/1.0 200 OK");
-                                out.println("Content-type:text/html");
-                                out.println("Connection: close");
-                                out.println();
-
-                                // The HTTP response ends with another blank line
-                                out.println();
-                                out.flush();
-                                // Break out of the while loop
-                                fHeader = "";
-                                fClients[i].stop();
-                                break;
-                            }
-                            else if (fHeader.startsWith("GET /"))
-                            {
-                                // Stream& out = fClients[i];
-                                RamBufferedPrintStream out(fClients[i]);
-                                // HTTP headers always start with a response code (e.g. HTTP/1.1 200 OK)
-                                // and a content-type so the client knows what's coming, then a blank line:
-                                handleGetRequest(out);
-
-                                // The HTTP response ends with another blank line
-                                out.println();
-                                out.flush();
-                                // Break out of the while loop
-                                fHeader = "";
-                                fClients[i].stop();
-                                break;
-                            }
-                        }
-                        else
-                        {
-                            fRequest = "";
-                        }
+                        fUploader->status = UPLOAD_FILE_WRITE;
+                        fUploaderPage->callUploader(*fUploader);
+                        fUploader->receivedSize += fUploader->currentSize;
+                        fUploader->currentSize = 0;
                     }
-                    else if (c != '\r')
+                    size_t remaining = fUploader->fileSize - fUploader->receivedSize - fUploader->currentSize;
+                    size_t len = min(remaining, size_t(HTTP_UPLOAD_BUFLEN - fUploader->currentSize));
+                    int n = client.read(&fUploader->buf[fUploader->currentSize], len);
+                    if (n <= 0)
+                        break;
+                    fUploader->currentSize += n;
+                    fUploader->buf[fUploader->currentSize] = 0;
+                    if (fUploader->receivedSize + fUploader->currentSize == fUploader->fileSize)
                     {
-                        fRequest.concat(c);
+                        finishUpload();
+                        break;
                     }
+                    continue;
                 }
-
-            }
-            else
-            {
-                if (fClients[i])
+                if (fRequest[i].parse(client.read()) == WRequest::kIncomplete)
+                    continue;
+                if (!handleRequest(i))
                 {
-                    fClients[i].stop();
+                    client.stop();
+                    break;
                 }
+                // Remaining data belongs to the WebSocket or the upload stream
+                if (fWebSocket[i] || (fStream != nullptr && fUploaderClient == int(i)))
+                    break;
             }
         }
+        pushLiveValues();
     }
 
 private:
     bool fEnabled = true;
     bool fStarted = false;
-    String fHeader;
-    String fRequest;
-    bool fHandlePost;
     const WPage* fPages;
     const WPage* fUploaderPage = nullptr;
     WUploader* fUploader = nullptr;
+    WUploadStream* fStream = nullptr;
+    int fUploaderClient = -1;
     void (*fConnectedCallback)() = nullptr;
     void (*fWiFiActiveCallback)(bool ap) = nullptr;
     void (*fActivityCallback)() = nullptr;
+    WRequest fRequest[maxClients];
+    uint32_t fLastActivity[maxClients] = {};
+    bool fLiveValues = false;
+    bool fWebSocket[maxClients] = {};
+    const WPage* fSocketPage[maxClients] = {};
+    WSocket fSocket[maxClients];
+    uint32_t fLastPush = 0;
 
-    const WPage* getPage() const
+    int findFreeClient()
     {
-        String url = "/";
-        if (fHeader.startsWith("GET /"))
+        int idle = -1;
+        for (unsigned i = 0; i < maxClients; i++)
         {
-            int pos1 = fHeader.indexOf('\n');
-            int pos2 = fHeader.lastIndexOf(' ', pos1);
-            if (pos1 != -1 && pos2 != -1)
+            //find free/disconnected spot
+            if (!fClients[i] || !fClients[i].connected())
+                return i;
+            // Otherwise remember the longest idle persistent connection
+            if (!fWebSocket[i] && fRequest[i].isIdle() && fUploaderClient != int(i) &&
+                (idle == -1 || int32_t(fLastActivity[i] - fLastActivity[idle]) < 0))
             {
-                url = fHeader.substring(4, pos2);
-                if ((pos1 = url.indexOf('?')) != -1)
-                {
-                    url = url.substring(0, pos1);
-                }
+                idle = i;
             }
         }
-        for (unsigned i = 0; i < numPages; i++)
+        return idle;
+    }
+
+    /**
+      * Respond to a completely parsed request. Returns false if the connection should be closed.
+      */
+    bool handleRequest(unsigned i)
+    {
+        WiFiClient& client = fClients[i];
+        WRequest& request = fRequest[i];
+        if (!request.isComplete())
+        {
+            int code = request.errorCode();
+            client.print("HTTP/1.1 "); client.print(code);
+            client.println((code == 414) ? " URI Too Long" :
+                           (code == 431) ? " Request Header Fields Too Large" : " Bad Request");
+            client.println("Connection: close");
+            client.println();
+            return false;
+        }
+        if (request.method() == WRequest::kPOST)
+            return beginUpload(i);
+        if (request.method() != WRequest::kGET)
+        {
+            client.println("HTTP/1.1 501 Not Implemented");
+            client.println("Connection: close");
+            client.println();
+            return false;
+        }
+        if (strcmp(request.path(), "/robots.txt") == 0)
+        {
+            client.println("HTTP/1.0 200 OK");
+            client.println("Content-type:text/html");
+            client.println("Connection: close");
+            client.println();
+            return false;
+        }
+        if (fLiveValues && strcmp(request.query(), "_ws_") == 0 &&
+            request.headerContains("Upgrade", "websocket"))
         {
-            if (fPages[i].getURL() == url && fPages[i].isGet())
+            const WPage* page = getPage(request.path());
+            if (page != nullptr)
+                return acceptWebSocket(i, *page);
+        }
+        bool keepAlive = false;
+        {
+            RamBufferedPrintStream out(client);
+            const WPage* page = getPage(request.path());
+            if (page != nullptr)
             {
-                return &fPages[i];
+                keepAlive = page->handleGetRequest(out, request);
+            }
+            else
+            {
+                out.println("HTTP/1.0 404 NOT FOUND");
+                out.println("Connection: close");
+                out.println();
             }
+            out.flush();
         }
-        return nullptr;
+        request.reset();
+        return keepAlive;
+    }
+
+    bool beginUpload(unsigned i)
+    {
+        WiFiClient& client = fClients[i];
+        WRequest& request = fRequest[i];
+        const WPage* page = getPost(request.path());
+        if (page == nullptr || fUploaderClient != -1)
+        {
+            client.println((page == nullptr) ? "HTTP/1.0 404 Not Found" : "HTTP/1.0 503 Service Unavailable");
+            client.println("Content-type:text/html");
+            client.println("Connection: close");
+            client.println();
+            return false;
+        }
+        fUploaderPage = page;
+        fUploaderClient = i;
+        if (page->getSink() != nullptr)
+            return beginStream(i);
+        fUploader = new WUploader;
+        fUploader->status = UPLOAD_FILE_START;
+        fUploader->filename = "filename.txt";
+        fUploader->name = "name.txt";
+        fUploader->type = "type.txt";
+        fUploader->fileSize = request.contentLength();
+        fUploader->receivedSize = 0;
+        fUploader->currentSize = 0;
+        fUploader->queryString = request.query();
+        fUploaderPage->callUploader(*fUploader);
+        request.reset();
+        if (fUploader->fileSize == 0)
+        {
+            finishUpload();
+            return false;
+        }
+        return true;
+    }
+
+    void finishUpload()
+    {
+        WiFiClient& client = fClients[fUploaderClient];
+        if (fUploader->currentSize)
+        {
+            fUploader->status = UPLOAD_FILE_WRITE;
+            fUploaderPage->callUploader(*fUploader);
+            fUploader->receivedSize += fUploader->currentSize;
+            fUploader->currentSize = 0;
+        }
+        fUploader->status = UPLOAD_FILE_END;
+        fUploaderPage->callUploader(*fUploader);
+        fUploaderPage->callComplete(client);
+        delete fUploader;
+        fUploaderPage = nullptr;
+        fUploader = nullptr;
+        fUploaderClient = -1;
+        client.stop();
+    }
+
+    void abortUpload()
+    {
+        if (fStream != nullptr)
+        {
+            fStream->abort();
+            delete fStream;
+            fStream = nullptr;
+        }
+        if (fUploader != nullptr)
+        {
+            fUploader->status = UPLOAD_FILE_ABORTED;
+            fUploaderPage->callUploader(*fUploader);
+            delete fUploader;
+            fUploader = nullptr;
+        }
+        fUploaderPage = nullptr;
+        fUploaderClient = -1;
+    }
+
+    bool beginStream(unsigned i)
+    {
+        WRequest& request = fRequest[i];
+        size_t boundaryLen;
+        size_t contentLength = request.contentLength();
+        const char* boundary = request.boundary(boundaryLen);
+        fStream = new WUploadStream(*fUploaderPage->getSink());
+        if (!fStream->begin(contentLength, boundary, boundaryLen, request.header("X-Upload-CRC32")))
+        {
+            finishStream();
+            return false;
+        }
+        request.reset();
+        if (contentLength == 0)
+        {
+            finishStream();
+            return false;
+        }
+        return true;
+    }
+
+    void handleStream(unsigned i)
+    {
+        size_t received = fStream->getReceived();
+        bool ok = fStream->receive(fClients[i]);
+        if (fStream->getReceived() != received)
+        {
+            if (fActivityCallback != nullptr)
+                fActivityCallback();
+            fLastActivity[i] = millis();
+            fUploaderPage->callStreamProgress(*fStream);
+        }
+        if (!ok || fStream->isComplete())
+            finishStream();
+    }
+
+    void finishStream()
+    {
+        WiFiClient& client = fClients[fUploaderClient];
+        fStream->end();
+        DEBUG_PRINT("UPLOAD "); DEBUG_PRINT(fStream->getWritten());
+        DEBUG_PRINT(" bytes "); DEBUG_PRINT(fStream->getBytesPerSecond()); DEBUG_PRINTLN(" bytes/sec");
+        fUploaderPage->callStreamComplete(client, *fStream);
+        delete fStream;
+        fStream = nullptr;
+        fUploaderPage = nullptr;
+        fUploaderClient = -1;
+        client.stop();
     }
 
-    const WPage* getPost() const
+    bool acceptWebSocket(unsigned i, const WPage& page)
     {
-        String url = "/";
-        if (fHeader.startsWith("POST /"))
+        WiFiClient& client = fClients[i];
+        const char* key = fRequest[i].header("Sec-WebSocket-Key");
+        if (key == nullptr)
         {
-            int pos1 = fHeader.indexOf('\n');
-            int pos2 = fHeader.lastIndexOf(' ', pos1);
-            if (pos1 != -1 && pos2 != -1)
+            client.println("HTTP/1.1 400 Bad Request");
+            client.println("Connection: close");
+            client.println();
+            return false;
+        }
+        char accept[29];
+        WSocket::acceptKey(key, strlen(key), accept);
+        fRequest[i].reset();
+        client.println("HTTP/1.1 101 Switching Protocols");
+        client.println("Upgrade: websocket");
+        client.println("Connection: Upgrade");
+        client.print("Sec-WebSocket-Accept: "); client.println(accept);
+        client.println();
+        fWebSocket[i] = true;
+        fSocketPage[i] = &page;
+        fSocket[i].reset();
+
+        // Send the current value of every element on the page
+        sendValues(page, i, false);
+        return true;
+    }
+
+
+    void handleWebSocket(unsigned i)
+    {
+        WiFiClient& client = fClients[i];
+        WSocket& socket = fSocket[i];
+        if (client.available() && fActivityCallback != nullptr)
+            fActivityCallback();
+        while (client.available())
+        {
+            switch (socket.parse(client.read()))
             {
-                url = fHeader.substring(5, pos2);
-                if ((pos1 = url.indexOf('?')) != -1)
+                case WSocket::kMessage:
+                    setLiveValue(*fSocketPage[i], socket.payload());
+                    break;
+                case WSocket::kControl:
+                    if (socket.opcode() == WSocket::kPing)
+                        WSocket::writeFrame(client, WSocket::kPong, socket.payload(), socket.payloadLength());
+                    break;
+                case WSocket::kClosed:
+                    WSocket::writeFrame(client, WSocket::kClose, nullptr, 0);
+                    client.stop();
+                    fWebSocket[i] = false;
+                    return;
+                case WSocket::kNone:
+                    break;
+            }
+        }
+    }
+
+    void setLiveValue(const WPage& page, char* msg)
+    {
+        char* val = strchr(msg, '=');
+        if (val == nullptr)
+            return;
+        for (unsigned e = 0; e < page.getElementCount(); e++)
+        {
+            const WElement& elm = page.getElement(e);
+            if (elm.hasID(msg, val - msg))
+            {
+                elm.setValue(val + 1);
+                return;
+            }
+        }
+    }
+
+    void pushLiveValues()
+    {
+        uint32_t now = millis();
+        if (!fLiveValues || uint32_t(now - fLastPush) < WIFI_WEB_SOCKET_INTERVAL)
+            return;
+        fLastPush = now;
+        for (unsigned p = 0; p < numPages; p++)
+        {
+            // Pages nobody is watching are not polled
+            for (unsigned i = 0; i < maxClients; i++)
+            {
+                if (fWebSocket[i] && fSocketPage[i] == &fPages[p])
                 {
-                    url = url.substring(0, pos1);
+                    sendValues(fPages[p], maxClients, true);
+                    break;
                 }
             }
         }
+    }
+
+    /**
+      * Send "id=value" lines for the elements of page to client i, or to every WebSocket
+      * open on the page if i is maxClients. If changedOnly is true only values that changed
+      * since the last push are sent.
+      */
+    void sendValues(const WPage& page, unsigned client, bool changedOnly)
+    {
+        char msg[WIFI_WEB_SOCKET_BUFFER_SIZE];
+        char val[WIFI_WEB_SOCKET_BUFFER_SIZE / 2];
+        size_t len = 0;
+        for (unsigned e = 0; e < page.getElementCount(); e++)
+        {
+            const WElement& elm = page.getElement(e);
+            if (!elm.hasValue())
+                continue;
+            if (changedOnly)
+            {
+                if (!elm.pollValue(val, sizeof(val)))
+                    continue;
+            }
+            else
+            {
+                elm.formatValue(val, sizeof(val));
+            }
+            const char* id = elm.getIDString();
+            // "id=value\n" and the terminating nul written by snprintf()
+            size_t lineLen = strlen(id) + strlen(val) + 2;
+            if (lineLen >= sizeof(msg))
+                continue;
+            if (len + lineLen >= sizeof(msg))
+            {
+                sendFrame(page, client, msg, len);
+                len = 0;
+            }
+            snprintf(&msg[len], sizeof(msg) - len, "%s=%s\n", id, val);
+            len += lineLen;
+        }
+        if (len != 0)
+            sendFrame(page, client, msg, len);
+    }
+
+    void sendFrame(const WPage& page, unsigned client, const char* msg, size_t len)
+    {
+        for (unsigned i = 0; i < maxClients; i++)
+        {
+            if ((client == maxClients || client == i) && fWebSocket[i] && fSocketPage[i] == &page)
+                WSocket::writeFrame(fClients[i], WSocket::kText, msg, len);
+        }
+    }
+
+    const WPage* getPage(const char* path) const
+    {
         for (unsigned i = 0; i < numPages; i++)
         {
-            if (fPages[i].getURL() == url && !fPages[i].isGet())
+            if (fPages[i].getURL() == path && fPages[i].isGet())
             {
                 return &fPages[i];
             }
@@ -1515,19 +2524,16 @@ private:
         return nullptr;
     }
 
-    void handleGetRequest(Print &out)
+    const WPage* getPost(const char* path) const
     {
-        const WPage* page = getPage();
-        if (page != nullptr)
-        {
-            page->handleGetRequest(out, fHeader);
-        }
-        else
+        for (unsigned i = 0; i < numPages; i++)
         {
-            out.println("HTTP/1.0 404 NOT FOUND");
-            out.println("Connection: close");
-            out.println();
+            if (fPages[i].getURL() == path && !fPages[i].isGet())
+            {
+                return &fPages[i];
+            }
         }
+        return nullptr;
     }
 };
 
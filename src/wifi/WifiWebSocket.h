@@ -0,0 +1,284 @@
+#ifndef WifiWebSocket_h
+#define WifiWebSocket_h
+
+#include "ReelTwo.h"
+
+#ifndef WIFI_WEB_SOCKET_FRAME_SIZE
+#define WIFI_WEB_SOCKET_FRAME_SIZE 128
+#endif
+
+/**
+  * \ingroup wifi
+  *
+  * \class WSocket
+  *
+  * \brief Minimal server side WebSocket (RFC 6455) framing used by WifiWebServer.
+  *
+  * Only unfragmented text frames up to WIFI_WEB_SOCKET_FRAME_SIZE bytes are delivered.
+  * Larger frames are consumed and discarded. Ping frames are answered with a pong and
+  * a close frame ends the connection.
+  */
+class WSocket
+{
+public:
+    enum
+    {
+        kContinuation = 0x0,
+        kText = 0x1,
+        kBinary = 0x2,
+        kClose = 0x8,
+        kPing = 0x9,
+        kPong = 0xA
+    };
+
+    enum Result
+    {
+        kNone,
+        kMessage,
+        kControl,
+        kClosed
+    };
+
+    /**
+      * Computes the Sec-WebSocket-Accept response for the specified Sec-WebSocket-Key.
+      * The result is written to accept as a null terminated base64 string (29 bytes).
+      */
+    static void acceptKey(const char* key, size_t keyLen, char accept[29])
+    {
+        static const char sGUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        uint8_t block[64];
+        uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+        size_t total = keyLen + sizeof(sGUID) - 1;
+        size_t pos = 0;
+        bool done = false;
+        while (!done)
+        {
+            // Fill one 64 byte block of key+GUID with SHA-1 padding
+            for (unsigned i = 0; i < 64; i++, pos++)
+            {
+                if (pos < keyLen)
+                    block[i] = key[pos];
+                else if (pos < total)
+                    block[i] = sGUID[pos - keyLen];
+                else
+                    block[i] = (pos == total) ? 0x80 : 0;
+            }
+            if (pos >= total + 9)
+            {
+                uint64_t bits = uint64_t(total) * 8;
+                for (unsigned i = 0; i < 8; i++)
+                    block[63 - i] = uint8_t(bits >> (i * 8));
+                done = true;
+            }
+            sha1Block(h, block);
+        }
+        uint8_t digest[20];
+        for (unsigned i = 0; i < 20; i++)
+            digest[i] = uint8_t(h[i / 4] >> (24 - (i % 4) * 8));
+        base64(digest, sizeof(digest), accept);
+    }
+
+    /**
+      * Writes a single unmasked frame.
+      */
+    static void writeFrame(Print& out, uint8_t opcode, const void* data, size_t len)
+    {
+        uint8_t hdr[4];
+        unsigned hdrLen = 2;
+        hdr[0] = 0x80 | opcode;
+        if (len < 126)
+        {
+            hdr[1] = len;
+        }
+        else
+        {
+            hdr[1] = 126;
+            hdr[2] = uint8_t(len >> 8);
+            hdr[3] = uint8_t(len);
+            hdrLen = 4;
+        }
+        out.write(hdr, hdrLen);
+        if (len != 0)
+            out.write((const uint8_t*)data, len);
+    }
+
+    inline void reset()
+    {
+        fState = kOpcode;
+        fLength = 0;
+    }
+
+    /**
+      * Feed one received byte to the frame parser. Returns kMessage when a complete
+      * text frame is available in payload(), kControl for a ping or pong and kClosed
+      * if the client closed the connection.
+      */
+    Result parse(uint8_t ch)
+    {
+        switch (fState)
+        {
+            case kOpcode:
+                fOpcode = ch & 0x0F;
+                fFinal = (ch & 0x80) != 0;
+                fState = kLength;
+                return kNone;
+            case kLength:
+                fMasked = (ch & 0x80) != 0;
+                fLength = ch & 0x7F;
+                fMaskPos = 0;
+                fPos = 0;
+                if (fLength >= 126)
+                {
+                    fCount = (fLength == 126) ? 2 : 8;
+                    fLength = 0;
+                    fState = kExtLength;
+                    return kNone;
+                }
+                break;
+            case kExtLength:
+                fLength = (fLength << 8) | ch;
+                if (--fCount != 0)
+                    return kNone;
+                break;
+            case kMask:
+                fMask[fMaskPos++] = ch;
+                if (fMaskPos < 4)
+                    return kNone;
+                fState = kPayload;
+                return (fLength == 0) ? complete() : kNone;
+            case kPayload:
+                if (fMasked)
+                    ch ^= fMask[fPos & 3];
+                if (fPos < sizeof(fPayload) - 1)
+                    fPayload[fPos] = ch;
+                return (++fPos == fLength) ? complete() : kNone;
+        }
+        // Header length complete
+        fState = (fMasked) ? kMask : kPayload;
+        return (fState == kPayload && fLength == 0) ? complete() : kNone;
+    }
+
+    /** Null terminated payload of the last complete frame */
+    inline char* payload()
+    {
+        return fPayload;
+    }
+
+    inline size_t payloadLength() const
+    {
+        return min(size_t(fLength), sizeof(fPayload) - 1);
+    }
+
+    inline uint8_t opcode() const
+    {
+        return fOpcode;
+    }
+
+private:
+    enum State
+    {
+        kOpcode,
+        kLength,
+        kExtLength,
+        kMask,
+        kPayload
+    };
+
+    uint8_t fState = kOpcode;
+    uint8_t fOpcode = 0;
+    bool fFinal = false;
+    bool fMasked = false;
+    uint8_t fCount = 0;
+    uint8_t fMaskPos = 0;
+    uint8_t fMask[4] = {};
+    uint64_t fLength = 0;
+    uint64_t fPos = 0;
+    char fPayload[WIFI_WEB_SOCKET_FRAME_SIZE + 1];
+
+    Result complete()
+    {
+        fState = kOpcode;
+        fPayload[min(fPos, uint64_t(sizeof(fPayload) - 1))] = '\0';
+        if (fOpcode == kClose)
+            return kClosed;
+        if (fOpcode >= kClose)
+            return kControl;
+        // Drop fragmented, binary and oversized messages
+        if (fOpcode != kText || !fFinal || fLength >= sizeof(fPayload))
+            return kNone;
+        return kMessage;
+    }
+
+    static inline uint32_t rol(uint32_t v, unsigned n)
+    {
+        return (v << n) | (v >> (32 - n));
+    }
+
+    static void sha1Block(uint32_t h[5], const uint8_t block[64])
+    {
+        uint32_t w[80];
+        for (unsigned i = 0; i < 16; i++)
+        {
+            w[i] = (uint32_t(block[i*4]) << 24) | (uint32_t(block[i*4+1]) << 16) |
+                   (uint32_t(block[i*4+2]) << 8) | block[i*4+3];
+        }
+        for (unsigned i = 16; i < 80; i++)
+            w[i] = rol(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (unsigned i = 0; i < 80; i++)
+        {
+            uint32_t f, k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    static void base64(const uint8_t* data, size_t len, char* out)
+    {
+        static const char sTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (size_t i = 0; i < len; i += 3)
+        {
+            uint32_t v = uint32_t(data[i]) << 16;
+            if (i + 1 < len)
+                v |= uint32_t(data[i+1]) << 8;
+            if (i + 2 < len)
+                v |= data[i+2];
+            *out++ = sTable[(v >> 18) & 0x3F];
+            *out++ = sTable[(v >> 12) & 0x3F];
+            *out++ = (i + 1 < len) ? sTable[(v >> 6) & 0x3F] : '=';
+            *out++ = (i + 2 < len) ? sTable[v & 0x3F] : '=';
+        }
+        *out = '\0';
+    }
+};
+
+#endif